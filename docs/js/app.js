@@ -3,20 +3,33 @@ import {
   buildGetArpStepsSysex,
   buildGetChannelSysex,
   buildGetCustomWaveformSysex,
+  buildGetLatencySysex,
+  buildGetPatchSysex,
+  buildGetVoicePolicySysex,
+  buildPatchSysex,
+  buildResetLatencySysex,
   buildSetArpStepsSysex,
   buildSetCustomWaveformSysex,
+  buildSetVoicePolicySysex,
   buildSysex,
   findOutputByName,
   parseArpStepsFromSysex,
   parseChannelFromSysex,
   parseCustomWaveformFromSysex,
+  parseErrorFromSysex,
+  parseLatencyFromSysex,
+  parsePatchFromSysex,
+  parseVoicePolicyFromSysex,
   requestMIDIAccess,
 } from './midi.js';
-import { MIDI_DEVICE_NAME } from './constants.js';
+import { MIDI_DEVICE_NAME, SYSEX_PATCH_GET_CMD } from './constants.js';
 import './components/midi-status.js';
 import './components/channel-editor.js';
 import './components/arp-editor.js';
 import './components/waveform-editor.js';
+import './components/voice-policy-editor.js';
+import './components/patch-file.js';
+import './components/latency-chart.js';
 
 class IcarusConfigApp extends HTMLElement {
   constructor() {
@@ -28,6 +41,11 @@ class IcarusConfigApp extends HTMLElement {
     this.channelEditor = null;
     this.arpEditor = null;
     this.waveformEditor = null;
+    this.voicePolicyEditor = null;
+    this.patchFile = null;
+    this.latencyChart = null;
+    /** True while waiting for a patch dump to save to a file. */
+    this.patchSavePending = false;
 
     this.handleMidiMessage = this.handleMidiMessage.bind(this);
     this.handleStateChange = this.handleStateChange.bind(this);
@@ -53,6 +71,12 @@ class IcarusConfigApp extends HTMLElement {
       <arp-editor id="arpEditor"></arp-editor>
 
       <waveform-editor id="waveformEditor"></waveform-editor>
+
+      <voice-policy-editor id="voicePolicyEditor"></voice-policy-editor>
+
+      <patch-file id="patchFile"></patch-file>
+
+      <latency-chart id="latencyChart"></latency-chart>
     `;
   }
 
@@ -61,6 +85,9 @@ class IcarusConfigApp extends HTMLElement {
     this.channelEditor = this.querySelector('#channelEditor');
     this.arpEditor = this.querySelector('#arpEditor');
     this.waveformEditor = this.querySelector('#waveformEditor');
+    this.voicePolicyEditor = this.querySelector('#voicePolicyEditor');
+    this.patchFile = this.querySelector('#patchFile');
+    this.latencyChart = this.querySelector('#latencyChart');
   }
 
   buildUi() {
@@ -81,6 +108,19 @@ class IcarusConfigApp extends HTMLElement {
         this.sendCustomWaveform(bank, index);
       }
     });
+    this.voicePolicyEditor?.addEventListener('voice-policy-change', (event) => {
+      const { stealPolicy, retriggerSameNote } = event.detail ?? {};
+      if (typeof stealPolicy === 'number') {
+        this.sendVoicePolicy(stealPolicy, Boolean(retriggerSameNote));
+      }
+    });
+    this.patchFile?.addEventListener('patch-save', () => this.savePatchFile());
+    this.patchFile?.addEventListener('patch-load', (event) => {
+      const data = event.detail?.data;
+      if (data) this.loadPatchFile(data);
+    });
+    this.latencyChart?.addEventListener('latency-refresh', () => this.requestLatency());
+    this.latencyChart?.addEventListener('latency-reset', () => this.resetLatency());
   }
 
   resolveIcarus() {
@@ -108,6 +148,30 @@ class IcarusConfigApp extends HTMLElement {
   handleMidiMessage(event) {
     if (!this.channelEditor || !this.statusEl || !this.arpEditor || !this.waveformEditor) return;
 
+    const patch = parsePatchFromSysex(event.data);
+    if (patch != null) {
+      this.applyPatch(patch);
+      if (this.patchSavePending) {
+        this.patchSavePending = false;
+        this.patchFile?.download(new Uint8Array(event.data));
+        this.statusEl.setStatus('Setup saved to file.', 'connected');
+      } else {
+        this.statusEl.setStatus('Settings loaded from device.', 'connected');
+      }
+      return;
+    }
+
+    const error = parseErrorFromSysex(event.data);
+    if (error != null && error.command === SYSEX_PATCH_GET_CMD) {
+      // Firmware without patch dumps: ask for each setting instead.
+      this.patchSavePending = false;
+      this.requestCurrentChannel();
+      this.requestArpSteps();
+      this.requestCustomWaveform();
+      this.requestVoicePolicy();
+      return;
+    }
+
     const channel = parseChannelFromSysex(event.data);
     if (channel != null) {
       if (typeof this.channelEditor.setChannel === 'function') {
@@ -127,6 +191,76 @@ class IcarusConfigApp extends HTMLElement {
     if (customWaveform != null && typeof this.waveformEditor?.setFromData === 'function') {
       this.waveformEditor.setFromData(customWaveform);
       this.statusEl.setStatus('Custom waveform loaded from device.', 'connected');
+      return;
+    }
+
+    const voicePolicy = parseVoicePolicyFromSysex(event.data);
+    if (voicePolicy != null && typeof this.voicePolicyEditor?.setFromData === 'function') {
+      this.voicePolicyEditor.setFromData(voicePolicy);
+      this.statusEl.setStatus('Voice policy loaded from device.', 'connected');
+      return;
+    }
+
+    const latency = parseLatencyFromSysex(event.data);
+    if (latency != null && typeof this.latencyChart?.setFromData === 'function') {
+      this.latencyChart.setFromData(latency);
+    }
+  }
+
+  /** Update every editor from a patch dump; sections it lacks are left as they are. */
+  applyPatch(patch) {
+    if (patch.channel != null && typeof this.channelEditor?.setChannel === 'function') {
+      this.channelEditor.setChannel(patch.channel);
+    }
+    if (patch.arpSteps != null && typeof this.arpEditor?.setFromData === 'function') {
+      this.arpEditor.setFromData(patch.arpSteps);
+    }
+    if (patch.customWaveform != null && typeof this.waveformEditor?.setFromData === 'function') {
+      this.waveformEditor.setFromData(patch.customWaveform);
+    }
+    if (patch.voicePolicy != null && typeof this.voicePolicyEditor?.setFromData === 'function') {
+      this.voicePolicyEditor.setFromData(patch.voicePolicy);
+    }
+  }
+
+  /** Every persistent setting in one round trip. */
+  requestSettings() {
+    if (typeof this.channelEditor?.setChannel === 'function') {
+      this.channelEditor.setChannel(null);
+    }
+    if (!this.icarusOutput) return;
+    try {
+      this.icarusOutput.port.send(buildGetPatchSysex());
+    } catch {
+      // ignore send errors here; status updates will reflect connection state
+    }
+  }
+
+  savePatchFile() {
+    if (!this.icarusOutput || !this.statusEl) return;
+    try {
+      this.patchSavePending = true;
+      this.icarusOutput.port.send(buildGetPatchSysex());
+    } catch (err) {
+      this.patchSavePending = false;
+      this.statusEl.setStatus('Save setup failed: ' + err.message, 'error');
+    }
+  }
+
+  /** Send a saved setup in one message; the device replies with the patch it applied. */
+  loadPatchFile(data) {
+    if (!this.icarusOutput || !this.statusEl) return;
+    const patch = parsePatchFromSysex(data);
+    const message = patch != null ? buildPatchSysex(patch) : null;
+    if (!message) {
+      this.statusEl.setStatus('Not an Icarus setup file.', 'error');
+      return;
+    }
+    try {
+      this.icarusOutput.port.send(message);
+      this.statusEl.setStatus('Setup sent to device.', 'connected');
+    } catch (err) {
+      this.statusEl.setStatus('Load setup failed: ' + err.message, 'error');
     }
   }
 
@@ -168,6 +302,35 @@ class IcarusConfigApp extends HTMLElement {
     }
   }
 
+  requestVoicePolicy() {
+    if (!this.icarusOutput) return;
+    try {
+      this.icarusOutput.port.send(buildGetVoicePolicySysex());
+    } catch {
+      // ignore
+    }
+  }
+
+  requestLatency() {
+    if (!this.icarusOutput) return;
+    try {
+      this.icarusOutput.port.send(buildGetLatencySysex());
+    } catch {
+      // ignore
+    }
+  }
+
+  resetLatency() {
+    if (!this.icarusOutput || !this.statusEl) return;
+    try {
+      this.icarusOutput.port.send(buildResetLatencySysex());
+      this.latencyChart?.setFromData(null);
+      this.statusEl.setStatus('Note latency reset on device.', 'connected');
+    } catch (err) {
+      this.statusEl.setStatus('Reset latency failed: ' + err.message, 'error');
+    }
+  }
+
   sendArpSteps(mode, steps) {
     if (!this.icarusOutput || !this.statusEl) return;
     const data = buildSetArpStepsSysex(mode, steps);
@@ -194,6 +357,19 @@ class IcarusConfigApp extends HTMLElement {
     }
   }
 
+  sendVoicePolicy(stealPolicy, retriggerSameNote) {
+    if (!this.icarusOutput || !this.statusEl) return;
+    const data = buildSetVoicePolicySysex(stealPolicy, retriggerSameNote);
+    if (!data) return;
+
+    try {
+      this.icarusOutput.port.send(data);
+      this.statusEl.setStatus('Voice policy sent to device.', 'connected');
+    } catch (err) {
+      this.statusEl.setStatus('Send voice policy failed: ' + err.message, 'error');
+    }
+  }
+
   handleStateChange() {
     if (!this.statusEl) return;
 
@@ -208,9 +384,8 @@ class IcarusConfigApp extends HTMLElement {
       this.statusEl.setStatus('No MIDI outputs available. Connect Icarus and refresh.', 'error');
       this.setEditingVisible(false);
     }
-    this.requestCurrentChannel();
-    this.requestArpSteps();
-    this.requestCustomWaveform();
+    this.requestSettings();
+    this.requestLatency();
   }
 
   initMidi() {
@@ -238,9 +413,7 @@ class IcarusConfigApp extends HTMLElement {
           this.statusEl.setStatus('No MIDI device connected. Connect Icarus and refresh.', 'error');
           this.setEditingVisible(false);
         }
-        this.requestCurrentChannel();
-        this.requestArpSteps();
-        this.requestCustomWaveform();
+        this.requestSettings();
       })
       .catch((err) => {
         const msg = err.message.includes('not supported') ? err.message : 'Cannot connect: ' + err.message;
@@ -254,6 +427,9 @@ class IcarusConfigApp extends HTMLElement {
     this.channelEditor?.classList[action]('hidden');
     this.arpEditor?.classList[action]('hidden');
     this.waveformEditor?.classList[action]('hidden');
+    this.voicePolicyEditor?.classList[action]('hidden');
+    this.patchFile?.classList[action]('hidden');
+    this.latencyChart?.classList[action]('hidden');
   }
 }
 
@@ -0,0 +1,166 @@
+import { LATENCY_STAGES } from '../constants.js';
+
+const CHART_BG = '#0f0f12';
+const CHART_BAR = '#7d9cd4';
+const CHART_GRID = '#2a2a32';
+const CHART_TEXT = '#8a8a94';
+const CHART_PADDING_PX = 16;
+const CHART_LABEL_HEIGHT_PX = 18;
+const CHART_FONT = '10px Consolas, monospace';
+
+/**
+ * Lower bound of a latency bin, in µs: bin 0 is 0, bin k starts at 2^(k-1).
+ * @param {number} bin
+ * @returns {number}
+ */
+function binFloor(bin) {
+  return bin === 0 ? 0 : 2 ** (bin - 1);
+}
+
+/**
+ * @param {number} us
+ * @returns {string}
+ */
+function formatMicros(us) {
+  if (us >= 1000) return `${(us / 1000).toFixed(us >= 10000 ? 0 : 1)} ms`;
+  return `${us} µs`;
+}
+
+class LatencyChart extends HTMLElement {
+  constructor() {
+    super();
+    /** @type {{ count: number, min: number, mean: number, max: number, bins: number[] }[]|null} */
+    this.data = null;
+    this.stageSelectEl = null;
+    this.summaryEl = null;
+    this.canvasEl = null;
+  }
+
+  connectedCallback() {
+    this.render();
+    this.cacheElements();
+    this.bindEvents();
+    this.resizeObserver = new ResizeObserver(() => this.draw());
+    if (this.canvasEl) this.resizeObserver.observe(this.canvasEl);
+  }
+
+  disconnectedCallback() {
+    this.resizeObserver?.disconnect();
+  }
+
+  render() {
+    this.innerHTML = `
+      <section class="mt-8 pt-6 border-t border-surface-border">
+        <h2 class="text-base font-semibold mb-1">Note latency</h2>
+        <p class="text-xs text-gray-500 mb-4 leading-relaxed">
+          Measured by the device on every note since the last reset. The device does not timestamp incoming MIDI bytes, so the time a message waits before it is read is not measured: the poll interval (time between the previous MIDI poll and the read) is an upper bound on it. Total latency is at most poll interval + dispatch → first sample, plus the audio output buffer.
+        </p>
+        <div class="flex flex-col gap-4">
+          <div class="flex flex-wrap items-end gap-2 md:gap-4">
+            <label class="flex flex-col gap-1">
+              <span class="text-[0.7rem] uppercase tracking-wider text-gray-500">Stage</span>
+              <select data-role="stage" class="py-1.5 px-2 text-sm rounded border border-surface-border bg-[#0f0f12] text-[#e8e6e3] focus:outline-none focus:border-accent">
+                ${LATENCY_STAGES.map((stage, i) => `<option value="${i}">${stage.label}</option>`).join('')}
+              </select>
+            </label>
+            <button type="button" data-role="refresh" class="py-1.5 px-3 text-sm rounded border border-surface-border bg-[#0f0f12] text-[#e8e6e3] hover:border-accent focus:outline-none focus:border-accent">Refresh</button>
+            <button type="button" data-role="reset" class="py-1.5 px-3 text-sm rounded border border-surface-border bg-[#0f0f12] text-[#e8e6e3] hover:border-accent focus:outline-none focus:border-accent">Reset</button>
+          </div>
+          <span class="text-xs text-gray-400" data-role="summary">—</span>
+          <canvas
+            data-role="chart"
+            class="block w-full min-w-0 h-48 rounded-lg border border-surface-border"
+            style="background: ${CHART_BG};"
+          ></canvas>
+        </div>
+      </section>
+    `;
+  }
+
+  cacheElements() {
+    this.stageSelectEl = this.querySelector('[data-role="stage"]');
+    this.summaryEl = this.querySelector('[data-role="summary"]');
+    this.canvasEl = this.querySelector('[data-role="chart"]');
+  }
+
+  bindEvents() {
+    this.stageSelectEl?.addEventListener('change', () => this.draw());
+    this.querySelector('[data-role="refresh"]')?.addEventListener('click', () => {
+      this.dispatchEvent(new CustomEvent('latency-refresh', { bubbles: true }));
+    });
+    this.querySelector('[data-role="reset"]')?.addEventListener('click', () => {
+      this.dispatchEvent(new CustomEvent('latency-reset', { bubbles: true }));
+    });
+  }
+
+  /**
+   * Update from device data (see parseLatencyFromSysex).
+   * @param {{ count: number, min: number, mean: number, max: number, bins: number[] }[]|null} data
+   */
+  setFromData(data) {
+    this.data = data;
+    this.draw();
+  }
+
+  draw() {
+    if (!this.canvasEl) return;
+    const rect = this.canvasEl.getBoundingClientRect();
+    if (rect.width <= 0) return;
+
+    const dpr = window.devicePixelRatio || 1;
+    const w = Math.max(1, Math.floor(rect.width * dpr));
+    const h = Math.max(1, Math.floor((rect.height || 192) * dpr));
+    if (this.canvasEl.width !== w || this.canvasEl.height !== h) {
+      this.canvasEl.width = w;
+      this.canvasEl.height = h;
+    }
+    const ctx = this.canvasEl.getContext('2d');
+    if (!ctx) return;
+    ctx.fillStyle = CHART_BG;
+    ctx.fillRect(0, 0, w, h);
+
+    const stageIndex = parseInt(this.stageSelectEl?.value ?? '0', 10);
+    const stage = this.data?.[stageIndex];
+    if (!stage) {
+      if (this.summaryEl) this.summaryEl.textContent = '—';
+      return;
+    }
+    if (this.summaryEl) {
+      this.summaryEl.textContent = stage.count
+        ? `${stage.count} notes · min ${formatMicros(stage.min)} · mean ${formatMicros(stage.mean)} · max ${formatMicros(stage.max)}`
+        : 'No notes recorded yet.';
+    }
+
+    const padding = Math.round(CHART_PADDING_PX * dpr);
+    const labelHeight = Math.round(CHART_LABEL_HEIGHT_PX * dpr);
+    const drawW = w - padding * 2;
+    const drawH = h - padding * 2 - labelHeight;
+    const bins = stage.bins.length;
+    const peak = Math.max(1, ...stage.bins);
+    const slot = drawW / bins;
+
+    ctx.strokeStyle = CHART_GRID;
+    ctx.lineWidth = Math.max(1, dpr);
+    ctx.beginPath();
+    ctx.moveTo(padding, padding + drawH);
+    ctx.lineTo(padding + drawW, padding + drawH);
+    ctx.stroke();
+
+    ctx.font = CHART_FONT.replace(/^\d+/, (size) => String(Math.round(size * dpr)));
+    ctx.textAlign = 'center';
+    ctx.textBaseline = 'top';
+    for (let b = 0; b < bins; b++) {
+      const x = padding + b * slot;
+      const barH = (stage.bins[b] / peak) * drawH;
+      ctx.fillStyle = CHART_BAR;
+      ctx.fillRect(x + slot * 0.15, padding + drawH - barH, slot * 0.7, barH);
+      // Every other label, so they fit on narrow screens
+      if (b % 2 === 0) {
+        ctx.fillStyle = CHART_TEXT;
+        ctx.fillText(formatMicros(binFloor(b)), x + slot / 2, padding + drawH + 4 * dpr);
+      }
+    }
+  }
+}
+
+customElements.define('latency-chart', LatencyChart);
@@ -0,0 +1,63 @@
+const BUTTON_CLASS = 'py-1.5 px-3 text-sm rounded border border-surface-border bg-[#0f0f12] text-[#e8e6e3] hover:border-accent focus:outline-none focus:border-accent';
+
+class PatchFile extends HTMLElement {
+  constructor() {
+    super();
+    this.fileInputEl = null;
+  }
+
+  connectedCallback() {
+    this.render();
+    this.cacheElements();
+    this.bindEvents();
+  }
+
+  render() {
+    this.innerHTML = `
+      <section class="mt-8 pt-6 border-t border-surface-border">
+        <h2 class="text-base font-semibold mb-1">Setup file</h2>
+        <p class="text-xs text-gray-500 mb-4 leading-relaxed">
+          Save the MIDI channel, arp steps, custom waveform and voice policy to a .syx file, or load one back in a single message. Calibration stays on the device.
+        </p>
+        <div class="flex flex-wrap items-end gap-2 md:gap-4">
+          <button type="button" data-role="save" class="${BUTTON_CLASS}">Save to file</button>
+          <button type="button" data-role="load" class="${BUTTON_CLASS}">Load from file</button>
+          <input type="file" data-role="file" accept=".syx,application/octet-stream" class="hidden" />
+        </div>
+      </section>
+    `;
+  }
+
+  cacheElements() {
+    this.fileInputEl = this.querySelector('[data-role="file"]');
+  }
+
+  bindEvents() {
+    this.querySelector('[data-role="save"]')?.addEventListener('click', () => {
+      this.dispatchEvent(new CustomEvent('patch-save', { bubbles: true }));
+    });
+    this.querySelector('[data-role="load"]')?.addEventListener('click', () => this.fileInputEl?.click());
+    this.fileInputEl?.addEventListener('change', async () => {
+      const file = this.fileInputEl.files?.[0];
+      this.fileInputEl.value = '';
+      if (!file) return;
+      const data = new Uint8Array(await file.arrayBuffer());
+      this.dispatchEvent(new CustomEvent('patch-load', { detail: { data }, bubbles: true }));
+    });
+  }
+
+  /**
+   * Download a patch dump as a .syx file.
+   * @param {Uint8Array} data
+   */
+  download(data) {
+    const url = URL.createObjectURL(new Blob([data], { type: 'application/octet-stream' }));
+    const link = document.createElement('a');
+    link.href = url;
+    link.download = 'icarus-setup.syx';
+    link.click();
+    URL.revokeObjectURL(url);
+  }
+}
+
+customElements.define('patch-file', PatchFile);
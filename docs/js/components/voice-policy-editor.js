@@ -0,0 +1,75 @@
+import { STEAL_POLICIES } from '../constants.js';
+
+const SELECT_STYLE =
+  'w-full min-w-0 py-1.5 px-2 text-sm bg-[#0f0f12] border border-surface-border rounded-lg text-[#e8e6e3] focus:outline-none focus:border-accent cursor-pointer';
+
+class VoicePolicyEditor extends HTMLElement {
+  constructor() {
+    super();
+    this.stealSelectEl = null;
+    this.retriggerEl = null;
+  }
+
+  connectedCallback() {
+    this.render();
+    this.cacheElements();
+    this.bindEvents();
+  }
+
+  render() {
+    const options = STEAL_POLICIES.map((policy) => `<option value="${policy.id}">${policy.label}</option>`).join('');
+    this.innerHTML = `
+      <section class="mt-8 pt-6 border-t border-surface-border">
+        <h2 class="text-base font-semibold mb-1">Poly voices</h2>
+        <p class="text-xs text-gray-500 mb-4 leading-relaxed">
+          Which held note gives its voice to a new one when every voice is busy, and whether a replayed note comes back on its own voice.
+        </p>
+        <div class="flex flex-wrap items-end gap-2 md:gap-4">
+          <div class="flex flex-col gap-1">
+            <label for="voice-steal-policy" class="text-[0.7rem] uppercase tracking-wider text-gray-500">Voice stealing</label>
+            <select id="voice-steal-policy" data-role="steal" class="${SELECT_STYLE}">${options}</select>
+          </div>
+          <label class="flex items-center gap-2 py-1.5 text-sm">
+            <input type="checkbox" data-role="retrigger" class="accent-accent" />
+            Retrigger same note
+          </label>
+        </div>
+      </section>
+    `;
+  }
+
+  cacheElements() {
+    this.stealSelectEl = this.querySelector('[data-role="steal"]');
+    this.retriggerEl = this.querySelector('[data-role="retrigger"]');
+  }
+
+  bindEvents() {
+    this.stealSelectEl?.addEventListener('change', () => this.emitChange());
+    this.retriggerEl?.addEventListener('change', () => this.emitChange());
+  }
+
+  emitChange() {
+    if (!this.stealSelectEl || !this.retriggerEl) return;
+    this.dispatchEvent(
+      new CustomEvent('voice-policy-change', {
+        detail: {
+          stealPolicy: Number(this.stealSelectEl.value),
+          retriggerSameNote: this.retriggerEl.checked,
+        },
+        bubbles: true,
+      }),
+    );
+  }
+
+  /**
+   * Show the policy read from the device, without sending it back.
+   * @param {{ stealPolicy: number, retriggerSameNote: boolean }} policy
+   */
+  setFromData(policy) {
+    if (!this.stealSelectEl || !this.retriggerEl || !policy) return;
+    this.stealSelectEl.value = String(policy.stealPolicy);
+    this.retriggerEl.checked = policy.retriggerSameNote;
+  }
+}
+
+customElements.define('voice-policy-editor', VoicePolicyEditor);
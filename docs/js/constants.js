@@ -28,5 +28,42 @@ export const CUSTOM_WAVEFORM_BANKS = [
   { id: 2, label: 'Overtone', count: 44 },
 ];
 
+/** Poly voice policy: get F0 7D 00 13 F7; reply F0 7D 00 14 policy retrigger F7; set F0 7D 00 15 policy retrigger F7. Retrigger: 0 or 1. */
+export const SYSEX_VOICE_POLICY_GET_REQUEST = new Uint8Array([0xf0, 0x7d, 0x00, 0x13, 0xf7]);
+export const SYSEX_VOICE_POLICY_REPLY_CMD = 0x14;
+export const SYSEX_VOICE_POLICY_SET_CMD = 0x15;
+
+/** Which held voice a new poly note takes when all are busy (must match firmware VoiceAllocator::StealPolicy). */
+export const STEAL_POLICIES = [
+  { id: 0, label: 'Oldest note' },
+  { id: 1, label: 'Quietest note' },
+  { id: 2, label: 'None (drop the new note)' },
+];
+
 /** JSON waveform data files (one per bank), relative to docs. */
 export const WAVEFORM_JSON_FILES = ['fmsynth', 'granular', 'overtone'];
+
+/** Note latency: get F0 7D 00 0A F7; reply F0 7D 00 0B [stages][bins] then per stage [count][min][mean][max][bins x value] F7 (each value 3 bytes, 21 bits LSB first, µs); reset F0 7D 00 0C F7. */
+export const SYSEX_LATENCY_GET_REQUEST = new Uint8Array([0xf0, 0x7d, 0x00, 0x0a, 0xf7]);
+export const SYSEX_LATENCY_REPLY_CMD = 0x0b;
+export const SYSEX_LATENCY_RESET_REQUEST = new Uint8Array([0xf0, 0x7d, 0x00, 0x0c, 0xf7]);
+
+/** Latency stages, in reply order (must match firmware NoteLatency::Stage). */
+export const LATENCY_STAGES = [
+  { id: 'poll', label: 'Poll interval (bounds input wait)' },
+  { id: 'state', label: 'Dispatch → note on' },
+  { id: 'envelope', label: 'Dispatch → first sample' },
+];
+
+/** Error reply to any request: F0 7D 00 7F [command] [error] F7. */
+export const SYSEX_ERROR_REPLY_CMD = 0x7f;
+
+/**
+ * Patch: get F0 7D 00 11 F7; dump F0 7D 00 12 [packed patch][checksum] F7, sent by the device as the reply and to it to load every setting at once.
+ * The patch is [format] then sections of [id][size][data], packed 7 bits per byte (an MSB byte before each group of 7); the checksum brings the sum of the payload to 0 mod 128.
+ */
+export const SYSEX_PATCH_GET_CMD = 0x11;
+export const SYSEX_PATCH_GET_REQUEST = new Uint8Array([0xf0, 0x7d, 0x00, SYSEX_PATCH_GET_CMD, 0xf7]);
+export const SYSEX_PATCH_DUMP_CMD = 0x12;
+export const SYSEX_PATCH_FORMAT = 1;
+export const SYSEX_PATCH_SECTIONS = { channel: 1, arpSteps: 2, customWaveform: 3, voicePolicy: 4 };
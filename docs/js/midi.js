@@ -11,6 +11,18 @@ import {
   SYSEX_CUSTOM_WAVEFORM_GET_REQUEST,
   SYSEX_CUSTOM_WAVEFORM_REPLY_CMD,
   SYSEX_CUSTOM_WAVEFORM_SET_CMD,
+  SYSEX_VOICE_POLICY_GET_REQUEST,
+  SYSEX_VOICE_POLICY_REPLY_CMD,
+  SYSEX_VOICE_POLICY_SET_CMD,
+  STEAL_POLICIES,
+  SYSEX_LATENCY_GET_REQUEST,
+  SYSEX_LATENCY_REPLY_CMD,
+  SYSEX_LATENCY_RESET_REQUEST,
+  SYSEX_ERROR_REPLY_CMD,
+  SYSEX_PATCH_GET_REQUEST,
+  SYSEX_PATCH_DUMP_CMD,
+  SYSEX_PATCH_FORMAT,
+  SYSEX_PATCH_SECTIONS,
 } from './constants.js';
 
 // ——— Web MIDI API ———
@@ -142,3 +154,188 @@ export function buildSetCustomWaveformSysex(bank, index) {
     bank & 0xff, index & 0xff, 0xf7,
   ]);
 }
+
+export function buildGetVoicePolicySysex() {
+  return SYSEX_VOICE_POLICY_GET_REQUEST;
+}
+
+/**
+ * Parse voice policy reply: F0 7D 00 14 policy retrigger F7.
+ * Returns { stealPolicy, retriggerSameNote } or null.
+ */
+export function parseVoicePolicyFromSysex(data) {
+  if (!data || data.length !== 7) return null;
+  if (data[0] !== 0xf0 || data[1] !== 0x7d || data[2] !== 0x00 ||
+      data[3] !== SYSEX_VOICE_POLICY_REPLY_CMD || data[6] !== 0xf7) return null;
+  if (data[4] >= STEAL_POLICIES.length || data[5] > 1) return null;
+  return { stealPolicy: data[4], retriggerSameNote: data[5] === 1 };
+}
+
+/**
+ * Build set voice policy Sysex: F0 7D 00 15 policy retrigger F7.
+ * @param {number} stealPolicy - 0=oldest, 1=quietest, 2=none
+ * @param {boolean} retriggerSameNote
+ */
+export function buildSetVoicePolicySysex(stealPolicy, retriggerSameNote) {
+  if (stealPolicy < 0 || stealPolicy >= STEAL_POLICIES.length) return null;
+  return new Uint8Array([
+    0xf0, 0x7d, 0x00, SYSEX_VOICE_POLICY_SET_CMD,
+    stealPolicy, retriggerSameNote ? 1 : 0, 0xf7,
+  ]);
+}
+
+export function buildGetLatencySysex() {
+  return SYSEX_LATENCY_GET_REQUEST;
+}
+
+export function buildResetLatencySysex() {
+  return SYSEX_LATENCY_RESET_REQUEST;
+}
+
+/** 3 SysEx data bytes, LSB first → 21-bit value. */
+function readSysexValue(data, off) {
+  return data[off] | (data[off + 1] << 7) | (data[off + 2] << 14);
+}
+
+/**
+ * Parse note latency reply: F0 7D 00 0B [stages][bins] then per stage
+ * [count][min][mean][max][bins x value] F7, values in µs (3 bytes each).
+ * Bin 0 counts 0 µs, bin k counts [2^(k-1), 2^k) µs, the last bin the rest.
+ * Returns [{ count, min, mean, max, bins: number[] }, ...] or null.
+ */
+export function parseLatencyFromSysex(data) {
+  if (!data || data.length < 7) return null;
+  if (data[0] !== 0xf0 || data[1] !== 0x7d || data[2] !== 0x00 || data[3] !== SYSEX_LATENCY_REPLY_CMD || data[data.length - 1] !== 0xf7) return null;
+  const stages = data[4];
+  const bins = data[5];
+  if (data.length !== 7 + stages * (4 + bins) * 3) return null;
+  const result = [];
+  let off = 6;
+  for (let s = 0; s < stages; s++) {
+    const stage = {
+      count: readSysexValue(data, off),
+      min: readSysexValue(data, off + 3),
+      mean: readSysexValue(data, off + 6),
+      max: readSysexValue(data, off + 9),
+      bins: [],
+    };
+    off += 12;
+    for (let b = 0; b < bins; b++) {
+      stage.bins.push(readSysexValue(data, off));
+      off += 3;
+    }
+    result.push(stage);
+  }
+  return result;
+}
+
+/**
+ * Parse an error reply: F0 7D 00 7F [command] [error] F7.
+ * Returns { command, error } or null.
+ */
+export function parseErrorFromSysex(data) {
+  if (!data || data.length !== 7) return null;
+  if (data[0] !== 0xf0 || data[1] !== 0x7d || data[2] !== 0x00 || data[3] !== SYSEX_ERROR_REPLY_CMD || data[6] !== 0xf7) return null;
+  return { command: data[4], error: data[5] };
+}
+
+export function buildGetPatchSysex() {
+  return SYSEX_PATCH_GET_REQUEST;
+}
+
+/** 8-bit bytes → 7-bit bytes: before each group of 7, a byte with their MSBs (bit i for byte i). */
+function pack7(raw) {
+  const out = [];
+  for (let g = 0; g < raw.length; g += 7) {
+    const group = raw.slice(g, g + 7);
+    out.push(group.reduce((msbs, byte, i) => msbs | ((byte >> 7) << i), 0));
+    for (const byte of group) out.push(byte & 0x7f);
+  }
+  return out;
+}
+
+/** Inverse of pack7(); null if the size cannot come from pack7(). */
+function unpack7(packed) {
+  if (packed.length % 8 === 1) return null;
+  const raw = [];
+  for (let g = 0; g < packed.length; g += 8) {
+    const msbs = packed[g];
+    for (let i = 0; i < 7 && g + 1 + i < packed.length; i++) {
+      raw.push((packed[g + 1 + i] & 0x7f) | (((msbs >> i) & 1) << 7));
+    }
+  }
+  return raw;
+}
+
+/**
+ * Parse a patch dump: F0 7D 00 12 [packed patch][checksum] F7.
+ * Returns { channel, arpSteps, customWaveform, voicePolicy }, each null when the dump has no such section, or null if the dump is invalid.
+ */
+export function parsePatchFromSysex(data) {
+  if (!data || data.length < 7) return null;
+  if (data[0] !== 0xf0 || data[1] !== 0x7d || data[2] !== 0x00 || data[3] !== SYSEX_PATCH_DUMP_CMD || data[data.length - 1] !== 0xf7) return null;
+  const payload = Array.from(data.slice(4, data.length - 1));
+  if (payload.reduce((sum, byte) => sum + byte, 0) % 128 !== 0) return null;
+  const raw = unpack7(payload.slice(0, -1));
+  if (!raw || raw[0] !== SYSEX_PATCH_FORMAT) return null;
+
+  const patch = { channel: null, arpSteps: null, customWaveform: null, voicePolicy: null };
+  let off = 1;
+  while (off < raw.length) {
+    const id = raw[off];
+    const size = raw[off + 1];
+    if (size == null || off + 2 + size > raw.length) return null;
+    const section = raw.slice(off + 2, off + 2 + size);
+    off += 2 + size;
+    if (id === SYSEX_PATCH_SECTIONS.channel && size === 1 && section[0] <= 15) {
+      patch.channel = section[0] + 1;
+    } else if (id === SYSEX_PATCH_SECTIONS.arpSteps && size === SYSEX_ARP_NUM_MODES * (1 + SYSEX_ARP_MAX_STEPS)) {
+      patch.arpSteps = [];
+      for (let m = 0; m < SYSEX_ARP_NUM_MODES; m++) {
+        const base = m * (1 + SYSEX_ARP_MAX_STEPS);
+        const len = Math.min(section[base], SYSEX_ARP_MAX_STEPS);
+        patch.arpSteps.push(section.slice(base + 1, base + 1 + len));
+      }
+    } else if (id === SYSEX_PATCH_SECTIONS.customWaveform && size === 2 && section[0] <= 2) {
+      patch.customWaveform = { bank: section[0], index: section[1] };
+    } else if (id === SYSEX_PATCH_SECTIONS.voicePolicy && size === 2 && section[0] < STEAL_POLICIES.length && section[1] <= 1) {
+      patch.voicePolicy = { stealPolicy: section[0], retriggerSameNote: section[1] === 1 };
+    }
+    // Other sections come from a newer firmware; skip them.
+  }
+  return patch;
+}
+
+/**
+ * Build a patch dump that loads every given setting at once; null settings are left as they are on the device.
+ * @param {{ channel: number|null, arpSteps: number[][]|null, customWaveform: { bank: number, index: number }|null, voicePolicy: { stealPolicy: number, retriggerSameNote: boolean }|null }} patch
+ */
+export function buildPatchSysex(patch) {
+  const raw = [SYSEX_PATCH_FORMAT];
+  if (patch.channel != null) {
+    if (patch.channel < 1 || patch.channel > 16) return null;
+    raw.push(SYSEX_PATCH_SECTIONS.channel, 1, patch.channel - 1);
+  }
+  if (patch.arpSteps != null) {
+    raw.push(SYSEX_PATCH_SECTIONS.arpSteps, SYSEX_ARP_NUM_MODES * (1 + SYSEX_ARP_MAX_STEPS));
+    for (let m = 0; m < SYSEX_ARP_NUM_MODES; m++) {
+      const steps = (patch.arpSteps[m] ?? []).slice(0, SYSEX_ARP_MAX_STEPS);
+      raw.push(steps.length);
+      for (let i = 0; i < SYSEX_ARP_MAX_STEPS; i++) raw.push(i < steps.length ? steps[i] & 0xff : 0);
+    }
+  }
+  if (patch.customWaveform != null) {
+    const { bank, index } = patch.customWaveform;
+    if (bank < 0 || bank > 2 || index < 0 || index > 0xff) return null;
+    raw.push(SYSEX_PATCH_SECTIONS.customWaveform, 2, bank, index);
+  }
+  if (patch.voicePolicy != null) {
+    const { stealPolicy, retriggerSameNote } = patch.voicePolicy;
+    if (stealPolicy < 0 || stealPolicy >= STEAL_POLICIES.length) return null;
+    raw.push(SYSEX_PATCH_SECTIONS.voicePolicy, 2, stealPolicy, retriggerSameNote ? 1 : 0);
+  }
+  const payload = pack7(raw);
+  const sum = payload.reduce((acc, byte) => acc + byte, 0);
+  payload.push((128 - (sum % 128)) % 128);
+  return new Uint8Array([0xf0, 0x7d, 0x00, SYSEX_PATCH_DUMP_CMD, ...payload, 0xf7]);
+}
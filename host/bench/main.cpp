@@ -0,0 +1,796 @@
+/**
+ * Audio graph benchmark: builds the graph of Autosave::Audio on the host
+ * stand-in and reports what every node costs per 128-sample block, for each
+ * waveform mode with FM on and off, with idle voices, and with every voice in
+ * one spread unison stack (voice bank only). The patch-cord graph
+ * Audio used before the voice bank is measured alongside, as a reference.
+ *
+ * Costs are host cycles (steady clock scaled to F_CPU_ACTUAL), with the timer
+ * overhead measured on empty nodes and subtracted. They are not Teensy cycles:
+ * use them to compare nodes with each other and firmware versions with each
+ * other (--save / --compare), not as an absolute CPU load.
+ *
+ * The poly voice allocator is timed the same way, per batch of note events
+ * from a fast chord run that keeps every voice busy, and so is the control
+ * scan (Hardware::update() plus the changed-mask test of a state), per batch
+ * of main loop passes with the panel idle, a pot turning or a switch
+ * flipping.
+ *
+ * Usage: program [--voices N] [--blocks N] [--runs N] [--save file]
+ *                [--compare file] [--tolerance percent]
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Audio.h"
+#include "TeensyHost.h"
+#include "core/Audio.h"
+#include "core/EnvelopeGenerator.h"
+#include "core/Hardware.h"
+#include "core/VoiceAllocator.h"
+#include "waveforms/Waveforms.h"
+
+namespace {
+
+constexpr uint32_t kWarmupBlocks = 64;
+constexpr uint32_t kDefaultBlocks = 2000;
+constexpr uint32_t kDefaultRuns = 5;
+constexpr uint8_t kMaxVoices = 16; // one level of submixers into mixer_master
+constexpr double kDefaultTolerancePercent = 10.0;
+// Nodes cheaper than this are timer noise; --compare ignores them.
+constexpr double kCompareFloorCycles = 200.0;
+
+// Allocator run: notes drawn from a pool larger than the voice count, so
+// stealing happens; a released voice stays audible for this many events.
+constexpr uint32_t kAllocatorEvents = 200000;
+constexpr uint32_t kAllocatorBatch = 64; // events per reported cost
+constexpr uint8_t kAllocatorNotePool = 24;
+constexpr uint32_t kAllocatorReleaseEvents = 6;
+
+// Control scan run: main loop passes kScanPeriodNs apart, so the scanner
+// completes a frame every few passes, as on the Teensy.
+constexpr uint32_t kScanLoops = 200000;
+constexpr uint32_t kScanBatch = 64; // loop passes per reported cost
+constexpr uint64_t kScanPeriodNs = 10000;
+constexpr uint32_t kScanPotPeriodLoops = 4000;    // a full pot sweep
+constexpr uint32_t kScanSwitchPeriodLoops = 20000; // 200 ms per position
+
+// Same settings as Audio::begin() and the panel defaults.
+constexpr float kLfoFmFrequency = 20.0f;
+constexpr float kLfoFmAmplitude = 0.5f;
+constexpr float kOscMixGain = 0.25f;
+constexpr float kFilterEnvGain = 0.5f;
+constexpr float kBaseFrequency = 110.0f;
+constexpr int kCustomWaveformIndex = 42;
+constexpr float kUnisonSpreadCents = 25.0f;
+
+struct Scenario {
+  const char *name;
+  short waveform;
+  bool fm;
+  bool notes;
+  bool unison; // one note on every voice, spread
+};
+
+const Scenario kScenarios[] = {
+    {"idle", WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE, false, false, false},
+    {"saw", WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE, false, true, false},
+    {"saw+fm", WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE, true, true, false},
+    {"saw+unison", WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE, false, true, true},
+    {"square", WAVEFORM_BANDLIMIT_SQUARE, false, true, false},
+    {"square+fm", WAVEFORM_BANDLIMIT_SQUARE, true, true, false},
+    {"arbitrary", WAVEFORM_ARBITRARY, false, true, false},
+    {"arbitrary+fm", WAVEFORM_ARBITRARY, true, true, false},
+};
+
+struct NodeGroup {
+  const char *name;
+  std::vector<AudioStream *> nodes;
+  bool per_voice;
+};
+
+struct Result {
+  std::string name;
+  double cycles;
+  bool per_voice;
+};
+
+/** Empty node, used to measure the cost of timing a node. */
+class AudioNull : public AudioStream {
+public:
+  AudioNull() : AudioStream(1, inputQueueArray) {}
+
+private:
+  audio_block_t *inputQueueArray[1];
+  void update(void) override {}
+};
+
+/** A graph under test: the nodes of Autosave::Audio, in its update order. */
+class BenchGraph {
+public:
+  virtual ~BenchGraph() = default;
+
+  virtual const char *name() const = 0;
+  virtual void configure(const Scenario &scenario) = 0;
+  virtual std::vector<NodeGroup> groups() = 0;
+
+protected:
+  std::vector<std::unique_ptr<AudioConnection>> patch_cords_;
+
+  void connect(AudioStream &source, unsigned char output,
+               AudioStream &destination, unsigned char input) {
+    patch_cords_.emplace_back(
+        new AudioConnection(source, output, destination, input));
+  }
+
+  static float waveformGain(short waveform) {
+    if (waveform == WAVEFORM_BANDLIMIT_SQUARE) {
+      return kOscMixGain * 0.75f;
+    }
+    if (waveform == WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE) {
+      return kOscMixGain * 0.85f;
+    }
+    return kOscMixGain;
+  }
+
+  // A chord spread over the keyboard, so no two voices share a phase.
+  static float voiceFrequency(uint8_t voice) {
+    return kBaseFrequency * powf(2.0f, voice * 5 / 12.0f);
+  }
+
+  static void configureFilterPath(AudioSynthWaveformDc &dc_signal,
+                                  AudioEffectEnvelope &filter_envelope,
+                                  const Scenario &scenario) {
+    dc_signal.amplitude(kFilterEnvGain);
+    filter_envelope.attack(1.0f);
+    filter_envelope.hold(0);
+    filter_envelope.decay(0);
+    filter_envelope.sustain(1.0f);
+    filter_envelope.release(15.0f);
+    if (scenario.notes) {
+      filter_envelope.noteOn();
+    }
+  }
+
+  static void configureFilterPath(Autosave::EnvelopeGenerator &filter_envelope,
+                                  const Scenario &scenario) {
+    filter_envelope.amplitude(kFilterEnvGain);
+    filter_envelope.attack(1.0f);
+    filter_envelope.hold(0);
+    filter_envelope.decay(0);
+    filter_envelope.sustain(1.0f);
+    filter_envelope.release(15.0f);
+    if (scenario.notes) {
+      filter_envelope.noteOn(1.0f);
+    }
+  }
+};
+
+/**
+ * The patch-cord graph Audio used before the voice bank (oscillators,
+ * envelopes, mixer tree, master amplifier), with a variable number of voices.
+ * Kept as the reference the fused graph is measured against.
+ */
+class PatchGraph : public BenchGraph {
+public:
+  explicit PatchGraph(uint8_t voices)
+      : voices_(voices),
+        oscillators_(new AudioSynthWaveformModulated[voices]),
+        envelopes_(new AudioEffectEnvelope[voices]),
+        submixers_((voices + 3) / 4), mixers_(new AudioMixer4[submixers_]) {
+    for (uint8_t i = 0; i < voices_; i++) {
+      connect(lfo_fm_, 0, oscillators_[i], 0);
+    }
+    for (uint8_t i = 0; i < voices_; i++) {
+      connect(oscillators_[i], 0, envelopes_[i], 0);
+    }
+    for (uint8_t i = 0; i < voices_; i++) {
+      connect(envelopes_[i], 0, mixers_[i / 4], i % 4);
+    }
+    for (uint8_t i = 0; i < submixers_; i++) {
+      connect(mixers_[i], 0, mixer_master_, i);
+    }
+    connect(mixer_master_, 0, amplifier_master_, 0);
+    connect(amplifier_master_, 0, i2s1_, 1);
+    connect(dc_signal_, 0, filter_envelope_, 0);
+    connect(filter_envelope_, 0, i2s1_, 0);
+  }
+
+  // Disconnect before the nodes go away.
+  ~PatchGraph() override { patch_cords_.clear(); }
+
+  const char *name() const override { return "patch"; }
+
+  void configure(const Scenario &scenario) override {
+    lfo_fm_.frequency(kLfoFmFrequency);
+    lfo_fm_.amplitude(scenario.fm ? kLfoFmAmplitude : 0.0f);
+
+    for (uint8_t i = 0; i < voices_; i++) {
+      oscillators_[i].begin(scenario.waveform);
+      oscillators_[i].arbitraryWaveform(
+          Autosave::AKWF_OVERTONE[kCustomWaveformIndex], 172.0f);
+      oscillators_[i].frequency(voiceFrequency(i));
+      oscillators_[i].amplitude(1.0f);
+
+      envelopes_[i].attack(1.0f);
+      envelopes_[i].hold(0);
+      envelopes_[i].decay(0);
+      envelopes_[i].sustain(1.0f);
+      envelopes_[i].release(15.0f);
+      if (scenario.notes) {
+        envelopes_[i].noteOn();
+      }
+
+      mixers_[i / 4].gain(i % 4, waveformGain(scenario.waveform));
+    }
+    for (uint8_t i = 0; i < submixers_; i++) {
+      mixer_master_.gain(i, 1.0f / submixers_);
+    }
+    amplifier_master_.gain(Autosave::audio_config::master_gain);
+
+    configureFilterPath(dc_signal_, filter_envelope_, scenario);
+  }
+
+  std::vector<NodeGroup> groups() override {
+    std::vector<NodeGroup> groups = {
+        {"lfo_fm", {&lfo_fm_}, false},
+        {"oscillators", {}, true},
+        {"envelopes", {}, true},
+        {"mixers", {}, false},
+        {"mixer_master", {&mixer_master_}, false},
+        {"amplifier_master", {&amplifier_master_}, false},
+        {"dc_signal", {&dc_signal_}, false},
+        {"filter_envelope", {&filter_envelope_}, false},
+        {"i2s1", {&i2s1_}, false},
+    };
+    for (uint8_t i = 0; i < voices_; i++) {
+      groups[1].nodes.push_back(&oscillators_[i]);
+      groups[2].nodes.push_back(&envelopes_[i]);
+    }
+    for (uint8_t i = 0; i < submixers_; i++) {
+      groups[3].nodes.push_back(&mixers_[i]);
+    }
+    return groups;
+  }
+
+private:
+  const uint8_t voices_;
+
+  // Declaration order is construction order, i.e. the update order.
+  AudioSynthWaveformSine lfo_fm_;
+  std::unique_ptr<AudioSynthWaveformModulated[]> oscillators_;
+  std::unique_ptr<AudioEffectEnvelope[]> envelopes_;
+  const uint8_t submixers_;
+  std::unique_ptr<AudioMixer4[]> mixers_;
+  AudioMixer4 mixer_master_;
+  AudioAmplifier amplifier_master_;
+  AudioSynthWaveformDc dc_signal_;
+  AudioEffectEnvelope filter_envelope_;
+  AudioOutputI2S i2s1_;
+};
+
+/** The graph Audio uses: every voice rendered by one VoiceBank. */
+class VoiceBankGraph : public BenchGraph {
+public:
+  VoiceBankGraph() {
+    connect(lfo_fm_, 0, voice_bank_, 0);
+    connect(voice_bank_, 0, i2s1_, 1);
+    connect(filter_envelope_, 0, i2s1_, 0);
+  }
+
+  // Disconnect before the nodes go away.
+  ~VoiceBankGraph() override { patch_cords_.clear(); }
+
+  const char *name() const override { return "bank"; }
+
+  void configure(const Scenario &scenario) override {
+    lfo_fm_.frequency(kLfoFmFrequency);
+    lfo_fm_.amplitude(scenario.fm ? kLfoFmAmplitude : 0.0f);
+
+    voice_bank_.waveform(scenario.waveform);
+    voice_bank_.arbitraryWaveform(
+        Autosave::AKWF_OVERTONE[kCustomWaveformIndex]);
+    voice_bank_.attack(1.0f);
+    voice_bank_.hold(0);
+    voice_bank_.decay(0);
+    voice_bank_.sustain(1.0f);
+    voice_bank_.release(15.0f);
+    for (uint8_t i = 0; i < kVoices; i++) {
+      voice_bank_.frequency(i, voiceFrequency(i));
+      voice_bank_.amplitude(i, 1.0f);
+      voice_bank_.gain(i, waveformGain(scenario.waveform) * 0.5f);
+      if (scenario.notes) {
+        voice_bank_.noteOn(i);
+      }
+    }
+    if (scenario.unison) {
+      voice_bank_.frequency(0, kVoices, kBaseFrequency);
+      voice_bank_.spread(0, kVoices, kUnisonSpreadCents);
+    }
+    voice_bank_.masterGain(Autosave::audio_config::master_gain);
+
+    configureFilterPath(filter_envelope_, scenario);
+  }
+
+  std::vector<NodeGroup> groups() override {
+    return {
+        {"lfo_fm", {&lfo_fm_}, false},
+        {"voice_bank", {&voice_bank_}, true},
+        {"filter_envelope", {&filter_envelope_}, false},
+        {"i2s1", {&i2s1_}, false},
+    };
+  }
+
+  static constexpr uint8_t kVoices = Autosave::audio_config::voices_number;
+
+private:
+  AudioSynthWaveformSine lfo_fm_;
+  Autosave::VoiceBank<kVoices> voice_bank_;
+  Autosave::EnvelopeGenerator filter_envelope_;
+  AudioOutputI2S i2s1_;
+};
+
+double meanCycles(const AudioStream *node) {
+  return node->host_updates == 0
+             ? 0.0
+             : (double)node->host_cycles / node->host_updates;
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+/** Median over runs of the mean cost of each node, in cycles per block. */
+std::vector<std::vector<double>>
+measure(const std::vector<std::vector<AudioStream *>> &nodes, uint32_t blocks,
+        uint32_t runs) {
+  for (uint32_t b = 0; b < kWarmupBlocks; b++) {
+    TeensyHost::updateAudio();
+  }
+
+  std::vector<std::vector<std::vector<double>>> samples(nodes.size());
+  for (size_t g = 0; g < nodes.size(); g++) {
+    samples[g].resize(nodes[g].size());
+  }
+  for (uint32_t r = 0; r < runs; r++) {
+    for (const auto &group : nodes) {
+      for (AudioStream *node : group) {
+        node->hostCyclesReset();
+      }
+    }
+    for (uint32_t b = 0; b < blocks; b++) {
+      TeensyHost::updateAudio();
+    }
+    for (size_t g = 0; g < nodes.size(); g++) {
+      for (size_t n = 0; n < nodes[g].size(); n++) {
+        samples[g][n].push_back(meanCycles(nodes[g][n]));
+      }
+    }
+  }
+
+  std::vector<std::vector<double>> medians(nodes.size());
+  for (size_t g = 0; g < nodes.size(); g++) {
+    for (const auto &node_samples : samples[g]) {
+      medians[g].push_back(median(node_samples));
+    }
+  }
+  return medians;
+}
+
+double measureTimerOverhead(uint32_t blocks, uint32_t runs) {
+  AudioNull source;
+  AudioNull sink;
+  AudioConnection cord(source, 0, sink, 0);
+  auto medians = measure({{&source, &sink}}, blocks, runs);
+  return std::min(medians[0][0], medians[0][1]);
+}
+
+std::vector<Result> runScenario(BenchGraph &graph, const Scenario &scenario,
+                                uint32_t blocks, uint32_t runs,
+                                double overhead, unsigned *memory_max) {
+  graph.configure(scenario);
+  AudioMemoryUsageMaxReset();
+
+  std::vector<NodeGroup> groups = graph.groups();
+  std::vector<std::vector<AudioStream *>> nodes;
+  for (const NodeGroup &group : groups) {
+    nodes.push_back(group.nodes);
+  }
+  auto medians = measure(nodes, blocks, runs);
+  *memory_max = AudioMemoryUsageMax();
+
+  std::vector<Result> results;
+  for (size_t g = 0; g < groups.size(); g++) {
+    double cycles = 0.0;
+    for (double node_cycles : medians[g]) {
+      cycles += std::max(0.0, node_cycles - overhead);
+    }
+    results.push_back({groups[g].name, cycles, groups[g].per_voice});
+  }
+  return results;
+}
+
+void printScenario(const std::string &label, uint8_t voices,
+                   unsigned memory_max, const std::vector<Result> &results) {
+  double total = 0.0;
+  for (const Result &r : results) {
+    total += r.cycles;
+  }
+  printf("\n%s (%u voices, audio memory %u blocks max)\n", label.c_str(),
+         voices, memory_max);
+  printf("  %-18s %12s %10s %7s\n", "node", "cycles/block", "per voice",
+         "share");
+  for (const Result &r : results) {
+    char per_voice[16] = "-";
+    if (r.per_voice) {
+      snprintf(per_voice, sizeof(per_voice), "%.0f", r.cycles / voices);
+    }
+    printf("  %-18s %12.0f %10s %6.1f%%\n", r.name.c_str(), r.cycles,
+           per_voice, total > 0.0 ? r.cycles * 100.0 / total : 0.0);
+  }
+  printf("  %-18s %12.0f %10.0f\n", "total", total, total / voices);
+}
+
+using Baseline = std::map<std::string, double>;
+
+bool loadBaseline(const std::string &path, Baseline *baseline) {
+  std::ifstream in(path);
+  if (!in) {
+    return false;
+  }
+  std::string scenario, node;
+  double cycles;
+  while (in >> scenario >> node >> cycles) {
+    (*baseline)[scenario + " " + node] = cycles;
+  }
+  return true;
+}
+
+using Allocator =
+    Autosave::VoiceAllocator<Autosave::audio_config::voices_number>;
+
+/** Stand-in for the voice bank's envelopes: audible until a deadline. */
+struct ReleaseClock {
+  uint32_t now = 0;
+  uint32_t release_end[Autosave::audio_config::voices_number] = {};
+
+  static bool active(uint8_t voice, void *ctx) {
+    const auto *clock = static_cast<const ReleaseClock *>(ctx);
+    return clock->now < clock->release_end[voice];
+  }
+};
+
+struct NoteEvent {
+  uint8_t note;
+  uint8_t velocity; // 0: note off
+};
+
+std::vector<NoteEvent> allocatorEvents() {
+  std::vector<NoteEvent> events;
+  bool held[kAllocatorNotePool] = {};
+  uint32_t state = 1;
+  for (uint32_t i = 0; i < kAllocatorEvents; i++) {
+    state = state * 1664525u + 1013904223u; // LCG, reproducible
+    const uint8_t slot = (state >> 8) % kAllocatorNotePool;
+    const uint8_t velocity = held[slot] ? 0 : 1 + (state >> 20) % 127;
+    held[slot] = !held[slot];
+    events.push_back({(uint8_t)(48 + slot), velocity});
+  }
+  return events;
+}
+
+/** Median over runs of the cost of kAllocatorBatch events, in cycles. */
+double measureAllocator(Allocator::StealPolicy policy,
+                        const std::vector<NoteEvent> &events, uint32_t runs,
+                        uint32_t *stolen) {
+  std::vector<double> samples;
+  for (uint32_t r = 0; r < runs; r++) {
+    Allocator allocator;
+    ReleaseClock clock;
+    allocator.setActivityQuery(&ReleaseClock::active, &clock);
+    allocator.setStealPolicy(policy);
+
+    uint32_t checksum = 0;
+    const uint64_t start = TeensyHost::wallNanos();
+    for (const NoteEvent &event : events) {
+      clock.now++;
+      if (event.velocity == 0) {
+        const uint8_t voice = allocator.noteOff(event.note);
+        if (voice != Allocator::kNoVoice) {
+          clock.release_end[voice] = clock.now + kAllocatorReleaseEvents;
+        }
+        checksum += voice;
+      } else {
+        const uint8_t voice = allocator.noteOn(event.note, event.velocity);
+        if (voice != Allocator::kNoVoice) {
+          clock.release_end[voice] = UINT32_MAX;
+        }
+        checksum += voice;
+      }
+    }
+    const double ns = (double)(TeensyHost::wallNanos() - start);
+    volatile uint32_t sink = checksum; // keep the loop
+    (void)sink;
+    *stolen = allocator.stolenCount();
+    samples.push_back(ns * (F_CPU_ACTUAL / 1e9) * kAllocatorBatch /
+                      events.size());
+  }
+  return median(samples);
+}
+
+enum ScanScenario { SCAN_IDLE, SCAN_POT, SCAN_SWITCH };
+
+/**
+ * Median over runs of the cost of kScanBatch loop passes: scan, then test the
+ * mask and read the values that changed, as Synth::process() and the states
+ * do. Virtual time moves between passes, outside the timed region, and the
+ * cost of reading the clock is subtracted.
+ */
+double measureControlScan(Autosave::Hardware *panel, ScanScenario scenario,
+                          uint32_t runs, uint32_t *changes) {
+  using namespace Autosave::hardware;
+  std::vector<double> samples;
+  for (uint32_t r = 0; r < runs; r++) {
+    TeensyHost::setAnalogPin(PIN_POT_1, 0);
+    TeensyHost::setDigitalPin(PIN_SW_2_1, HIGH);
+    TeensyHost::advanceMicros(500000); // settle pots and switches
+    panel->update();
+
+    uint64_t ns = 0;
+    uint64_t overhead = 0;
+    uint32_t changed_count = 0;
+    float checksum = 0.0f;
+    for (uint32_t i = 0; i < kScanLoops; i++) {
+      if (scenario == SCAN_POT) {
+        const uint32_t phase = i % kScanPotPeriodLoops;
+        const uint32_t half = kScanPotPeriodLoops / 2;
+        const uint32_t ramp =
+            phase < half ? phase : kScanPotPeriodLoops - phase;
+        TeensyHost::setAnalogPin(PIN_POT_1, (int)(ramp * 1023 / half));
+      } else if (scenario == SCAN_SWITCH) {
+        TeensyHost::setDigitalPin(
+            PIN_SW_2_1, (i / kScanSwitchPeriodLoops) % 2 == 0 ? HIGH : LOW);
+      }
+      TeensyHost::advanceNanos(kScanPeriodNs);
+
+      // Timer overhead, subtracted like the empty nodes of the audio runs.
+      const uint64_t empty = TeensyHost::wallNanos();
+      overhead += TeensyHost::wallNanos() - empty;
+
+      const uint64_t start = TeensyHost::wallNanos();
+      panel->update();
+      const uint16_t changed = panel->changedMask();
+      if (changed != 0) {
+        for (uint8_t c = 0; c < CTRL_COUNT; c++) {
+          if (changed & controlBit(static_cast<controls>(c))) {
+            checksum += panel->read(static_cast<controls>(c));
+            changed_count++;
+          }
+        }
+      }
+      ns += TeensyHost::wallNanos() - start;
+    }
+    volatile float sink = checksum; // keep the loop
+    (void)sink;
+    *changes = changed_count;
+    const double net = ns > overhead ? (double)(ns - overhead) : 0.0;
+    samples.push_back(net * (F_CPU_ACTUAL / 1e9) * kScanBatch / kScanLoops);
+  }
+  return median(samples);
+}
+
+void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --voices N          voices in the graph (default: "
+          "AUTOSAVE_VOICES)\n"
+          "  --blocks N          blocks per run (default: %u)\n"
+          "  --runs N            runs per scenario, median kept "
+          "(default: %u)\n"
+          "  --save file         write results as a baseline\n"
+          "  --compare file      compare with a baseline, exit 2 on "
+          "regression\n"
+          "  --tolerance pct     allowed slowdown for --compare "
+          "(default: %.0f)\n",
+          program, kDefaultBlocks, kDefaultRuns, kDefaultTolerancePercent);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  unsigned voices = Autosave::audio_config::voices_number;
+  uint32_t blocks = kDefaultBlocks;
+  uint32_t runs = kDefaultRuns;
+  double tolerance = kDefaultTolerancePercent;
+  std::string save_path;
+  std::string compare_path;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[++i] : nullptr;
+    bool ok = true;
+    if (value == nullptr) {
+      ok = false;
+    } else if (strcmp(arg, "--voices") == 0) {
+      voices = (unsigned)atoi(value);
+      ok = voices >= 1 && voices <= kMaxVoices;
+    } else if (strcmp(arg, "--blocks") == 0) {
+      blocks = (uint32_t)atoi(value);
+      ok = blocks > 0;
+    } else if (strcmp(arg, "--runs") == 0) {
+      runs = (uint32_t)atoi(value);
+      ok = runs > 0;
+    } else if (strcmp(arg, "--save") == 0) {
+      save_path = value;
+    } else if (strcmp(arg, "--compare") == 0) {
+      compare_path = value;
+    } else if (strcmp(arg, "--tolerance") == 0) {
+      tolerance = atof(value);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      fprintf(stderr, "invalid option: %s\n", arg);
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  Baseline baseline;
+  if (!compare_path.empty() && !loadBaseline(compare_path, &baseline)) {
+    fprintf(stderr, "cannot read %s\n", compare_path.c_str());
+    return 1;
+  }
+
+  TeensyHost::setWallClockCycles(true);
+  AudioMemory(64);
+
+  const double overhead = measureTimerOverhead(blocks, runs);
+  printf("timer overhead: %.0f cycles per node (subtracted)\n", overhead);
+
+  FILE *save = nullptr;
+  if (!save_path.empty()) {
+    save = fopen(save_path.c_str(), "w");
+    if (save == nullptr) {
+      fprintf(stderr, "cannot write %s\n", save_path.c_str());
+      return 1;
+    }
+    fprintf(save, "# scenario node cycles_per_block (%u voices)\n", voices);
+  }
+
+  // The voice bank is sized at compile time (AUTOSAVE_VOICES).
+  const bool bench_bank = voices == VoiceBankGraph::kVoices;
+  if (!bench_bank) {
+    printf("voice bank skipped: built with AUTOSAVE_VOICES=%u\n",
+           (unsigned)VoiceBankGraph::kVoices);
+  }
+
+  int regressions = 0;
+  for (int g = 0; g < 2; g++) {
+    for (const Scenario &scenario : kScenarios) {
+      std::unique_ptr<BenchGraph> graph;
+      if (g == 0) {
+        if (scenario.unison) {
+          continue;
+        }
+        graph.reset(new PatchGraph((uint8_t)voices));
+      } else if (bench_bank) {
+        graph.reset(new VoiceBankGraph());
+      } else {
+        break;
+      }
+      const std::string label =
+          std::string(graph->name()) + ":" + scenario.name;
+
+      unsigned memory_max = 0;
+      std::vector<Result> results =
+          runScenario(*graph, scenario, blocks, runs, overhead, &memory_max);
+      printScenario(label, (uint8_t)voices, memory_max, results);
+
+      for (const Result &r : results) {
+        const std::string key = label + " " + r.name;
+        if (save != nullptr) {
+          fprintf(save, "%s %.0f\n", key.c_str(), r.cycles);
+        }
+        auto it = baseline.find(key);
+        if (it == baseline.end() || it->second < kCompareFloorCycles) {
+          continue;
+        }
+        const double change = (r.cycles - it->second) * 100.0 / it->second;
+        if (change > tolerance) {
+          printf("  REGRESSION %s: %.0f -> %.0f cycles (%+.1f%%)\n",
+                 key.c_str(), it->second, r.cycles, change);
+          regressions++;
+        }
+      }
+    }
+  }
+
+  const std::vector<NoteEvent> events = allocatorEvents();
+  const std::pair<const char *, Allocator::StealPolicy> policies[] = {
+      {"oldest", Allocator::STEAL_OLDEST},
+      {"quietest", Allocator::STEAL_QUIETEST},
+      {"none", Allocator::STEAL_NONE},
+  };
+  printf("\nvoice allocator (%u voices, %u-note pool)\n",
+         (unsigned)Autosave::audio_config::voices_number, kAllocatorNotePool);
+  printf("  %-18s %12s %10s %10s\n", "steal policy", "cycles/64 ev",
+         "per event", "stolen");
+  for (const auto &policy : policies) {
+    uint32_t stolen = 0;
+    const double cycles =
+        measureAllocator(policy.second, events, runs, &stolen);
+    printf("  %-18s %12.0f %10.1f %10u\n", policy.first, cycles,
+           cycles / kAllocatorBatch, stolen);
+
+    const std::string key = std::string("allocator:") + policy.first +
+                            " events_" + std::to_string(kAllocatorBatch);
+    if (save != nullptr) {
+      fprintf(save, "%s %.0f\n", key.c_str(), cycles);
+    }
+    auto it = baseline.find(key);
+    if (it == baseline.end() || it->second < kCompareFloorCycles) {
+      continue;
+    }
+    const double change = (cycles - it->second) * 100.0 / it->second;
+    if (change > tolerance) {
+      printf("  REGRESSION %s: %.0f -> %.0f cycles (%+.1f%%)\n", key.c_str(),
+             it->second, cycles, change);
+      regressions++;
+    }
+  }
+
+  Autosave::Hardware panel;
+  panel.begin();
+  const std::pair<const char *, ScanScenario> scans[] = {
+      {"idle", SCAN_IDLE},
+      {"pot", SCAN_POT},
+      {"switch", SCAN_SWITCH},
+  };
+  printf("\ncontrol scan (%u controls, a pass every %.0f us)\n",
+         (unsigned)Autosave::hardware::CTRL_COUNT, kScanPeriodNs / 1e3);
+  printf("  %-18s %12s %10s %10s\n", "panel", "cycles/64 ps", "per pass",
+         "changes");
+  for (const auto &scan : scans) {
+    uint32_t changes = 0;
+    const double cycles =
+        measureControlScan(&panel, scan.second, runs, &changes);
+    printf("  %-18s %12.0f %10.1f %10u\n", scan.first, cycles,
+           cycles / kScanBatch, changes);
+
+    const std::string key = std::string("scan:") + scan.first + " passes_" +
+                            std::to_string(kScanBatch);
+    if (save != nullptr) {
+      fprintf(save, "%s %.0f\n", key.c_str(), cycles);
+    }
+    auto it = baseline.find(key);
+    if (it == baseline.end() || it->second < kCompareFloorCycles) {
+      continue;
+    }
+    const double change = (cycles - it->second) * 100.0 / it->second;
+    if (change > tolerance) {
+      printf("  REGRESSION %s: %.0f -> %.0f cycles (%+.1f%%)\n", key.c_str(),
+             it->second, cycles, change);
+      regressions++;
+    }
+  }
+
+  if (save != nullptr) {
+    fclose(save);
+  }
+  if (!compare_path.empty()) {
+    printf("\n%d regression(s) against %s\n", regressions,
+           compare_path.c_str());
+    return regressions > 0 ? 2 : 0;
+  }
+  return 0;
+}
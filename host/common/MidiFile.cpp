@@ -0,0 +1,273 @@
+#include "common/MidiFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace {
+constexpr uint32_t kDefaultTempo = 500000; // 120 BPM
+constexpr uint8_t kClocksPerQuarter = 24;
+
+struct RawEvent {
+  uint64_t tick;
+  uint32_t order;
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+};
+
+class Reader {
+public:
+  Reader(const uint8_t *data, size_t size) : p_(data), end_(data + size) {}
+
+  bool done() const { return p_ >= end_; }
+  size_t remaining() const { return end_ - p_; }
+
+  bool u8(uint8_t *out) {
+    if (p_ >= end_) {
+      return false;
+    }
+    *out = *p_++;
+    return true;
+  }
+  bool u16(uint16_t *out) {
+    uint8_t a, b;
+    if (!u8(&a) || !u8(&b)) {
+      return false;
+    }
+    *out = (uint16_t)((a << 8) | b);
+    return true;
+  }
+  bool u32(uint32_t *out) {
+    uint16_t a, b;
+    if (!u16(&a) || !u16(&b)) {
+      return false;
+    }
+    *out = ((uint32_t)a << 16) | b;
+    return true;
+  }
+  bool varlen(uint32_t *out) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+      uint8_t b;
+      if (!u8(&b)) {
+        return false;
+      }
+      value = (value << 7) | (b & 0x7F);
+      if (!(b & 0x80)) {
+        *out = value;
+        return true;
+      }
+    }
+    return false;
+  }
+  bool skip(size_t n) {
+    if (n > remaining()) {
+      return false;
+    }
+    p_ += n;
+    return true;
+  }
+  const uint8_t *pos() const { return p_; }
+
+private:
+  const uint8_t *p_;
+  const uint8_t *end_;
+};
+} // namespace
+
+namespace AutosaveHost {
+
+bool MidiFile::load(const std::string &path, std::string *error) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    *error = "cannot open " + path;
+    return false;
+  }
+  std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)),
+                             std::istreambuf_iterator<char>());
+
+  Reader r(bytes.data(), bytes.size());
+  uint32_t magic, header_len;
+  uint16_t format, tracks;
+  if (!r.u32(&magic) || magic != 0x4D546864 || !r.u32(&header_len) ||
+      header_len < 6 || !r.u16(&format) || !r.u16(&tracks) ||
+      !r.u16(&division_) || !r.skip(header_len - 6)) {
+    *error = "not a Standard MIDI File";
+    return false;
+  }
+  if (format > 1) {
+    *error = "only SMF format 0 and 1 are supported";
+    return false;
+  }
+  if (division_ & 0x8000 || division_ == 0) {
+    *error = "SMPTE time division is not supported";
+    return false;
+  }
+
+  std::vector<RawEvent> raw;
+  tempo_map_.clear();
+  uint32_t order = 0;
+
+  for (uint16_t t = 0; t < tracks; t++) {
+    uint32_t chunk, len;
+    if (!r.u32(&chunk) || !r.u32(&len) || len > r.remaining()) {
+      *error = "truncated track chunk";
+      return false;
+    }
+    if (chunk != 0x4D54726B) {
+      r.skip(len);
+      continue;
+    }
+    Reader tr(r.pos(), len);
+    r.skip(len);
+
+    uint64_t tick = 0;
+    uint8_t running = 0;
+    while (!tr.done()) {
+      uint32_t delta;
+      uint8_t status;
+      if (!tr.varlen(&delta) || !tr.u8(&status)) {
+        *error = "truncated event";
+        return false;
+      }
+      tick += delta;
+
+      if (status == 0xFF) {
+        uint8_t type;
+        uint32_t meta_len;
+        if (!tr.u8(&type) || !tr.varlen(&meta_len) ||
+            meta_len > tr.remaining()) {
+          *error = "truncated meta event";
+          return false;
+        }
+        if (type == 0x51 && meta_len == 3) {
+          const uint8_t *d = tr.pos();
+          tempo_map_.push_back(
+              {tick, (uint32_t)((d[0] << 16) | (d[1] << 8) | d[2])});
+        }
+        tr.skip(meta_len);
+        if (type == 0x2F) {
+          break;
+        }
+        continue;
+      }
+      if (status == 0xF0 || status == 0xF7) {
+        uint32_t sysex_len;
+        if (!tr.varlen(&sysex_len) || !tr.skip(sysex_len)) {
+          *error = "truncated SysEx event";
+          return false;
+        }
+        continue;
+      }
+
+      uint8_t data1;
+      if (status & 0x80) {
+        running = status;
+        if (!tr.u8(&data1)) {
+          *error = "truncated channel event";
+          return false;
+        }
+      } else {
+        if (running == 0) {
+          *error = "running status without status byte";
+          return false;
+        }
+        data1 = status;
+        status = running;
+      }
+      uint8_t data2 = 0;
+      uint8_t type = status & 0xF0;
+      if (type != 0xC0 && type != 0xD0 && !tr.u8(&data2)) {
+        *error = "truncated channel event";
+        return false;
+      }
+      raw.push_back({tick, order++, status, data1, data2});
+    }
+  }
+
+  std::stable_sort(tempo_map_.begin(), tempo_map_.end(),
+                   [](const TempoChange &a, const TempoChange &b) {
+                     return a.tick < b.tick;
+                   });
+  if (tempo_map_.empty() || tempo_map_.front().tick != 0) {
+    tempo_map_.insert(tempo_map_.begin(), {0, kDefaultTempo});
+  }
+
+  std::stable_sort(raw.begin(), raw.end(),
+                   [](const RawEvent &a, const RawEvent &b) {
+                     return a.tick != b.tick ? a.tick < b.tick
+                                             : a.order < b.order;
+                   });
+  events_.clear();
+  events_.reserve(raw.size());
+  for (const RawEvent &e : raw) {
+    events_.push_back({ticksToSeconds((double)e.tick), e.status, e.data1,
+                       e.data2});
+  }
+  return true;
+}
+
+double MidiFile::duration() const {
+  return events_.empty() ? 0.0 : events_.back().time;
+}
+
+double MidiFile::ticksToSeconds(double tick) const {
+  double seconds = 0.0;
+  for (size_t i = 0; i < tempo_map_.size(); i++) {
+    double start = (double)tempo_map_[i].tick;
+    double end = i + 1 < tempo_map_.size() ? (double)tempo_map_[i + 1].tick
+                                           : tick;
+    if (tick < end) {
+      end = tick;
+    }
+    if (end > start) {
+      seconds += (end - start) * tempo_map_[i].us_per_quarter / 1e6 / division_;
+    }
+    if (end >= tick) {
+      break;
+    }
+  }
+  return seconds;
+}
+
+double MidiFile::secondsToTicks(double seconds) const {
+  double elapsed = 0.0;
+  for (size_t i = 0; i < tempo_map_.size(); i++) {
+    double seconds_per_tick = tempo_map_[i].us_per_quarter / 1e6 / division_;
+    if (i + 1 < tempo_map_.size()) {
+      double span = (double)(tempo_map_[i + 1].tick - tempo_map_[i].tick) *
+                    seconds_per_tick;
+      if (elapsed + span < seconds) {
+        elapsed += span;
+        continue;
+      }
+    }
+    return (double)tempo_map_[i].tick + (seconds - elapsed) / seconds_per_tick;
+  }
+  return seconds * 1e6 / kDefaultTempo * division_;
+}
+
+std::vector<MidiEvent> MidiFile::clockEvents(double until) const {
+  std::vector<MidiEvent> clock;
+  clock.push_back({0.0, 0xFA, 0, 0});
+  const double ticks_per_clock = (double)division_ / kClocksPerQuarter;
+  const double last_tick = secondsToTicks(until);
+  for (double tick = 0.0; tick <= last_tick; tick += ticks_per_clock) {
+    clock.push_back({ticksToSeconds(tick), 0xF8, 0, 0});
+  }
+  return clock;
+}
+
+std::vector<MidiEvent> MidiFile::merge(const std::vector<MidiEvent> &a,
+                                       const std::vector<MidiEvent> &b) {
+  std::vector<MidiEvent> out;
+  out.reserve(a.size() + b.size());
+  std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out),
+             [](const MidiEvent &x, const MidiEvent &y) {
+               return x.time < y.time;
+             });
+  return out;
+}
+
+} // namespace AutosaveHost
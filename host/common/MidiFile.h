@@ -0,0 +1,59 @@
+#ifndef AUTOSAVE_HOST_MIDI_FILE_H
+#define AUTOSAVE_HOST_MIDI_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace AutosaveHost {
+
+/** One timed MIDI message (channel voice or real-time), time in seconds. */
+struct MidiEvent {
+  double time;
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+};
+
+/**
+ * Standard MIDI File (format 0/1) reader. All tracks are merged and converted
+ * to absolute time with the file's tempo map; meta and SysEx events are
+ * skipped.
+ */
+class MidiFile {
+public:
+  /** Returns false and fills error on malformed input. */
+  bool load(const std::string &path, std::string *error);
+
+  const std::vector<MidiEvent> &events() const { return events_; }
+
+  /** Time of the last event, in seconds. */
+  double duration() const;
+
+  /**
+   * MIDI clock (24 per quarter note) derived from the tempo map, from 0 up to
+   * `until` seconds, preceded by a Start message.
+   */
+  std::vector<MidiEvent> clockEvents(double until) const;
+
+  /** Merge two time-ordered event lists (stable: a before b on ties). */
+  static std::vector<MidiEvent> merge(const std::vector<MidiEvent> &a,
+                                      const std::vector<MidiEvent> &b);
+
+private:
+  struct TempoChange {
+    uint64_t tick;
+    uint32_t us_per_quarter;
+  };
+
+  uint16_t division_ = 480;
+  std::vector<TempoChange> tempo_map_;
+  std::vector<MidiEvent> events_;
+
+  double ticksToSeconds(double tick) const;
+  double secondsToTicks(double seconds) const;
+};
+
+} // namespace AutosaveHost
+
+#endif
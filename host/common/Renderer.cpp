@@ -0,0 +1,100 @@
+#include "common/Renderer.h"
+
+#include "TeensyHost.h"
+#include "core/Hardware.h"
+
+namespace {
+
+// Three-position switch: pin_1 low reads 0, pin_3 low reads 2, else 1.
+void setSwitch(uint8_t pin_1, uint8_t pin_3, uint8_t position) {
+  TeensyHost::setDigitalPin(pin_1, position == 0 ? LOW : HIGH);
+  TeensyHost::setDigitalPin(pin_3, position == 2 ? LOW : HIGH);
+}
+
+void setPot(uint8_t pin, float value) {
+  if (value < 0.0f) {
+    value = 0.0f;
+  } else if (value > 1.0f) {
+    value = 1.0f;
+  }
+  TeensyHost::setAnalogPin(pin, (int)lrintf(value * 1023.0f));
+}
+
+} // namespace
+
+namespace AutosaveHost {
+
+using namespace Autosave::hardware;
+
+void Renderer::applyPanel(const PanelSettings &panel) {
+  setSwitch(PIN_SW_1_1, PIN_SW_1_3, panel.mode);
+  setSwitch(PIN_SW_2_1, PIN_SW_2_3, panel.waveform);
+  setSwitch(PIN_SW_3_1, PIN_SW_3_3, panel.switch_2);
+  TeensyHost::setDigitalPin(PIN_SW_4_1, panel.switch_3 == 0 ? LOW : HIGH);
+
+  setPot(PIN_POT_1, panel.pot_1);
+  setPot(PIN_POT_2, panel.pot_2);
+  setPot(PIN_POT_3, panel.pot_3);
+  setPot(PIN_POT_ATTACK, panel.attack);
+  setPot(PIN_POT_RELEASE, panel.release);
+}
+
+void Renderer::begin(double settle_seconds) {
+  // Keep the filter envelope CV on the left channel of the renders.
+  synth_.audio->setCvTarget(Autosave::CvOutput::TARGET_I2S);
+  synth_.begin();
+  settle(settle_seconds);
+}
+
+void Renderer::settle(double seconds) {
+  TeensyHost::setAudioSink(nullptr, nullptr);
+  runUntil(TeensyHost::nowNanos() + (uint64_t)(seconds * 1e9));
+}
+
+void Renderer::play(const std::vector<MidiEvent> &events, double tail,
+                    BlockSink sink, void *ctx) {
+  TeensyHost::setAudioSink(sink, ctx);
+
+  const uint64_t start = TeensyHost::nowNanos();
+  const double last = events.empty() ? 0.0 : events.back().time;
+  const uint64_t end = start + (uint64_t)((last + tail) * 1e9);
+  const uint64_t loop_ns = (uint64_t)loop_interval_us_ * 1000ull;
+
+  size_t next = 0;
+  while (TeensyHost::nowNanos() < end) {
+    const uint64_t step_end = TeensyHost::nowNanos() + loop_ns;
+    while (next < events.size()) {
+      const uint64_t due = start + (uint64_t)(events[next].time * 1e9);
+      if (due >= step_end) {
+        break;
+      }
+      if (due > TeensyHost::nowNanos()) {
+        TeensyHost::advanceNanos(due - TeensyHost::nowNanos());
+      }
+      send(events[next++]);
+    }
+    TeensyHost::advanceNanos(step_end - TeensyHost::nowNanos());
+    synth_.process();
+  }
+
+  TeensyHost::setAudioSink(nullptr, nullptr);
+}
+
+void Renderer::runUntil(uint64_t end_ns) {
+  const uint64_t loop_ns = (uint64_t)loop_interval_us_ * 1000ull;
+  while (TeensyHost::nowNanos() < end_ns) {
+    TeensyHost::advanceNanos(loop_ns);
+    synth_.process();
+  }
+}
+
+void Renderer::send(const MidiEvent &event) {
+  if (event.status >= 0xF8) {
+    TeensyHost::injectUsbRealTime(event.status);
+    return;
+  }
+  TeensyHost::injectUsbMidi(event.status & 0xF0, synth_.midi->getChannel(),
+                            event.data1, event.data2);
+}
+
+} // namespace AutosaveHost
@@ -0,0 +1,67 @@
+#ifndef AUTOSAVE_HOST_RENDERER_H
+#define AUTOSAVE_HOST_RENDERER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "common/MidiFile.h"
+#include "core/Synth.h"
+
+namespace AutosaveHost {
+
+/** Front-panel positions, applied to the virtual pins the firmware reads. */
+struct PanelSettings {
+  uint8_t mode = 1;     // CTRL_SWITCH_MODE: 0 mono, 1 poly, 2 arp
+  uint8_t waveform = 0; // CTRL_SWITCH_1: 0 saw, 1 square, 2 custom
+  uint8_t switch_2 = 1; // CTRL_SWITCH_2: arp pattern in arp mode
+  uint8_t switch_3 = 1; // CTRL_SWITCH_3
+  float pot_1 = 0.5f;
+  float pot_2 = 0.0f;
+  float pot_3 = 0.0f;
+  float attack = 0.0f;
+  float release = 0.2f;
+};
+
+/**
+ * Drives an Autosave::Synth in virtual time: MIDI events go through usbMIDI
+ * (so the firmware's own Synth::midiNoteOn/Off and clock callbacks run), the
+ * control loop runs every `loop_interval_us`, and every audio block crossed is
+ * delivered to the sink.
+ */
+class Renderer {
+public:
+  using BlockSink = void (*)(const int16_t *left, const int16_t *right,
+                             void *ctx);
+
+  explicit Renderer(Autosave::Synth &synth) : synth_(synth) {}
+
+  /** Set the pins; call before begin() or let settle() pick changes up. */
+  void applyPanel(const PanelSettings &panel);
+  /**
+   * synth.begin(), with the filter envelope CV on the left channel, followed
+   * by settle() so pots reach their positions.
+   */
+  void begin(double settle_seconds = 0.5);
+  /** Run the control loop for `seconds` without delivering audio. */
+  void settle(double seconds);
+
+  /**
+   * Play time-ordered events (channel voice messages are sent on the synth's
+   * MIDI channel) and keep rendering `tail` seconds after the last one.
+   */
+  void play(const std::vector<MidiEvent> &events, double tail, BlockSink sink,
+            void *ctx);
+
+  void setLoopIntervalMicros(uint32_t us) { loop_interval_us_ = us; }
+
+private:
+  Autosave::Synth &synth_;
+  uint32_t loop_interval_us_ = 100;
+
+  void runUntil(uint64_t end_ns);
+  void send(const MidiEvent &event);
+};
+
+} // namespace AutosaveHost
+
+#endif
@@ -0,0 +1,251 @@
+#include "SysexCodec.h"
+
+#include <cstdio>
+
+namespace AutosaveHost {
+
+namespace sysex = AutosaveLib::sysex;
+
+namespace {
+std::string hex(uint8_t value) {
+  char text[8];
+  snprintf(text, sizeof(text), "0x%02X", value);
+  return text;
+}
+} // namespace
+
+SysexCodec::Message SysexCodec::encode(uint8_t command,
+                                       const std::vector<uint8_t> &payload) {
+  Message message(sysex::kHeaderSize);
+  sysex::putHeader(message.data(), command);
+  for (uint8_t byte : payload) {
+    message.push_back(byte & 0x7F);
+  }
+  message.push_back(sysex::kEnd);
+  return message;
+}
+
+SysexCodec::Message SysexCodec::setChannel(uint8_t channel) {
+  return encode(sysex::CMD_SET_CHANNEL, {(uint8_t)(channel - 1)});
+}
+
+SysexCodec::Message SysexCodec::setArpSteps(uint8_t mode,
+                                            const std::vector<uint8_t> &steps) {
+  std::vector<uint8_t> payload = {mode, (uint8_t)steps.size()};
+  payload.insert(payload.end(), steps.begin(), steps.end());
+  return encode(sysex::CMD_SET_ARP_STEPS, payload);
+}
+
+SysexCodec::Message SysexCodec::setCustomWaveform(uint8_t bank,
+                                                  uint8_t index) {
+  return encode(sysex::CMD_SET_CUSTOM_WAVEFORM, {bank, index});
+}
+
+SysexCodec::Message SysexCodec::setVoicePolicy(uint8_t steal_policy,
+                                               bool retrigger_same_note) {
+  return encode(sysex::CMD_SET_VOICE_POLICY,
+                {steal_policy, static_cast<uint8_t>(retrigger_same_note)});
+}
+
+SysexCodec::Message SysexCodec::patchDump(const sysex::Patch &patch) {
+  uint8_t payload[sysex::kPatchPayloadMax];
+  const uint8_t size = sysex::encodePatch(patch, payload);
+  return encode(sysex::CMD_PATCH_DUMP, {payload, payload + size});
+}
+
+bool SysexCodec::decode(const uint8_t *data, size_t size,
+                        sysex::Message *out, std::string *error) {
+  if (size < sysex::kHeaderSize + 1 || data[0] != sysex::kStart ||
+      data[size - 1] != sysex::kEnd || !sysex::parse(data, size, out)) {
+    *error = "not an Autosave SysEx message";
+    return false;
+  }
+  const sysex::MessageSpec *spec = sysex::messageSpec(out->command);
+  if (spec == nullptr) {
+    *error = "unknown command " + hex(out->command);
+    return false;
+  }
+  if (!sysex::validLength(*spec, out->payload_size)) {
+    *error = "command " + hex(out->command) + ": " +
+             std::to_string(out->payload_size) + "-byte payload";
+    return false;
+  }
+  return true;
+}
+
+bool SysexCodec::decodeChannel(const Message &reply, uint8_t *channel,
+                               std::string *error) {
+  sysex::Message message;
+  if (!decodeReply(reply, sysex::CMD_CHANNEL_REPLY, &message, error)) {
+    return false;
+  }
+  *channel = message.payload[0] + 1;
+  return true;
+}
+
+bool SysexCodec::decodeArpSteps(const Message &reply, ArpSteps *steps,
+                                std::string *error) {
+  sysex::Message message;
+  if (!decodeReply(reply, sysex::CMD_ARP_STEPS_REPLY, &message, error)) {
+    return false;
+  }
+  const uint8_t *in = message.payload;
+  for (uint8_t mode = 0; mode < sysex::kArpModes; mode++) {
+    const uint8_t len = in[0];
+    if (len > sysex::kArpMaxSteps) {
+      *error = "arp mode " + std::to_string(mode) + ": " +
+               std::to_string(len) + " steps";
+      return false;
+    }
+    steps->modes[mode].assign(in + 1, in + 1 + len);
+    in += 1 + sysex::kArpMaxSteps;
+  }
+  return true;
+}
+
+bool SysexCodec::decodeCustomWaveform(const Message &reply, uint8_t *bank,
+                                      uint8_t *index, std::string *error) {
+  sysex::Message message;
+  if (!decodeReply(reply, sysex::CMD_CUSTOM_WAVEFORM_REPLY, &message,
+                   error)) {
+    return false;
+  }
+  *bank = message.payload[0];
+  *index = message.payload[1];
+  return true;
+}
+
+bool SysexCodec::decodeVoicePolicy(const Message &reply, uint8_t *steal_policy,
+                                   bool *retrigger_same_note,
+                                   std::string *error) {
+  sysex::Message message;
+  if (!decodeReply(reply, sysex::CMD_VOICE_POLICY_REPLY, &message, error)) {
+    return false;
+  }
+  *steal_policy = message.payload[0];
+  *retrigger_same_note = message.payload[1] != 0;
+  return true;
+}
+
+bool SysexCodec::decodeLatency(const Message &reply,
+                               std::vector<LatencyStage> *stages,
+                               std::string *error) {
+  sysex::Message message;
+  if (!decodeReply(reply, sysex::CMD_LATENCY_REPLY, &message, error)) {
+    return false;
+  }
+  if (message.payload[0] != sysex::kLatencyStages ||
+      message.payload[1] != sysex::kLatencyBins) {
+    *error = "unexpected latency layout";
+    return false;
+  }
+
+  const uint8_t size = sysex::kLatencyValueSize;
+  const uint8_t *in = message.payload + 2;
+  stages->assign(sysex::kLatencyStages, LatencyStage{});
+  for (LatencyStage &stage : *stages) {
+    stage.count = sysex::getValue(in, size);
+    stage.min = sysex::getValue(in + size, size);
+    stage.mean = sysex::getValue(in + 2 * size, size);
+    stage.max = sysex::getValue(in + 3 * size, size);
+    in += 4 * size;
+    for (uint8_t bin = 0; bin < sysex::kLatencyBins; bin++) {
+      stage.bins.push_back(sysex::getValue(in, size));
+      in += size;
+    }
+  }
+  return true;
+}
+
+bool SysexCodec::decodeProfile(const Message &reply, LoopProfile *profile,
+                               std::string *error) {
+  sysex::Message message;
+  if (!decodeReply(reply, sysex::CMD_PROFILE_REPLY, &message, error)) {
+    return false;
+  }
+  const uint8_t size = sysex::kProfileValueSize;
+  const uint8_t stages = message.payload[0];
+  if (stages > sysex::kProfileStagesMax ||
+      message.payload_size != 1u + size + stages * 4u * size) {
+    *error = "unexpected profile layout";
+    return false;
+  }
+
+  const uint8_t *in = message.payload + 1;
+  profile->loops_per_second = sysex::getValue(in, size);
+  in += size;
+  profile->stages.clear();
+  for (uint8_t i = 0; i < stages; i++) {
+    profile->stages.push_back({sysex::getValue(in, size),
+                               sysex::getValue(in + size, size),
+                               sysex::getValue(in + 2 * size, size),
+                               sysex::getValue(in + 3 * size, size)});
+    in += 4 * size;
+  }
+  return true;
+}
+
+bool SysexCodec::decodeVersion(const Message &reply, uint8_t *version,
+                               std::string *error) {
+  sysex::Message message;
+  if (!decodeReply(reply, sysex::CMD_VERSION_REPLY, &message, error)) {
+    return false;
+  }
+  *version = message.payload[0];
+  return true;
+}
+
+bool SysexCodec::decodePatch(const Message &reply, sysex::Patch *patch,
+                             std::string *error) {
+  sysex::Message message;
+  if (!decodeReply(reply, sysex::CMD_PATCH_DUMP, &message, error)) {
+    return false;
+  }
+  const sysex::Error result =
+      sysex::decodePatch(message.payload, message.payload_size, patch);
+  if (result != sysex::ERROR_NONE) {
+    *error = std::string("patch dump: ") + errorName(result);
+    return false;
+  }
+  return true;
+}
+
+const char *SysexCodec::errorName(uint8_t error) {
+  switch (error) {
+  case sysex::ERROR_NONE:
+    return "none";
+  case sysex::ERROR_UNKNOWN_COMMAND:
+    return "unknown command";
+  case sysex::ERROR_BAD_LENGTH:
+    return "bad length";
+  case sysex::ERROR_BAD_VALUE:
+    return "bad value";
+  case sysex::ERROR_UNAVAILABLE:
+    return "unavailable";
+  case sysex::ERROR_BAD_CHECKSUM:
+    return "bad checksum";
+  default:
+    return "?";
+  }
+}
+
+/** decode(), then turn an error reply or another command into an error. */
+bool SysexCodec::decodeReply(const Message &reply, uint8_t command,
+                             sysex::Message *out, std::string *error) {
+  if (!decode(reply.data(), reply.size(), out, error)) {
+    return false;
+  }
+  if (out->command == sysex::CMD_ERROR_REPLY) {
+    *error = "firmware error on command " + hex(out->payload[0]) + ": " +
+             errorName(out->payload[1]);
+    return false;
+  }
+  if (out->command != command) {
+    *error = "expected command " + hex(command) + ", got " +
+             hex(out->command);
+    return false;
+  }
+  return true;
+}
+
+} // namespace AutosaveHost
@@ -0,0 +1,98 @@
+#ifndef AUTOSAVE_HOST_SYSEX_CODEC_H
+#define AUTOSAVE_HOST_SYSEX_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lib/SysexProtocol.h"
+
+namespace AutosaveHost {
+
+/** Arp steps of every mode (CMD_ARP_STEPS_REPLY). */
+struct ArpSteps {
+  std::vector<uint8_t> modes[AutosaveLib::sysex::kArpModes];
+};
+
+/** One NoteLatency stage (CMD_LATENCY_REPLY), in microseconds. */
+struct LatencyStage {
+  uint32_t count;
+  uint32_t min;
+  uint32_t mean;
+  uint32_t max;
+  std::vector<uint32_t> bins;
+};
+
+/** One LoopProfiler stage (CMD_PROFILE_REPLY), in cycles. */
+struct ProfileStage {
+  uint32_t min;
+  uint32_t avg;
+  uint32_t max;
+  uint32_t p99;
+};
+
+struct LoopProfile {
+  uint32_t loops_per_second;
+  std::vector<ProfileStage> stages; // empty when compiled out
+};
+
+/**
+ * Host side of the SysEx configuration protocol (lib/SysexProtocol.h):
+ * builds requests for the firmware and decodes its replies, with the same
+ * message table the firmware validates against.
+ *
+ * Decoders return false and fill error on a malformed message, a message
+ * of another command, or an error reply from the firmware.
+ */
+class SysexCodec {
+public:
+  using Message = std::vector<uint8_t>;
+
+  /** F0 7D 00 [command] [payload] F7. */
+  static Message encode(uint8_t command,
+                        const std::vector<uint8_t> &payload = {});
+  /** channel: 1 to 16. */
+  static Message setChannel(uint8_t channel);
+  static Message setArpSteps(uint8_t mode, const std::vector<uint8_t> &steps);
+  static Message setCustomWaveform(uint8_t bank, uint8_t index);
+  /** steal_policy: 0 oldest, 1 quietest, 2 none. */
+  static Message setVoicePolicy(uint8_t steal_policy, bool retrigger_same_note);
+  /** CMD_PATCH_DUMP: loads every setting of `patch` at once. */
+  static Message patchDump(const AutosaveLib::sysex::Patch &patch);
+
+  /** Split a framed message and check its payload size against the spec. */
+  static bool decode(const uint8_t *data, size_t size,
+                     AutosaveLib::sysex::Message *out, std::string *error);
+
+  static bool decodeChannel(const Message &reply, uint8_t *channel,
+                            std::string *error);
+  static bool decodeArpSteps(const Message &reply, ArpSteps *steps,
+                             std::string *error);
+  static bool decodeCustomWaveform(const Message &reply, uint8_t *bank,
+                                   uint8_t *index, std::string *error);
+  static bool decodeVoicePolicy(const Message &reply, uint8_t *steal_policy,
+                                bool *retrigger_same_note, std::string *error);
+  static bool decodeLatency(const Message &reply,
+                            std::vector<LatencyStage> *stages,
+                            std::string *error);
+  static bool decodeProfile(const Message &reply, LoopProfile *profile,
+                            std::string *error);
+  static bool decodeVersion(const Message &reply, uint8_t *version,
+                            std::string *error);
+  /** Reads the sections a dump carries over `patch`, keeping the rest. */
+  static bool decodePatch(const Message &reply,
+                          AutosaveLib::sysex::Patch *patch,
+                          std::string *error);
+
+  static const char *errorName(uint8_t error);
+
+private:
+  static bool decodeReply(const Message &reply, uint8_t command,
+                          AutosaveLib::sysex::Message *out,
+                          std::string *error);
+};
+
+} // namespace AutosaveHost
+
+#endif
@@ -0,0 +1,67 @@
+#include "common/WavWriter.h"
+
+namespace {
+void put16(FILE *f, uint16_t v) {
+  fputc(v & 0xFF, f);
+  fputc(v >> 8, f);
+}
+
+void put32(FILE *f, uint32_t v) {
+  put16(f, v & 0xFFFF);
+  put16(f, v >> 16);
+}
+} // namespace
+
+namespace AutosaveHost {
+
+bool WavWriter::open(const std::string &path, uint16_t channels,
+                     uint32_t sample_rate) {
+  close();
+  file_ = fopen(path.c_str(), "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+  channels_ = channels;
+  sample_rate_ = sample_rate;
+  frames_ = 0;
+  writeHeader();
+  return true;
+}
+
+void WavWriter::write(const int16_t *interleaved, size_t frames) {
+  if (file_ == nullptr) {
+    return;
+  }
+  for (size_t i = 0; i < frames * channels_; i++) {
+    put16(file_, (uint16_t)interleaved[i]);
+  }
+  frames_ += frames;
+}
+
+void WavWriter::close() {
+  if (file_ == nullptr) {
+    return;
+  }
+  fseek(file_, 0, SEEK_SET);
+  writeHeader();
+  fclose(file_);
+  file_ = nullptr;
+}
+
+void WavWriter::writeHeader() {
+  const uint32_t data_bytes = (uint32_t)(frames_ * channels_ * 2);
+  fwrite("RIFF", 1, 4, file_);
+  put32(file_, 36 + data_bytes);
+  fwrite("WAVEfmt ", 1, 8, file_);
+  put32(file_, 16);
+  put16(file_, 1); // PCM
+  put16(file_, channels_);
+  put32(file_, sample_rate_);
+  put32(file_, sample_rate_ * channels_ * 2);
+  put16(file_, channels_ * 2);
+  put16(file_, 16);
+  fwrite("data", 1, 4, file_);
+  put32(file_, data_bytes);
+}
+
+} // namespace AutosaveHost
@@ -0,0 +1,33 @@
+#ifndef AUTOSAVE_HOST_WAV_WRITER_H
+#define AUTOSAVE_HOST_WAV_WRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace AutosaveHost {
+
+/** Streaming 16-bit PCM WAV writer; the header is patched on close(). */
+class WavWriter {
+public:
+  ~WavWriter() { close(); }
+
+  bool open(const std::string &path, uint16_t channels, uint32_t sample_rate);
+  /** Write `frames` interleaved frames. */
+  void write(const int16_t *interleaved, size_t frames);
+  void close();
+
+  size_t frames() const { return frames_; }
+
+private:
+  FILE *file_ = nullptr;
+  uint16_t channels_ = 0;
+  uint32_t sample_rate_ = 0;
+  size_t frames_ = 0;
+
+  void writeHeader();
+};
+
+} // namespace AutosaveHost
+
+#endif
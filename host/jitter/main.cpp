@@ -0,0 +1,297 @@
+/**
+ * Note timing jitter: plays a fast run of 16th notes through Autosave::Synth
+ * (poly mode, square wave, shortest envelopes) with note-ons landing at every
+ * position inside the audio block, finds each onset in the rendered audio and
+ * reports how far it is from the MIDI event (up to a constant: the capture
+ * starts on a block boundary).
+ *
+ * The run is played twice: with commands applied at block start (how the
+ * engine worked before sample offsets) and with sample-accurate commands. A
+ * constant delay is harmless; the spread of the delay is the jitter.
+ *
+ * The firmware's own note latency histograms (NoteLatency) are then read back
+ * over SysEx, as the configuration app does, and summarized.
+ *
+ * Usage: program [--notes N] [--bpm N] [--loop-us N] [--seed N]
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "TeensyHost.h"
+#include "common/Renderer.h"
+#include "common/SysexCodec.h"
+#include "core/Synth.h"
+
+namespace {
+
+constexpr uint32_t kDefaultNotes = 400;
+constexpr uint32_t kDefaultBpm = 300;
+constexpr uint32_t kDefaultLoopMicros = 100;
+constexpr uint32_t kDefaultSeed = 1;
+constexpr uint8_t kNote = 72; // C4 after the firmware's octave fix
+constexpr uint8_t kVelocity = 127;
+// First sample louder than this is the onset; the output is silent between
+// notes, so anything above the dither-free zero works.
+constexpr int kOnsetThreshold = 16;
+constexpr double kHistogramBinSamples = 8.0;
+
+struct Stats {
+  double min;
+  double max;
+  double mean;
+  double stddev;
+  double p50;
+  double p99;
+  size_t missed;
+};
+
+void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [--notes N] [--bpm N] [--loop-us N] [--seed N]\n"
+          "  --notes N     16th notes played per run (default: %u)\n"
+          "  --bpm N       tempo (default: %u)\n"
+          "  --loop-us N   control loop period in virtual time (default: "
+          "%u)\n"
+          "  --seed N      seed of the note position inside the block\n",
+          program, kDefaultNotes, kDefaultBpm, kDefaultLoopMicros);
+}
+
+void captureRight(const int16_t *left, const int16_t *right, void *ctx) {
+  (void)left;
+  auto *samples = static_cast<std::vector<int16_t> *>(ctx);
+  samples->insert(samples->end(), right, right + TeensyHost::kBlockSamples);
+}
+
+// Note-on times in seconds: one per 16th, each pushed by a random fraction of
+// a block so onsets cover every position inside the block.
+std::vector<double> noteTimes(uint32_t notes, uint32_t bpm, uint32_t seed) {
+  const double sixteenth = 15.0 / bpm;
+  const double block =
+      (double)TeensyHost::kBlockSamples / TeensyHost::kSampleRate;
+
+  std::vector<double> times;
+  uint32_t state = seed;
+  for (uint32_t i = 0; i < notes; i++) {
+    state = state * 1664525u + 1013904223u; // LCG, reproducible
+    const double fraction = (state >> 8) * (1.0 / 16777216.0);
+    times.push_back(0.01 + i * sixteenth + fraction * block);
+  }
+  return times;
+}
+
+std::vector<AutosaveHost::MidiEvent>
+noteEvents(const std::vector<double> &times, double length) {
+  std::vector<AutosaveHost::MidiEvent> events;
+  for (double time : times) {
+    events.push_back({time, 0x90, kNote, kVelocity});
+    events.push_back({time + length, 0x80, kNote, 0});
+  }
+  return events;
+}
+
+// Onset delay of every note, in samples.
+std::vector<double> onsetDelays(const std::vector<int16_t> &samples,
+                                const std::vector<double> &times,
+                                double length, size_t *missed) {
+  std::vector<double> delays;
+  *missed = 0;
+  for (double time : times) {
+    // The capture is not aligned with virtual time (it starts on a block),
+    // so look a little before the note; not as far as the previous note's
+    // release tail.
+    const double due = time * TeensyHost::kSampleRate;
+    const size_t end = std::min(
+        samples.size(), (size_t)((time + length) * TeensyHost::kSampleRate));
+    size_t i = (size_t)std::max(0.0, due - length / 4.0 *
+                                              TeensyHost::kSampleRate);
+    while (i < end && std::abs(samples[i]) <= kOnsetThreshold) {
+      i++;
+    }
+    if (i >= end) {
+      (*missed)++;
+      continue;
+    }
+    delays.push_back(i - due);
+  }
+  return delays;
+}
+
+Stats computeStats(std::vector<double> delays, size_t missed) {
+  Stats stats = {};
+  stats.missed = missed;
+  if (delays.empty()) {
+    return stats;
+  }
+  std::sort(delays.begin(), delays.end());
+
+  double sum = 0.0;
+  for (double delay : delays) {
+    sum += delay;
+  }
+  stats.mean = sum / delays.size();
+  double variance = 0.0;
+  for (double delay : delays) {
+    variance += (delay - stats.mean) * (delay - stats.mean);
+  }
+  stats.stddev = std::sqrt(variance / delays.size());
+  stats.min = delays.front();
+  stats.max = delays.back();
+  stats.p50 = delays[delays.size() / 2];
+  stats.p99 = delays[(delays.size() * 99) / 100];
+  return stats;
+}
+
+void printHistogram(const std::vector<double> &delays) {
+  if (delays.empty()) {
+    return;
+  }
+  const double low = *std::min_element(delays.begin(), delays.end());
+  const double high = *std::max_element(delays.begin(), delays.end());
+  const double first = std::floor(low / kHistogramBinSamples);
+  const size_t bins = (size_t)(std::floor(high / kHistogramBinSamples) -
+                               first) +
+                      1;
+
+  std::vector<size_t> counts(bins, 0);
+  for (double delay : delays) {
+    counts[(size_t)(std::floor(delay / kHistogramBinSamples) - first)]++;
+  }
+  const size_t peak = *std::max_element(counts.begin(), counts.end());
+  for (size_t b = 0; b < bins; b++) {
+    const double from = (first + b) * kHistogramBinSamples;
+    const int bar = (int)((counts[b] * 50 + peak - 1) / peak);
+    printf("  %7.2f ms %5zu %.*s\n", from * 1000.0 / TeensyHost::kSampleRate,
+           counts[b], bar,
+           "##################################################");
+  }
+}
+
+void captureSysEx(const uint8_t *data, size_t size, void *ctx) {
+  static_cast<std::vector<uint8_t> *>(ctx)->assign(data, data + size);
+}
+
+// Query NoteLatency over SysEx and print count/min/mean/max per stage.
+void printFirmwareLatency(AutosaveHost::Renderer &renderer) {
+  using AutosaveHost::SysexCodec;
+  const SysexCodec::Message request =
+      SysexCodec::encode(AutosaveLib::sysex::CMD_GET_LATENCY);
+  std::vector<uint8_t> reply;
+  TeensyHost::setSysExListener(captureSysEx, &reply);
+  TeensyHost::injectUsbSysEx(request.data(), request.size());
+  renderer.settle(0.01);
+  TeensyHost::setSysExListener(nullptr, nullptr);
+
+  std::vector<AutosaveHost::LatencyStage> stages;
+  std::string error;
+  if (!SysexCodec::decodeLatency(reply, &stages, &error)) {
+    printf("  no latency reply: %s\n", error.c_str());
+    return;
+  }
+
+  const char *const names[] = {"poll", "state", "envelope"};
+  for (size_t i = 0; i < stages.size(); i++) {
+    const AutosaveHost::LatencyStage &stage = stages[i];
+    printf("  %-9s %6u notes  min %5u us  mean %5u us  max %5u us\n",
+           i < 3 ? names[i] : "?", stage.count, stage.min, stage.mean,
+           stage.max);
+  }
+}
+
+double ms(double samples) {
+  return samples * 1000.0 / TeensyHost::kSampleRate;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t notes = kDefaultNotes;
+  uint32_t bpm = kDefaultBpm;
+  uint32_t loop_us = kDefaultLoopMicros;
+  uint32_t seed = kDefaultSeed;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[++i] : nullptr;
+    bool ok = true;
+    if (value == nullptr) {
+      ok = false;
+    } else if (strcmp(arg, "--notes") == 0) {
+      notes = (uint32_t)atoi(value);
+      ok = notes > 0;
+    } else if (strcmp(arg, "--bpm") == 0) {
+      bpm = (uint32_t)atoi(value);
+      ok = bpm >= 30 && bpm <= 999;
+    } else if (strcmp(arg, "--loop-us") == 0) {
+      loop_us = (uint32_t)atoi(value);
+      ok = loop_us > 0;
+    } else if (strcmp(arg, "--seed") == 0) {
+      seed = (uint32_t)strtoul(value, nullptr, 10);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      fprintf(stderr, "invalid option: %s\n", arg);
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  Autosave::Synth synth;
+  AutosaveHost::Renderer renderer(synth);
+  AutosaveHost::PanelSettings panel;
+  panel.mode = 1;     // poly
+  panel.waveform = 1; // square: full-scale from the first sample
+  panel.pot_3 = 0.0f; // no FM
+  panel.attack = 0.0f;
+  panel.release = 0.0f;
+  renderer.applyPanel(panel);
+  renderer.setLoopIntervalMicros(loop_us);
+  renderer.begin();
+
+  const double length = 15.0 / bpm / 2.0;
+  const std::vector<double> times = noteTimes(notes, bpm, seed);
+  const std::vector<AutosaveHost::MidiEvent> events =
+      noteEvents(times, length);
+
+  printf("%u notes at %u BPM, control loop every %u us\n\n", notes, bpm,
+         loop_us);
+  printf("%-14s %8s %8s %8s %8s %8s %8s %7s\n", "commands", "min", "p50",
+         "mean", "p99", "max", "stddev", "missed");
+
+  const char *const names[] = {"block start", "sample offset"};
+  std::vector<double> delays[2];
+  for (int run = 0; run < 2; run++) {
+    synth.audio->setSampleAccurateCommands(run == 1);
+    renderer.settle(0.1);
+    const AutosaveHost::SysexCodec::Message reset =
+        AutosaveHost::SysexCodec::encode(
+            AutosaveLib::sysex::CMD_RESET_LATENCY);
+    TeensyHost::injectUsbSysEx(reset.data(), reset.size());
+    renderer.settle(0.01);
+
+    std::vector<int16_t> samples;
+    renderer.play(events, length * 2.0, captureRight, &samples);
+
+    size_t missed = 0;
+    delays[run] = onsetDelays(samples, times, length, &missed);
+    const Stats stats = computeStats(delays[run], missed);
+    printf("%-14s %6.3fms %6.3fms %6.3fms %6.3fms %6.3fms %6.3fms %7zu\n",
+           names[run], ms(stats.min), ms(stats.p50), ms(stats.mean),
+           ms(stats.p99), ms(stats.max), ms(stats.stddev), stats.missed);
+  }
+
+  printf("\nfirmware note latency (SysEx), sample offset run:\n");
+  printFirmwareLatency(renderer);
+
+  for (int run = 0; run < 2; run++) {
+    printf("\nonset delay, %s:\n", names[run]);
+    printHistogram(delays[run]);
+  }
+  return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * Accuracy and speed check of AutosaveLib::fast_math against libm: sweeps
+ * each function over the range the firmware uses (and beyond), reports the
+ * worst error in cents and exits 2 when one exceeds its bound. Also times
+ * both versions over the same inputs, in host nanoseconds per call.
+ *
+ * Usage: program [--points N] [--bound cents]
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "TeensyHost.h"
+#include "core/Audio.h"
+#include "lib/FastMath.h"
+
+namespace {
+
+using namespace AutosaveLib;
+
+constexpr uint32_t kDefaultPoints = 1000000;
+// Well under what an ear (or a tuner) resolves.
+constexpr double kDefaultBoundCents = 0.01;
+constexpr uint32_t kTimingRuns = 5;
+
+struct Check {
+  const char *name;
+  const char *range;
+  double from;
+  double to;
+  bool logarithmic; // sweep 2^x for x in [from, to] instead of x
+  /** Error of fast_math at x, in cents. */
+  double (*error_cents)(double x);
+};
+
+double centsBetween(double value, double reference) {
+  return 1200.0 * std::log2(value / reference);
+}
+
+double exp2Error(double x) {
+  return centsBetween(fast_math::exp2((float)x), std::exp2(x));
+}
+
+// log2 returns octaves: its error converts to cents directly.
+double log2Error(double x) {
+  return 1200.0 * (fast_math::log2((float)x) - std::log2(x));
+}
+
+double centsToRatioError(double cents) {
+  return centsBetween(fast_math::centsToRatio((float)cents),
+                      std::exp2(cents / 1200.0));
+}
+
+double ratioToCentsError(double ratio) {
+  return fast_math::ratioToCents((float)ratio) - 1200.0 * std::log2(ratio);
+}
+
+double frequencyFromCvError(double cv) {
+  return centsBetween(Autosave::Audio::computeFrequencyFromCV((float)cv),
+                      32.7032 * std::exp2(cv));
+}
+
+const Check kChecks[] = {
+    {"exp2", "[-24, 24]", -24.0, 24.0, false, exp2Error},
+    {"exp2", "[-126, 127]", -126.0, 127.0, false, exp2Error},
+    {"log2", "[2^-20, 2^20]", -20.0, 20.0, true, log2Error},
+    {"centsToRatio", "[-2400, 2400]", -2400.0, 2400.0, false,
+     centsToRatioError},
+    {"ratioToCents", "[1/4, 4]", -2.0, 2.0, true, ratioToCentsError},
+    {"frequencyFromCV", "[0 V, 10 V]", 0.0, 10.0, false,
+     frequencyFromCvError},
+};
+
+double sweep(const Check &check, uint32_t points, double *worst_x) {
+  double worst = 0.0;
+  for (uint32_t i = 0; i <= points; i++) {
+    double x = check.from + (check.to - check.from) * i / points;
+    if (check.logarithmic) {
+      x = std::exp2(x);
+    }
+    // Evaluate at the float the function actually receives.
+    x = (float)x;
+    const double error = std::fabs(check.error_cents(x));
+    if (error > worst) {
+      worst = error;
+      *worst_x = x;
+    }
+  }
+  return worst;
+}
+
+template <typename F>
+double nanosPerCall(const std::vector<float> &inputs, F function) {
+  double best = 0.0;
+  volatile float sink = 0.0f;
+  for (uint32_t run = 0; run < kTimingRuns; run++) {
+    float sum = 0.0f;
+    const uint64_t start = TeensyHost::wallNanos();
+    for (float x : inputs) {
+      sum += function(x);
+    }
+    const double ns =
+        (double)(TeensyHost::wallNanos() - start) / inputs.size();
+    sink = sink + sum;
+    if (run == 0 || ns < best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [--points N] [--bound cents]\n"
+          "  --points N      points per sweep (default: %u)\n"
+          "  --bound cents   allowed error (default: %.3f)\n",
+          program, kDefaultPoints, kDefaultBoundCents);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t points = kDefaultPoints;
+  double bound = kDefaultBoundCents;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[++i] : nullptr;
+    bool ok = true;
+    if (value == nullptr) {
+      ok = false;
+    } else if (strcmp(arg, "--points") == 0) {
+      points = (uint32_t)atoi(value);
+      ok = points > 0;
+    } else if (strcmp(arg, "--bound") == 0) {
+      bound = atof(value);
+      ok = bound > 0.0;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      fprintf(stderr, "invalid option: %s\n", arg);
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  printf("%-16s %-14s %14s %14s  %s\n", "function", "range",
+         "max err cents", "at", "result");
+  int failures = 0;
+  for (const Check &check : kChecks) {
+    double worst_x = 0.0;
+    const double worst = sweep(check, points, &worst_x);
+    const bool ok = worst <= bound;
+    failures += ok ? 0 : 1;
+    printf("%-16s %-14s %14.6f %14.6g  %s\n", check.name, check.range, worst,
+           worst_x, ok ? "ok" : "FAIL");
+  }
+
+  std::vector<float> octaves(points);
+  std::vector<float> ratios(points);
+  for (uint32_t i = 0; i < points; i++) {
+    octaves[i] = -10.0f + 20.0f * i / points;
+    ratios[i] = std::exp2(octaves[i]);
+  }
+  printf("\n%-16s %10s %10s\n", "ns per call", "fast_math", "libm");
+  printf("%-16s %10.2f %10.2f\n", "exp2",
+         nanosPerCall(octaves, [](float x) { return fast_math::exp2(x); }),
+         nanosPerCall(octaves, [](float x) { return powf(2.0f, x); }));
+  printf("%-16s %10.2f %10.2f\n", "log2",
+         nanosPerCall(ratios, [](float x) { return fast_math::log2(x); }),
+         nanosPerCall(ratios, [](float x) { return log2f(x); }));
+
+  printf("\n%d check(s) above %.3f cents\n", failures, bound);
+  return failures > 0 ? 2 : 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * Native runner: executes the firmware (setup()/loop() from src/main.cpp) on
+ * the host against the Teensy stand-in, advancing virtual time as fast as the
+ * CPU allows.
+ *
+ * Usage: program [seconds] [loops_per_block]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "AudioStream.h"
+#include "TeensyHost.h"
+
+void setup();
+void loop();
+
+namespace {
+constexpr double kDefaultSeconds = 10.0;
+constexpr unsigned kDefaultLoopsPerBlock = 8;
+} // namespace
+
+int main(int argc, char **argv) {
+  double seconds = argc > 1 ? atof(argv[1]) : kDefaultSeconds;
+  unsigned loops_per_block =
+      argc > 2 ? (unsigned)atoi(argv[2]) : kDefaultLoopsPerBlock;
+  if (seconds <= 0.0 || loops_per_block == 0) {
+    fprintf(stderr, "usage: %s [seconds] [loops_per_block]\n", argv[0]);
+    return 1;
+  }
+
+  TeensyHost::setWallClockCycles(true);
+
+  setup();
+
+  const uint64_t blocks = (uint64_t)(seconds * TeensyHost::kSampleRate /
+                                     TeensyHost::kBlockSamples);
+  const uint64_t block_ns = 1000000000ull * TeensyHost::kBlockSamples /
+                            TeensyHost::kSampleRate;
+  const uint64_t start_ns = TeensyHost::wallNanos();
+
+  for (uint64_t b = 0; b < blocks; b++) {
+    for (unsigned l = 0; l < loops_per_block; l++) {
+      loop();
+      TeensyHost::advanceNanos(block_ns / loops_per_block);
+    }
+    TeensyHost::advanceBlock();
+  }
+
+  const double wall_s = (TeensyHost::wallNanos() - start_ns) / 1e9;
+  const double audio_s = (double)TeensyHost::blocksRendered() *
+                         TeensyHost::kBlockSamples / TeensyHost::kSampleRate;
+  printf("rendered %.2f s of audio in %.3f s (%.1fx realtime)\n", audio_s,
+         wall_s, wall_s > 0.0 ? audio_s / wall_s : 0.0);
+  printf("audio memory: %u blocks max\n", (unsigned)AudioMemoryUsageMax());
+  return 0;
+}
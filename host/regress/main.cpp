@@ -0,0 +1,668 @@
+/**
+ * Golden-audio regression check: renders a fixed set of scenarios through
+ * Autosave::Synth in mono, poly and arp mode (every waveform, extreme
+ * envelopes, full chords, unison stacks) and compares them with stored
+ * golden renders.
+ *
+ * A golden render is kept as a fingerprint rather than audio: a hash of the
+ * samples (bit-exact check), the RMS level of the audio and of the filter
+ * envelope CV per 1024-frame window, and the long-term spectrum of the audio
+ * in third-octave bands. A render that is not bit-exact passes when every
+ * RMS window and every audible band stays within the tolerances, so DSP
+ * changes can be shipped with bounded, measured error.
+ *
+ * Each scenario runs in its own process (the firmware objects are global),
+ * with the drift random walk seeded, so renders are reproducible.
+ *
+ * Usage: program [--save file] [--compare file] [--only name]
+ *                [--wav-dir dir] [--rms-tolerance dB] [--band-tolerance dB]
+ */
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "TeensyHost.h"
+#include "common/Renderer.h"
+#include "common/WavWriter.h"
+#include "core/Synth.h"
+#include "core/states/ArpSynthState.h"
+
+namespace {
+
+constexpr uint32_t kDriftSeed = 1;
+constexpr double kTailSeconds = 0.5;
+constexpr uint32_t kRmsWindowFrames = 1024;
+constexpr uint32_t kFftSize = 2048;
+constexpr uint32_t kFftHop = kFftSize / 2;
+constexpr uint32_t kBands = 30;
+constexpr double kFirstBandHz = 25.0;
+// Levels are floored here: below it, differences are not audible.
+constexpr double kFloorDb = -90.0;
+// RMS windows quieter than this in both renders are not compared.
+constexpr double kRmsCompareFloorDb = -80.0;
+// Bands this far below the loudest band are not compared.
+constexpr double kBandCompareRangeDb = 60.0;
+constexpr double kDefaultRmsToleranceDb = 0.5;
+constexpr double kDefaultBandToleranceDb = 1.0;
+// Golden renders are made with the default voice count.
+constexpr uint8_t kGoldenVoices = 8;
+
+constexpr uint8_t kMono = 0;
+constexpr uint8_t kPoly = 1;
+constexpr uint8_t kArp = 2;
+constexpr uint8_t kSaw = 0;
+constexpr uint8_t kSquare = 1;
+constexpr uint8_t kCustom = 2;
+
+enum Pattern : uint8_t {
+  PATTERN_MELODY,    // monophonic line, quarter notes
+  PATTERN_CHORDS,    // two full 8-note chords
+  PATTERN_STABS,     // short 8-note chords, 16ths
+  PATTERN_HELD,      // one 4-note chord held under MIDI clock
+  PATTERN_STACK,     // 1, 2 then 4 notes held, then 1 again (unison sizes)
+  PATTERN_RETRIGGER, // one note struck again while held, then a second note
+};
+
+struct Scenario {
+  const char *name;
+  uint8_t mode;
+  uint8_t waveform;
+  Pattern pattern;
+  float attack;
+  float release;
+  float fm;
+  float pot_1; // mono: detune, poly: unison spread
+};
+
+const Scenario kScenarios[] = {
+    {"mono-saw", kMono, kSaw, PATTERN_MELODY, 0.0f, 0.2f, 0.0f, 0.5f},
+    {"mono-square", kMono, kSquare, PATTERN_MELODY, 0.0f, 0.2f, 0.0f, 0.5f},
+    {"mono-custom", kMono, kCustom, PATTERN_MELODY, 0.0f, 0.2f, 0.0f, 0.5f},
+    {"mono-saw-slow", kMono, kSaw, PATTERN_MELODY, 1.0f, 1.0f, 0.0f, 0.5f},
+    {"poly-saw", kPoly, kSaw, PATTERN_CHORDS, 0.0f, 0.2f, 0.0f, 0.0f},
+    {"poly-square", kPoly, kSquare, PATTERN_CHORDS, 0.0f, 0.2f, 0.0f, 0.0f},
+    {"poly-custom", kPoly, kCustom, PATTERN_CHORDS, 0.0f, 0.2f, 0.0f, 0.0f},
+    {"poly-custom-fm", kPoly, kCustom, PATTERN_CHORDS, 0.0f, 0.2f, 0.6f, 0.0f},
+    {"poly-saw-slow", kPoly, kSaw, PATTERN_CHORDS, 1.0f, 1.0f, 0.0f, 0.0f},
+    {"poly-square-fast", kPoly, kSquare, PATTERN_STABS, 0.0f, 0.0f, 0.0f, 0.0f},
+    {"poly-unison-saw", kPoly, kSaw, PATTERN_STACK, 0.0f, 0.2f, 0.0f, 0.6f},
+    {"poly-unison-square", kPoly, kSquare, PATTERN_STACK, 0.0f, 0.2f, 0.0f,
+     1.0f},
+    {"poly-unison-retrig", kPoly, kSaw, PATTERN_RETRIGGER, 0.0f, 0.2f, 0.0f,
+     0.6f},
+    {"arp-saw", kArp, kSaw, PATTERN_HELD, 0.0f, 0.2f, 0.0f, 0.5f},
+    {"arp-square", kArp, kSquare, PATTERN_HELD, 0.0f, 0.2f, 0.0f, 0.5f},
+    {"arp-custom", kArp, kCustom, PATTERN_HELD, 0.0f, 0.2f, 0.0f, 0.5f},
+    {"arp-square-fast", kArp, kSquare, PATTERN_HELD, 0.0f, 0.0f, 0.0f, 0.5f},
+};
+
+const uint8_t kMelody[] = {60, 64, 67, 72, 71, 67, 62, 55};
+const uint8_t kChords[2][8] = {{48, 55, 60, 64, 67, 71, 74, 79},
+                               {45, 52, 57, 60, 64, 69, 72, 76}};
+const uint8_t kHeldChord[] = {60, 64, 67, 71};
+constexpr uint8_t kVelocity = 100;
+constexpr double kTempoBpm = 120.0;
+
+/** Rendered frames of one scenario, left (CV) and right (audio). */
+struct Render {
+  std::vector<int16_t> left;
+  std::vector<int16_t> right;
+};
+
+/** What the golden file keeps of a render. */
+struct Fingerprint {
+  uint64_t frames = 0;
+  uint64_t hash = 0;
+  std::vector<double> rms;
+  std::vector<double> cv;
+  std::vector<double> bands;
+};
+
+std::vector<AutosaveHost::MidiEvent> scenarioEvents(const Scenario &scenario) {
+  std::vector<AutosaveHost::MidiEvent> events;
+  const double beat = 60.0 / kTempoBpm;
+  switch (scenario.pattern) {
+  case PATTERN_MELODY:
+    for (size_t i = 0; i < sizeof(kMelody); i++) {
+      events.push_back({0.05 + i * beat / 2.0, 0x90, kMelody[i], kVelocity});
+      events.push_back({0.05 + (i + 0.9) * beat / 2.0, 0x80, kMelody[i], 0});
+    }
+    break;
+  case PATTERN_CHORDS:
+    for (int c = 0; c < 2; c++) {
+      const double on = 0.05 + c * 2.0 * beat;
+      for (uint8_t note : kChords[c]) {
+        events.push_back({on, 0x90, note, kVelocity});
+      }
+      for (uint8_t note : kChords[c]) {
+        events.push_back({on + 1.5 * beat, 0x80, note, 0});
+      }
+    }
+    break;
+  case PATTERN_STABS:
+    for (int i = 0; i < 8; i++) {
+      const double on = 0.05 + i * beat / 4.0;
+      for (uint8_t note : kChords[i % 2]) {
+        events.push_back({on, 0x90, note, kVelocity});
+      }
+      for (uint8_t note : kChords[i % 2]) {
+        events.push_back({on + beat / 8.0, 0x80, note, 0});
+      }
+    }
+    break;
+  case PATTERN_HELD: {
+    const double end = 0.05 + 4.0 * beat;
+    const double tick = beat / 24.0;
+    events.push_back({0.0, 0xFA, 0, 0});
+    for (double t = 0.0; t < end + tick; t += tick) {
+      events.push_back({t, 0xF8, 0, 0});
+    }
+    for (uint8_t note : kHeldChord) {
+      events.push_back({0.05, 0x90, note, kVelocity});
+      events.push_back({end, 0x80, note, 0});
+    }
+    break;
+  }
+  case PATTERN_STACK:
+    events.push_back({0.05, 0x90, kHeldChord[0], kVelocity});
+    events.push_back({0.05 + beat, 0x90, kHeldChord[1], kVelocity});
+    for (int i = 2; i < 4; i++) {
+      events.push_back({0.05 + 2.0 * beat, 0x90, kHeldChord[i], kVelocity});
+    }
+    for (uint8_t note : kHeldChord) {
+      events.push_back({0.05 + 3.0 * beat, 0x80, note, 0});
+    }
+    events.push_back({0.05 + 4.0 * beat, 0x90, kHeldChord[0], kVelocity});
+    events.push_back({0.05 + 5.0 * beat, 0x80, kHeldChord[0], 0});
+    break;
+  case PATTERN_RETRIGGER:
+    // The repeats keep the full stack; the second note halves it.
+    for (int i = 0; i < 3; i++) {
+      events.push_back({0.05 + i * beat, 0x90, kHeldChord[0], kVelocity});
+    }
+    events.push_back({0.05 + 3.0 * beat, 0x90, kHeldChord[1], kVelocity});
+    for (int i = 0; i < 2; i++) {
+      events.push_back({0.05 + 4.0 * beat, 0x80, kHeldChord[i], 0});
+    }
+    break;
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const AutosaveHost::MidiEvent &a,
+                      const AutosaveHost::MidiEvent &b) {
+                     return a.time < b.time;
+                   });
+  return events;
+}
+
+void captureBlock(const int16_t *left, const int16_t *right, void *ctx) {
+  auto *render = static_cast<Render *>(ctx);
+  render->left.insert(render->left.end(), left,
+                      left + TeensyHost::kBlockSamples);
+  render->right.insert(render->right.end(), right,
+                       right + TeensyHost::kBlockSamples);
+}
+
+// Runs in the child process: a fresh Synth for every scenario.
+Render renderScenario(const Scenario &scenario) {
+  Autosave::Synth synth;
+  synth.audio->setDriftSeed(kDriftSeed);
+  AutosaveHost::Renderer renderer(synth);
+  AutosaveHost::PanelSettings panel;
+  panel.mode = scenario.mode;
+  panel.waveform = scenario.waveform;
+  panel.switch_2 = 0; // arp pattern 0, latched from the start
+  panel.pot_1 = scenario.pot_1;
+  panel.pot_3 = scenario.fm;
+  panel.attack = scenario.attack;
+  panel.release = scenario.release;
+  renderer.applyPanel(panel);
+  renderer.begin();
+
+  // A blank EEPROM has no arp steps; same fallback as the renderer.
+  for (auto &steps : Autosave::ArpSynthState::arp_mode_steps) {
+    if (steps.empty()) {
+      steps = {0, 1, 2, 3, 4, 5, 6, 7};
+    }
+  }
+
+  Render render;
+  renderer.play(scenarioEvents(scenario), kTailSeconds, captureBlock,
+                &render);
+  return render;
+}
+
+bool writeAll(int fd, const void *data, size_t size) {
+  const char *p = static_cast<const char *>(data);
+  while (size > 0) {
+    const ssize_t n = write(fd, p, size);
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+/** Render in a child process; interleaved frames come back over a pipe. */
+bool renderIsolated(const Scenario &scenario, Render *render) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return false;
+  }
+  fflush(stdout);
+  const pid_t pid = fork();
+  if (pid < 0) {
+    return false;
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    const Render child = renderScenario(scenario);
+    std::vector<int16_t> frames;
+    for (size_t i = 0; i < child.right.size(); i++) {
+      frames.push_back(child.left[i]);
+      frames.push_back(child.right[i]);
+    }
+    const bool ok =
+        writeAll(fds[1], frames.data(), frames.size() * sizeof(int16_t));
+    _exit(ok ? 0 : 1);
+  }
+
+  close(fds[1]);
+  std::vector<int16_t> frames;
+  int16_t buffer[4096];
+  ssize_t n;
+  while ((n = read(fds[0], buffer, sizeof(buffer))) > 0) {
+    frames.insert(frames.end(), buffer, buffer + n / sizeof(int16_t));
+  }
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    return false;
+  }
+  for (size_t i = 0; i + 1 < frames.size(); i += 2) {
+    render->left.push_back(frames[i]);
+    render->right.push_back(frames[i + 1]);
+  }
+  return true;
+}
+
+double toDb(double power) {
+  return power > 0.0 ? std::max(kFloorDb, 10.0 * std::log10(power)) : kFloorDb;
+}
+
+// FNV-1a over both channels.
+uint64_t hashRender(const Render &render) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < render.right.size(); i++) {
+    for (int16_t sample : {render.left[i], render.right[i]}) {
+      const uint16_t bits = (uint16_t)sample;
+      for (int b = 0; b < 2; b++) {
+        hash ^= (bits >> (8 * b)) & 0xFF;
+        hash *= 1099511628211ull;
+      }
+    }
+  }
+  return hash;
+}
+
+std::vector<double> rmsWindows(const std::vector<int16_t> &samples) {
+  std::vector<double> levels;
+  for (size_t start = 0; start < samples.size(); start += kRmsWindowFrames) {
+    const size_t end = std::min(samples.size(), start + kRmsWindowFrames);
+    double sum = 0.0;
+    for (size_t i = start; i < end; i++) {
+      const double x = samples[i] / 32768.0;
+      sum += x * x;
+    }
+    levels.push_back(toDb(sum / (end - start)));
+  }
+  return levels;
+}
+
+void fft(std::vector<std::complex<double>> *data) {
+  std::vector<std::complex<double>> &x = *data;
+  const size_t n = x.size();
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(x[i], x[j]);
+    }
+  }
+  for (size_t len = 2; len <= n; len <<= 1) {
+    const std::complex<double> step = std::polar(1.0, -2.0 * M_PI / len);
+    for (size_t i = 0; i < n; i += len) {
+      std::complex<double> w = 1.0;
+      for (size_t k = 0; k < len / 2; k++) {
+        const std::complex<double> u = x[i + k];
+        const std::complex<double> v = x[i + k + len / 2] * w;
+        x[i + k] = u + v;
+        x[i + k + len / 2] = u - v;
+        w *= step;
+      }
+    }
+  }
+}
+
+/**
+ * Long-term spectrum in third-octave bands from kFirstBandHz, Hann windows
+ * with 50% overlap; 0 dB is a full-scale sine.
+ */
+std::vector<double> spectrumBands(const std::vector<int16_t> &samples) {
+  std::vector<double> energy(kBands, 0.0);
+  std::vector<double> window(kFftSize);
+  for (uint32_t i = 0; i < kFftSize; i++) {
+    window[i] = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / kFftSize);
+  }
+  const double bin_hz = (double)TeensyHost::kSampleRate / kFftSize;
+  std::vector<int> band_of_bin(kFftSize / 2, -1);
+  for (uint32_t k = 1; k < kFftSize / 2; k++) {
+    const double octaves = std::log2(k * bin_hz / kFirstBandHz);
+    const int band = (int)std::floor(octaves * 3.0 + 0.5);
+    if (band >= 0 && band < (int)kBands) {
+      band_of_bin[k] = band;
+    }
+  }
+
+  uint32_t frames = 0;
+  std::vector<std::complex<double>> x(kFftSize);
+  for (size_t start = 0; start + kFftSize <= samples.size();
+       start += kFftHop) {
+    for (uint32_t i = 0; i < kFftSize; i++) {
+      x[i] = samples[start + i] / 32768.0 * window[i];
+    }
+    fft(&x);
+    for (uint32_t k = 1; k < kFftSize / 2; k++) {
+      if (band_of_bin[k] >= 0) {
+        energy[band_of_bin[k]] += std::norm(x[k]);
+      }
+    }
+    frames++;
+  }
+
+  // Positive-frequency energy of a windowed full-scale sine: 3 N^2 / 32.
+  const double reference = 3.0 * kFftSize * kFftSize / 32.0;
+  std::vector<double> bands;
+  for (double e : energy) {
+    bands.push_back(toDb(frames > 0 ? e / frames / reference : 0.0));
+  }
+  return bands;
+}
+
+Fingerprint fingerprint(const Render &render) {
+  Fingerprint print;
+  print.frames = render.right.size();
+  print.hash = hashRender(render);
+  print.rms = rmsWindows(render.right);
+  print.cv = rmsWindows(render.left);
+  print.bands = spectrumBands(render.right);
+  return print;
+}
+
+void writeLevels(FILE *file, const char *key,
+                 const std::vector<double> &levels) {
+  fprintf(file, "%s", key);
+  for (double level : levels) {
+    fprintf(file, " %.2f", level);
+  }
+  fprintf(file, "\n");
+}
+
+using Golden = std::map<std::string, Fingerprint>;
+
+bool loadGolden(const std::string &path, Golden *golden) {
+  std::ifstream in(path);
+  if (!in) {
+    return false;
+  }
+  std::string line;
+  Fingerprint *current = nullptr;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string key;
+    fields >> key;
+    if (key == "scenario") {
+      std::string name, frames_key, hash_key, hash;
+      fields >> name >> frames_key;
+      current = &(*golden)[name];
+      fields >> current->frames >> hash_key >> hash;
+      current->hash = strtoull(hash.c_str(), nullptr, 16);
+      continue;
+    }
+    if (current == nullptr) {
+      return false;
+    }
+    std::vector<double> *levels = key == "rms"     ? &current->rms
+                                  : key == "cv"    ? &current->cv
+                                  : key == "bands" ? &current->bands
+                                                   : nullptr;
+    if (levels == nullptr) {
+      return false;
+    }
+    double level;
+    while (fields >> level) {
+      levels->push_back(level);
+    }
+  }
+  return true;
+}
+
+/** Largest difference over the compared values, or -1 on a length mismatch. */
+double maxRmsDiff(const std::vector<double> &golden,
+                  const std::vector<double> &render) {
+  if (golden.size() != render.size()) {
+    return -1.0;
+  }
+  double diff = 0.0;
+  for (size_t i = 0; i < golden.size(); i++) {
+    if (golden[i] < kRmsCompareFloorDb && render[i] < kRmsCompareFloorDb) {
+      continue;
+    }
+    diff = std::max(diff, std::fabs(golden[i] - render[i]));
+  }
+  return diff;
+}
+
+double maxBandDiff(const std::vector<double> &golden,
+                   const std::vector<double> &render) {
+  if (golden.size() != render.size() || golden.empty()) {
+    return -1.0;
+  }
+  const double loudest = *std::max_element(golden.begin(), golden.end());
+  double diff = 0.0;
+  for (size_t i = 0; i < golden.size(); i++) {
+    if (golden[i] < loudest - kBandCompareRangeDb) {
+      continue;
+    }
+    diff = std::max(diff, std::fabs(golden[i] - render[i]));
+  }
+  return diff;
+}
+
+bool writeWav(const std::string &path, const Render &render) {
+  AutosaveHost::WavWriter wav;
+  if (!wav.open(path, 2, TeensyHost::kSampleRate)) {
+    return false;
+  }
+  std::vector<int16_t> frames;
+  for (size_t i = 0; i < render.right.size(); i++) {
+    frames.push_back(render.left[i]);
+    frames.push_back(render.right[i]);
+  }
+  wav.write(frames.data(), render.right.size());
+  return true;
+}
+
+void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --save file           write the renders as golden fingerprints\n"
+          "  --compare file        compare with golden fingerprints, exit 2 "
+          "on a mismatch\n"
+          "  --only name           run a single scenario\n"
+          "  --wav-dir dir         also write each render as dir/name.wav\n"
+          "  --rms-tolerance dB    allowed RMS difference per window "
+          "(default: %.1f)\n"
+          "  --band-tolerance dB   allowed difference per spectrum band "
+          "(default: %.1f)\n",
+          program, kDefaultRmsToleranceDb, kDefaultBandToleranceDb);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string save_path;
+  std::string compare_path;
+  std::string only;
+  std::string wav_dir;
+  double rms_tolerance = kDefaultRmsToleranceDb;
+  double band_tolerance = kDefaultBandToleranceDb;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[++i] : nullptr;
+    bool ok = true;
+    if (value == nullptr) {
+      ok = false;
+    } else if (strcmp(arg, "--save") == 0) {
+      save_path = value;
+    } else if (strcmp(arg, "--compare") == 0) {
+      compare_path = value;
+    } else if (strcmp(arg, "--only") == 0) {
+      only = value;
+    } else if (strcmp(arg, "--wav-dir") == 0) {
+      wav_dir = value;
+    } else if (strcmp(arg, "--rms-tolerance") == 0) {
+      rms_tolerance = atof(value);
+    } else if (strcmp(arg, "--band-tolerance") == 0) {
+      band_tolerance = atof(value);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      fprintf(stderr, "invalid option: %s\n", arg);
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  Golden golden;
+  if (!compare_path.empty()) {
+    if (!loadGolden(compare_path, &golden)) {
+      fprintf(stderr, "cannot read %s\n", compare_path.c_str());
+      return 1;
+    }
+    if (Autosave::audio_config::voices_number != kGoldenVoices) {
+      fprintf(stderr, "golden renders need AUTOSAVE_VOICES=%u\n",
+              kGoldenVoices);
+      return 1;
+    }
+  }
+
+  FILE *save = nullptr;
+  if (!save_path.empty()) {
+    save = fopen(save_path.c_str(), "w");
+    if (save == nullptr) {
+      fprintf(stderr, "cannot write %s\n", save_path.c_str());
+      return 1;
+    }
+    fprintf(save,
+            "# le-synth golden renders (%u voices, drift seed %u): frames "
+            "and FNV-1a hash,\n# RMS dB per %u frames of audio and CV, "
+            "audio spectrum dB per third-octave from %.0f Hz\n",
+            kGoldenVoices, kDriftSeed, kRmsWindowFrames, kFirstBandHz);
+  }
+
+  printf("%-18s %8s %16s %9s %9s %9s  %s\n", "scenario", "frames", "hash",
+         "rms dB", "cv dB", "band dB", "result");
+
+  int failures = 0;
+  int ran = 0;
+  for (const Scenario &scenario : kScenarios) {
+    if (!only.empty() && only != scenario.name) {
+      continue;
+    }
+    ran++;
+    Render render;
+    if (!renderIsolated(scenario, &render)) {
+      printf("%-18s render failed\n", scenario.name);
+      failures++;
+      continue;
+    }
+    if (!wav_dir.empty() &&
+        !writeWav(wav_dir + "/" + scenario.name + ".wav", render)) {
+      fprintf(stderr, "cannot write %s/%s.wav\n", wav_dir.c_str(),
+              scenario.name);
+    }
+
+    const Fingerprint print = fingerprint(render);
+    if (save != nullptr) {
+      fprintf(save, "scenario %s frames %llu hash %016llx\n", scenario.name,
+              (unsigned long long)print.frames,
+              (unsigned long long)print.hash);
+      writeLevels(save, "rms", print.rms);
+      writeLevels(save, "cv", print.cv);
+      writeLevels(save, "bands", print.bands);
+    }
+
+    printf("%-18s %8llu %016llx", scenario.name,
+           (unsigned long long)print.frames, (unsigned long long)print.hash);
+    if (compare_path.empty()) {
+      printf("\n");
+      continue;
+    }
+    auto it = golden.find(scenario.name);
+    if (it == golden.end()) {
+      printf(" %9s %9s %9s  MISSING\n", "-", "-", "-");
+      failures++;
+      continue;
+    }
+    const Fingerprint &expected = it->second;
+    const double rms = maxRmsDiff(expected.rms, print.rms);
+    const double cv = maxRmsDiff(expected.cv, print.cv);
+    const double bands = maxBandDiff(expected.bands, print.bands);
+    const char *result = "ok";
+    if (expected.frames == print.frames && expected.hash == print.hash) {
+      result = "bit-exact";
+    } else if (expected.frames != print.frames || rms < 0.0 || cv < 0.0 ||
+               bands < 0.0 || rms > rms_tolerance || cv > rms_tolerance ||
+               bands > band_tolerance) {
+      result = "FAIL";
+      failures++;
+    }
+    printf(" %9.2f %9.2f %9.2f  %s\n", rms, cv, bands, result);
+  }
+
+  if (save != nullptr) {
+    fclose(save);
+  }
+  if (ran == 0) {
+    fprintf(stderr, "no scenario named %s\n", only.c_str());
+    return 1;
+  }
+  if (!compare_path.empty()) {
+    printf("\n%d of %d scenario(s) differ from %s\n", failures, ran,
+           compare_path.c_str());
+  }
+  return failures > 0 ? 2 : 0;
+}
@@ -0,0 +1,191 @@
+/**
+ * Offline renderer: plays a Standard MIDI File through Autosave::Synth in
+ * virtual time and writes the AudioOutputI2S streams to a stereo WAV
+ * (left = filter envelope CV, right = audio), as fast as the CPU allows.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "TeensyHost.h"
+#include "common/MidiFile.h"
+#include "common/Renderer.h"
+#include "common/WavWriter.h"
+#include "core/EepromStorage.h"
+#include "core/Synth.h"
+#include "core/states/ArpSynthState.h"
+
+namespace {
+
+void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s <input.mid> <output.wav> [options]\n"
+          "  --mode mono|poly|arp       synth mode (default: poly)\n"
+          "  --waveform saw|square|custom  (default: saw)\n"
+          "  --arp-pattern 0..2         switch 2 position in arp mode\n"
+          "  --arp-steps 0,2,1,3        steps for the selected pattern\n"
+          "  --pot1/--pot2/--pot3 v     pot positions, 0..1\n"
+          "  --attack v --release v     envelope pots, 0..1\n"
+          "  --clock                    send MIDI clock from the tempo map\n"
+          "                             (always on in arp mode)\n"
+          "  --tail s                   seconds rendered after the last "
+          "event (default: 1)\n",
+          program);
+}
+
+bool parseChoice(const char *value, const char *const *choices, int count,
+                 uint8_t *out) {
+  for (int i = 0; i < count; i++) {
+    if (strcmp(value, choices[i]) == 0) {
+      *out = (uint8_t)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<uint8_t> parseSteps(const char *value) {
+  std::vector<uint8_t> steps;
+  const char *p = value;
+  while (*p != '\0' &&
+         steps.size() < Autosave::EepromStorage::kMaxArpSteps) {
+    steps.push_back((uint8_t)strtoul(p, const_cast<char **>(&p), 10));
+    if (*p == ',') {
+      p++;
+    } else {
+      break;
+    }
+  }
+  return steps;
+}
+
+void writeBlock(const int16_t *left, const int16_t *right, void *ctx) {
+  int16_t frames[TeensyHost::kBlockSamples * 2];
+  for (uint32_t i = 0; i < TeensyHost::kBlockSamples; i++) {
+    frames[i * 2] = left[i];
+    frames[i * 2 + 1] = right[i];
+  }
+  static_cast<AutosaveHost::WavWriter *>(ctx)->write(
+      frames, TeensyHost::kBlockSamples);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    usage(argv[0]);
+    return 1;
+  }
+  const std::string input = argv[1];
+  const std::string output = argv[2];
+
+  static const char *const kModes[] = {"mono", "poly", "arp"};
+  static const char *const kWaveforms[] = {"saw", "square", "custom"};
+
+  AutosaveHost::PanelSettings panel;
+  std::vector<uint8_t> arp_steps;
+  bool clock = false;
+  double tail = 1.0;
+
+  for (int i = 3; i < argc; i++) {
+    const char *arg = argv[i];
+    if (strcmp(arg, "--clock") == 0) {
+      clock = true;
+      continue;
+    }
+    const char *value = i + 1 < argc ? argv[++i] : nullptr;
+    bool ok = true;
+    if (value == nullptr) {
+      ok = false;
+    } else if (strcmp(arg, "--mode") == 0) {
+      ok = parseChoice(value, kModes, 3, &panel.mode);
+    } else if (strcmp(arg, "--waveform") == 0) {
+      ok = parseChoice(value, kWaveforms, 3, &panel.waveform);
+    } else if (strcmp(arg, "--arp-pattern") == 0) {
+      panel.switch_2 = (uint8_t)atoi(value);
+      ok = panel.switch_2 <= 2;
+    } else if (strcmp(arg, "--arp-steps") == 0) {
+      arp_steps = parseSteps(value);
+      ok = !arp_steps.empty();
+    } else if (strcmp(arg, "--pot1") == 0) {
+      panel.pot_1 = atof(value);
+    } else if (strcmp(arg, "--pot2") == 0) {
+      panel.pot_2 = atof(value);
+    } else if (strcmp(arg, "--pot3") == 0) {
+      panel.pot_3 = atof(value);
+    } else if (strcmp(arg, "--attack") == 0) {
+      panel.attack = atof(value);
+    } else if (strcmp(arg, "--release") == 0) {
+      panel.release = atof(value);
+    } else if (strcmp(arg, "--tail") == 0) {
+      tail = atof(value);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      fprintf(stderr, "invalid option: %s\n", arg);
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  AutosaveHost::MidiFile midi_file;
+  std::string error;
+  if (!midi_file.load(input, &error)) {
+    fprintf(stderr, "%s: %s\n", input.c_str(), error.c_str());
+    return 1;
+  }
+
+  std::vector<AutosaveHost::MidiEvent> events = midi_file.events();
+  if (clock || panel.mode == 2) {
+    events = AutosaveHost::MidiFile::merge(
+        midi_file.clockEvents(midi_file.duration() + tail), events);
+  }
+
+  AutosaveHost::WavWriter wav;
+  if (!wav.open(output, 2, TeensyHost::kSampleRate)) {
+    fprintf(stderr, "cannot write %s\n", output.c_str());
+    return 1;
+  }
+
+  Autosave::Synth synth;
+  AutosaveHost::Renderer renderer(synth);
+  renderer.applyPanel(panel);
+  renderer.begin();
+
+  // The arp state only latches the pattern switch when it moves, as on the
+  // panel; flick it so a non-default pattern is picked up.
+  if (panel.mode == 2 && panel.switch_2 != 0) {
+    AutosaveHost::PanelSettings flicked = panel;
+    flicked.switch_2 = 0;
+    renderer.applyPanel(flicked);
+    renderer.settle(0.05);
+    renderer.applyPanel(panel);
+    renderer.settle(0.05);
+  }
+
+  // A blank EEPROM has no arp steps (and the arp state indexes them
+  // unchecked); give every pattern something to play.
+  for (auto &steps : Autosave::ArpSynthState::arp_mode_steps) {
+    if (steps.empty()) {
+      steps = {0, 1, 2, 3, 4, 5, 6, 7};
+    }
+  }
+  if (!arp_steps.empty()) {
+    Autosave::ArpSynthState::arp_mode_steps[panel.switch_2] = arp_steps;
+  }
+
+  const uint64_t start_ns = TeensyHost::wallNanos();
+  renderer.play(events, tail, writeBlock, &wav);
+  const double wall_s = (TeensyHost::wallNanos() - start_ns) / 1e9;
+
+  const double audio_s = (double)wav.frames() / TeensyHost::kSampleRate;
+  wav.close();
+
+  printf("%s: %.2f s of audio in %.3f s (%.1fx realtime)\n", output.c_str(),
+         audio_s, wall_s, wall_s > 0.0 ? audio_s / wall_s : 0.0);
+  return 0;
+}
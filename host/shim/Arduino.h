@@ -0,0 +1,169 @@
+#ifndef TEENSY_HOST_ARDUINO_H
+#define TEENSY_HOST_ARDUINO_H
+
+/**
+ * Host stand-in for the Teensy 4.0 Arduino core.
+ *
+ * Only the subset used by le-synth is provided. Time is virtual and driven by
+ * TeensyHost (see TeensyHost.h) so renders are deterministic and can run many
+ * times faster than realtime.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "IntervalTimer.h"
+#include "WString.h"
+
+typedef uint8_t byte;
+
+#define F_CPU_ACTUAL 600000000u
+#define F_CPU F_CPU_ACTUAL
+
+#define DMAMEM
+#define FASTRUN
+#define FLASHMEM
+#define PROGMEM
+
+#define LOW 0
+#define HIGH 1
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+
+// Teensy 4.0 analog pin numbers.
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define A8 22
+#define A9 23
+
+#define NUM_DIGITAL_PINS 40
+
+// Cycle counter (DWT) stand-in; see TeensyHost::cycleCount().
+#define ARM_DWT_CYCCNT (TeensyHost::cycleCount())
+
+namespace TeensyHost {
+uint32_t cycleCount();
+} // namespace TeensyHost
+
+namespace TeensyHost {
+/**
+ * ADC1/ADC2 register stand-in (imxrt.h), enough for a split-phase read:
+ * writing HC0 converts the channel's pin at once and sets COCO0 in HS, and
+ * reading R0 returns the result and clears it.
+ */
+class Adc {
+public:
+  struct Control {
+    Adc *adc;
+    Control &operator=(uint32_t value);
+  };
+
+  Control hc0{this};
+  uint32_t hs() const { return complete_ ? 1u : 0u; }
+  uint32_t r0();
+
+private:
+  uint32_t result_ = 0;
+  bool complete_ = false;
+};
+
+/** 0: ADC1, 1: ADC2. */
+Adc &adc(uint8_t index);
+} // namespace TeensyHost
+
+#define ADC1_HC0 (TeensyHost::adc(0).hc0)
+#define ADC1_HS (TeensyHost::adc(0).hs())
+#define ADC1_R0 (TeensyHost::adc(0).r0())
+#define ADC2_HC0 (TeensyHost::adc(1).hc0)
+#define ADC2_HS (TeensyHost::adc(1).hs())
+#define ADC2_R0 (TeensyHost::adc(1).r0())
+#define ADC_HC_ADCH(n) ((uint32_t)((n) & 0x1F))
+#define ADC_HS_COCO0 ((uint32_t)(1 << 0))
+
+inline void __disable_irq() {}
+inline void __enable_irq() {}
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+int analogRead(uint8_t pin);
+void analogReadResolution(unsigned int bits);
+void analogReadAveraging(unsigned int num);
+void analogWrite(uint8_t pin, int value);
+void analogWriteResolution(unsigned int bits);
+void analogWriteFrequency(uint8_t pin, float frequency);
+
+void randomSeed(uint32_t seed);
+int32_t random(int32_t howbig);
+int32_t random(int32_t howsmall, int32_t howbig);
+
+/** Minimal Print/Stream used for Serial and Serial1. */
+class HostSerial {
+public:
+  explicit HostSerial(bool echo) : echo_(echo) {}
+
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  explicit operator bool() const { return true; }
+
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t b);
+  size_t write(const uint8_t *buffer, size_t size);
+  void flush() {}
+
+  size_t print(const char *s);
+  size_t print(const String &s) { return print(s.c_str()); }
+  size_t print(char c);
+  size_t print(int v) { return print(String(v)); }
+  size_t print(unsigned int v) { return print(String(v)); }
+  size_t print(long v) { return print(String(v)); }
+  size_t print(unsigned long v) { return print(String(v)); }
+  size_t print(double v, int digits = 2) { return print(String(v, digits)); }
+
+  size_t println() { return print("\n"); }
+  template <typename T> size_t println(const T &v) {
+    size_t n = print(v);
+    return n + println();
+  }
+
+  /** Host side: queue bytes to be returned by read(). */
+  void injectRx(const uint8_t *data, size_t size);
+  /** Host side: bytes written by the firmware since the last call. */
+  size_t drainTx(uint8_t *out, size_t max);
+
+private:
+  bool echo_;
+  uint8_t rx_[1024];
+  size_t rx_head_ = 0;
+  size_t rx_tail_ = 0;
+  uint8_t tx_[1024];
+  size_t tx_len_ = 0;
+};
+
+typedef HostSerial HardwareSerial;
+typedef HostSerial usb_serial_class;
+
+extern HostSerial Serial;
+extern HostSerial Serial1;
+
+#endif
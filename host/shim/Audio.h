@@ -0,0 +1,14 @@
+#ifndef TEENSY_HOST_AUDIO_H
+#define TEENSY_HOST_AUDIO_H
+
+// Host stand-in for the Teensy Audio Library umbrella header (subset).
+
+#include "AudioStream.h"
+#include "effect_envelope.h"
+#include "mixer.h"
+#include "output_i2s.h"
+#include "synth_dc.h"
+#include "synth_sine.h"
+#include "synth_waveform.h"
+
+#endif
@@ -0,0 +1,285 @@
+#include "AudioStream.h"
+
+#include "TeensyHost.h"
+
+namespace {
+constexpr unsigned int kMaxAudioMemory = 1024;
+constexpr unsigned int kNumMasks = kMaxAudioMemory / 32;
+} // namespace
+
+audio_block_t *AudioStream::memory_pool = nullptr;
+uint32_t AudioStream::memory_pool_available_mask[kNumMasks];
+uint16_t AudioStream::memory_pool_first_mask = 0;
+
+uint16_t AudioStream::cpu_cycles_total = 0;
+uint16_t AudioStream::cpu_cycles_total_max = 0;
+uint16_t AudioStream::memory_used = 0;
+uint16_t AudioStream::memory_used_max = 0;
+bool AudioStream::interrupts_masked = false;
+
+bool AudioStream::update_scheduled = false;
+AudioStream *AudioStream::first_update = nullptr;
+
+AudioStream::AudioStream(unsigned char ninput, audio_block_t **iqueue)
+    : cpu_cycles(0), cpu_cycles_max(0), host_cycles(0), host_updates(0),
+      active(false), num_inputs(ninput), numConnections(0),
+      destination_list(nullptr), inputQueue(iqueue), next_update(nullptr) {
+  for (int i = 0; i < num_inputs; i++) {
+    inputQueue[i] = nullptr;
+  }
+  // add to a simple list, for update_all
+  if (first_update == nullptr) {
+    first_update = this;
+  } else {
+    AudioStream *p;
+    for (p = first_update; p->next_update; p = p->next_update) {
+    }
+    p->next_update = this;
+  }
+}
+
+AudioStream::~AudioStream() {
+  for (int i = 0; i < num_inputs; i++) {
+    if (inputQueue[i] != nullptr) {
+      release(inputQueue[i]);
+      inputQueue[i] = nullptr;
+    }
+  }
+  if (first_update == this) {
+    first_update = next_update;
+    return;
+  }
+  for (AudioStream *p = first_update; p != nullptr; p = p->next_update) {
+    if (p->next_update == this) {
+      p->next_update = next_update;
+      return;
+    }
+  }
+}
+
+void AudioStream::initialize_memory(audio_block_t *data, unsigned int num) {
+  if (num > kMaxAudioMemory) {
+    num = kMaxAudioMemory;
+  }
+  memory_pool = data;
+  memory_pool_first_mask = 0;
+  for (unsigned int i = 0; i < kNumMasks; i++) {
+    memory_pool_available_mask[i] = 0;
+  }
+  for (unsigned int i = 0; i < num; i++) {
+    memory_pool_available_mask[i >> 5] |= (1u << (i & 0x1F));
+  }
+  for (unsigned int i = 0; i < num; i++) {
+    data[i].memory_pool_index = i;
+  }
+  memory_used = 0;
+  memory_used_max = 0;
+  update_scheduled = true;
+}
+
+audio_block_t *AudioStream::allocate(void) {
+  if (memory_pool == nullptr) {
+    return nullptr;
+  }
+  for (unsigned int index = memory_pool_first_mask; index < kNumMasks;
+       index++) {
+    uint32_t avail = memory_pool_available_mask[index];
+    if (avail == 0) {
+      continue;
+    }
+    uint32_t n = __builtin_clz(avail);
+    avail &= ~(0x80000000u >> n);
+    memory_pool_available_mask[index] = avail;
+    memory_pool_first_mask = index;
+    uint16_t used = memory_used + 1;
+    memory_used = used;
+    if (used > memory_used_max) {
+      memory_used_max = used;
+    }
+    audio_block_t *block = memory_pool + ((index << 5) + (31 - n));
+    block->ref_count = 1;
+    return block;
+  }
+  return nullptr;
+}
+
+void AudioStream::release(audio_block_t *block) {
+  if (block == nullptr) {
+    return;
+  }
+  if (block->ref_count > 1) {
+    block->ref_count--;
+    return;
+  }
+  uint32_t index = block->memory_pool_index >> 5;
+  memory_pool_available_mask[index] |=
+      (0x80000000u >> (31 - (block->memory_pool_index & 0x1F)));
+  if (index < memory_pool_first_mask) {
+    memory_pool_first_mask = index;
+  }
+  memory_used--;
+}
+
+void AudioStream::transmit(audio_block_t *block, unsigned char index) {
+  for (AudioConnection *c = destination_list; c != nullptr;
+       c = c->next_dest) {
+    if (c->src_index == index) {
+      if (c->dst->inputQueue[c->dest_index] == nullptr) {
+        c->dst->inputQueue[c->dest_index] = block;
+        block->ref_count++;
+      }
+    }
+  }
+}
+
+audio_block_t *AudioStream::receiveReadOnly(unsigned int index) {
+  if (index >= num_inputs) {
+    return nullptr;
+  }
+  audio_block_t *in = inputQueue[index];
+  inputQueue[index] = nullptr;
+  return in;
+}
+
+audio_block_t *AudioStream::receiveWritable(unsigned int index) {
+  if (index >= num_inputs) {
+    return nullptr;
+  }
+  audio_block_t *in = inputQueue[index];
+  inputQueue[index] = nullptr;
+  if (in != nullptr && in->ref_count > 1) {
+    audio_block_t *p = allocate();
+    if (p != nullptr) {
+      memcpy(p->data, in->data, sizeof(p->data));
+    }
+    in->ref_count--;
+    in = p;
+  }
+  return in;
+}
+
+bool AudioStream::update_setup(void) { return !update_scheduled; }
+
+void AudioStream::update_stop(void) { update_scheduled = false; }
+
+void software_isr(void) {
+  uint32_t totalcycles = ARM_DWT_CYCCNT;
+  for (AudioStream *p = AudioStream::first_update; p != nullptr;
+       p = p->next_update) {
+    if (p->active) {
+      uint32_t cycles = ARM_DWT_CYCCNT;
+      p->update();
+      cycles = ARM_DWT_CYCCNT - cycles;
+      p->host_cycles += cycles;
+      p->host_updates++;
+      cycles >>= 6;
+      p->cpu_cycles = cycles;
+      if (cycles > p->cpu_cycles_max) {
+        p->cpu_cycles_max = cycles;
+      }
+    }
+  }
+  totalcycles = (ARM_DWT_CYCCNT - totalcycles) >> 6;
+  AudioStream::cpu_cycles_total = totalcycles;
+  if (totalcycles > AudioStream::cpu_cycles_total_max) {
+    AudioStream::cpu_cycles_total_max = totalcycles;
+  }
+}
+
+AudioConnection::AudioConnection()
+    : src(nullptr), dst(nullptr), src_index(0), dest_index(0),
+      next_dest(nullptr), isConnected(false) {}
+
+AudioConnection::AudioConnection(AudioStream &source,
+                                 unsigned char sourceOutput,
+                                 AudioStream &destination,
+                                 unsigned char destinationInput)
+    : AudioConnection() {
+  connect(source, sourceOutput, destination, destinationInput);
+}
+
+AudioConnection::~AudioConnection() { disconnect(); }
+
+int AudioConnection::connect(AudioStream &source, unsigned char sourceOutput,
+                             AudioStream &destination,
+                             unsigned char destinationInput) {
+  if (isConnected) {
+    return 1;
+  }
+  src = &source;
+  dst = &destination;
+  src_index = sourceOutput;
+  dest_index = destinationInput;
+  return connect();
+}
+
+int AudioConnection::connect(void) {
+  if (isConnected) {
+    return 1;
+  }
+  if (src == nullptr || dst == nullptr) {
+    return 2;
+  }
+  if (dest_index >= dst->num_inputs) {
+    return 3;
+  }
+
+  // Append to the source's destination list, refusing duplicate inputs.
+  AudioConnection *p = src->destination_list;
+  if (p == nullptr) {
+    src->destination_list = this;
+  } else {
+    while (true) {
+      if (p->dst == dst && p->dest_index == dest_index) {
+        return 4;
+      }
+      if (p->next_dest == nullptr) {
+        break;
+      }
+      p = p->next_dest;
+    }
+    p->next_dest = this;
+  }
+  next_dest = nullptr;
+  src->numConnections++;
+  src->active = true;
+  dst->numConnections++;
+  dst->active = true;
+  isConnected = true;
+  return 0;
+}
+
+int AudioConnection::disconnect(void) {
+  if (!isConnected || src == nullptr) {
+    return 1;
+  }
+
+  AudioConnection *p = src->destination_list;
+  if (p == this) {
+    src->destination_list = next_dest;
+  } else {
+    while (p != nullptr && p->next_dest != this) {
+      p = p->next_dest;
+    }
+    if (p != nullptr) {
+      p->next_dest = next_dest;
+    }
+  }
+  next_dest = nullptr;
+
+  if (dst->inputQueue[dest_index] != nullptr) {
+    AudioStream::release(dst->inputQueue[dest_index]);
+    dst->inputQueue[dest_index] = nullptr;
+  }
+
+  src->numConnections--;
+  if (src->numConnections == 0) {
+    src->active = false;
+  }
+  dst->numConnections--;
+  if (dst->numConnections == 0) {
+    dst->active = false;
+  }
+  isConnected = false;
+  return 0;
+}
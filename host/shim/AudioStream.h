@@ -0,0 +1,143 @@
+#ifndef TEENSY_HOST_AUDIO_STREAM_H
+#define TEENSY_HOST_AUDIO_STREAM_H
+
+/**
+ * Host stand-in for cores/teensy4/AudioStream.h.
+ *
+ * Same block pool, reference counting, connection and update-list semantics
+ * as the Teensy core; the software interrupt is replaced by a synchronous call
+ * from TeensyHost when virtual time crosses a block boundary.
+ */
+
+#include "Arduino.h"
+
+#define AUDIO_BLOCK_SAMPLES 128
+#define AUDIO_SAMPLE_RATE_EXACT 44100.0f
+#define AUDIO_SAMPLE_RATE AUDIO_SAMPLE_RATE_EXACT
+
+#define CYCLE_COUNTER_APPROX_PERCENT(n)                                        \
+  (((float)((uint32_t)(n) * 6400u) *                                          \
+    (float)(AUDIO_SAMPLE_RATE_EXACT / AUDIO_BLOCK_SAMPLES)) /                  \
+   (float)(F_CPU_ACTUAL))
+
+class AudioStream;
+class AudioConnection;
+
+typedef struct audio_block_struct {
+  uint8_t ref_count;
+  uint8_t reserved1;
+  uint16_t memory_pool_index;
+  int16_t data[AUDIO_BLOCK_SAMPLES];
+} audio_block_t;
+
+class AudioConnection {
+public:
+  AudioConnection(AudioStream &source, AudioStream &destination)
+      : AudioConnection(source, 0, destination, 0) {}
+  AudioConnection(AudioStream &source, unsigned char sourceOutput,
+                  AudioStream &destination, unsigned char destinationInput);
+  AudioConnection();
+  ~AudioConnection();
+  int disconnect(void);
+  int connect(void);
+  int connect(AudioStream &source, AudioStream &destination) {
+    return connect(source, 0, destination, 0);
+  }
+  int connect(AudioStream &source, unsigned char sourceOutput,
+              AudioStream &destination, unsigned char destinationInput);
+
+protected:
+  AudioStream *src;
+  AudioStream *dst;
+  unsigned char src_index;
+  unsigned char dest_index;
+  AudioConnection *next_dest;
+  bool isConnected;
+
+  friend class AudioStream;
+};
+
+#define AudioMemory(num)                                                       \
+  ({                                                                           \
+    static DMAMEM audio_block_t data[num];                                     \
+    AudioStream::initialize_memory(data, num);                                 \
+  })
+
+#define AudioProcessorUsage()                                                  \
+  (CYCLE_COUNTER_APPROX_PERCENT(AudioStream::cpu_cycles_total))
+#define AudioProcessorUsageMax()                                               \
+  (CYCLE_COUNTER_APPROX_PERCENT(AudioStream::cpu_cycles_total_max))
+#define AudioProcessorUsageMaxReset()                                          \
+  (AudioStream::cpu_cycles_total_max = AudioStream::cpu_cycles_total)
+#define AudioMemoryUsage() (AudioStream::memory_used)
+#define AudioMemoryUsageMax() (AudioStream::memory_used_max)
+#define AudioMemoryUsageMaxReset()                                             \
+  (AudioStream::memory_used_max = AudioStream::memory_used)
+
+// The software interrupt cannot preempt host code; masking is bookkeeping.
+#define AudioNoInterrupts() (AudioStream::interrupts_masked = true)
+#define AudioInterrupts() (AudioStream::interrupts_masked = false)
+
+void software_isr(void);
+
+class AudioStream {
+public:
+  AudioStream(unsigned char ninput, audio_block_t **iqueue);
+  /** Host only: unlink from the update list (Teensy objects are static). */
+  virtual ~AudioStream();
+
+  static void initialize_memory(audio_block_t *data, unsigned int num);
+
+  float processorUsage(void) { return CYCLE_COUNTER_APPROX_PERCENT(cpu_cycles); }
+  float processorUsageMax(void) {
+    return CYCLE_COUNTER_APPROX_PERCENT(cpu_cycles_max);
+  }
+  void processorUsageMaxReset(void) { cpu_cycles_max = cpu_cycles; }
+  bool isActive(void) { return active; }
+
+  uint16_t cpu_cycles;
+  uint16_t cpu_cycles_max;
+  /**
+   * Host only: full-resolution cycle total and update count since the last
+   * reset (cpu_cycles drops the low 6 bits, too coarse for host timings).
+   */
+  uint64_t host_cycles;
+  uint32_t host_updates;
+  void hostCyclesReset(void) {
+    host_cycles = 0;
+    host_updates = 0;
+  }
+  static uint16_t cpu_cycles_total;
+  static uint16_t cpu_cycles_total_max;
+  static uint16_t memory_used;
+  static uint16_t memory_used_max;
+  static bool interrupts_masked;
+
+protected:
+  bool active;
+  unsigned char num_inputs;
+  static audio_block_t *allocate(void);
+  static void release(audio_block_t *block);
+  void transmit(audio_block_t *block, unsigned char index = 0);
+  audio_block_t *receiveReadOnly(unsigned int index = 0);
+  audio_block_t *receiveWritable(unsigned int index = 0);
+  static bool update_setup(void);
+  static void update_stop(void);
+  static void update_all(void) { software_isr(); }
+  friend void software_isr(void);
+  friend class AudioConnection;
+  uint8_t numConnections;
+
+private:
+  AudioConnection *destination_list;
+  audio_block_t **inputQueue;
+  static bool update_scheduled;
+  virtual void update(void) = 0;
+  static AudioStream *first_update;
+  AudioStream *next_update;
+  static audio_block_t *memory_pool;
+  static uint32_t memory_pool_available_mask[];
+  static uint16_t memory_pool_first_mask;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef TEENSY_HOST_EEPROM_H
+#define TEENSY_HOST_EEPROM_H
+
+// Stand-in for the Teensy 4.0 emulated EEPROM (1080 bytes, erased = 0xFF).
+
+#include "Arduino.h"
+
+#define E2END 0x437
+
+class EEPROMClass {
+public:
+  EEPROMClass() { memset(data_, 0xFF, sizeof(data_)); }
+
+  uint8_t read(int idx) {
+    return (idx >= 0 && idx <= E2END) ? data_[idx] : 0;
+  }
+  void write(int idx, uint8_t val) {
+    if (idx >= 0 && idx <= E2END) {
+      data_[idx] = val;
+    }
+  }
+  void update(int idx, uint8_t val) { write(idx, val); }
+  uint16_t length() { return E2END + 1; }
+
+  template <typename T> T &get(int idx, T &t) {
+    uint8_t *ptr = (uint8_t *)&t;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      ptr[i] = read(idx + (int)i);
+    }
+    return t;
+  }
+  template <typename T> const T &put(int idx, const T &t) {
+    const uint8_t *ptr = (const uint8_t *)&t;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      write(idx + (int)i, ptr[i]);
+    }
+    return t;
+  }
+
+  /** Host only: raw storage, e.g. to persist between runs. */
+  uint8_t *data() { return data_; }
+
+private:
+  uint8_t data_[E2END + 1];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
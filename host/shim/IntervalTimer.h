@@ -0,0 +1,25 @@
+#ifndef TEENSY_HOST_INTERVAL_TIMER_H
+#define TEENSY_HOST_INTERVAL_TIMER_H
+
+// Stand-in for the Teensy periodic interrupt timer. Callbacks run in virtual
+// time, between audio updates, as TeensyHost::advanceNanos() crosses them.
+
+#include <cstdint>
+
+class IntervalTimer {
+public:
+  IntervalTimer() {}
+  ~IntervalTimer() { end(); }
+
+  IntervalTimer(const IntervalTimer &) = delete;
+  IntervalTimer &operator=(const IntervalTimer &) = delete;
+
+  bool begin(void (*callback)(), float microseconds);
+  void end();
+  void priority(uint8_t n) { (void)n; }
+
+private:
+  bool running_ = false;
+};
+
+#endif
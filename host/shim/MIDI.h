@@ -0,0 +1,215 @@
+#ifndef TEENSY_HOST_MIDI_H
+#define TEENSY_HOST_MIDI_H
+
+/**
+ * Stand-in for the FortySevenEffects Arduino MIDI Library (v5 API subset).
+ * Parses the byte stream of the wrapped serial port, with running status,
+ * interleaved real-time bytes and SysEx accumulation.
+ */
+
+#include "Arduino.h"
+
+#define MIDI_CHANNEL_OMNI 0
+#define MIDI_CHANNEL_OFF 17
+
+namespace midi {
+
+typedef uint8_t Channel;
+
+template <class SerialPort> class SerialMIDI {
+public:
+  explicit SerialMIDI(SerialPort &port) : port_(port) {}
+  void begin() { port_.begin(31250); }
+  int available() { return port_.available(); }
+  uint8_t read() { return (uint8_t)port_.read(); }
+  void write(uint8_t b) { port_.write(b); }
+
+private:
+  SerialPort &port_;
+};
+
+template <class Transport> class MidiInterface {
+public:
+  static constexpr unsigned SysExMaxSize = 128;
+
+  explicit MidiInterface(Transport &transport) : transport_(transport) {}
+
+  void begin(Channel inChannel = 1) {
+    input_channel_ = inChannel;
+    transport_.begin();
+  }
+
+  bool read() { return read(input_channel_); }
+
+  bool read(Channel inChannel) {
+    while (transport_.available() > 0) {
+      if (parse(transport_.read(), inChannel)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void sendSysEx(unsigned inLength, const uint8_t *inArray,
+                 bool inArrayContainsBoundaries = false) {
+    if (!inArrayContainsBoundaries) {
+      transport_.write(0xF0);
+    }
+    for (unsigned i = 0; i < inLength; i++) {
+      transport_.write(inArray[i]);
+    }
+    if (!inArrayContainsBoundaries) {
+      transport_.write(0xF7);
+    }
+  }
+
+  void setHandleNoteOn(void (*fptr)(Channel, uint8_t, uint8_t)) {
+    note_on_ = fptr;
+  }
+  void setHandleNoteOff(void (*fptr)(Channel, uint8_t, uint8_t)) {
+    note_off_ = fptr;
+  }
+  void setHandleControlChange(void (*fptr)(Channel, uint8_t, uint8_t)) {
+    control_change_ = fptr;
+  }
+  void setHandleSystemExclusive(void (*fptr)(uint8_t *array, unsigned size)) {
+    sysex_ = fptr;
+  }
+  void setHandleClock(void (*fptr)(void)) { clock_ = fptr; }
+  void setHandleStart(void (*fptr)(void)) { start_ = fptr; }
+  void setHandleContinue(void (*fptr)(void)) { continue_ = fptr; }
+  void setHandleStop(void (*fptr)(void)) { stop_ = fptr; }
+
+private:
+  Transport &transport_;
+  Channel input_channel_ = 1;
+
+  uint8_t status_ = 0;
+  uint8_t data_[2] = {0, 0};
+  uint8_t data_count_ = 0;
+  bool in_sysex_ = false;
+  uint8_t sysex_buffer_[SysExMaxSize];
+  unsigned sysex_size_ = 0;
+
+  void (*note_on_)(Channel, uint8_t, uint8_t) = nullptr;
+  void (*note_off_)(Channel, uint8_t, uint8_t) = nullptr;
+  void (*control_change_)(Channel, uint8_t, uint8_t) = nullptr;
+  void (*sysex_)(uint8_t *, unsigned) = nullptr;
+  void (*clock_)(void) = nullptr;
+  void (*start_)(void) = nullptr;
+  void (*continue_)(void) = nullptr;
+  void (*stop_)(void) = nullptr;
+
+  static void call(void (*fptr)(void)) {
+    if (fptr != nullptr) {
+      fptr();
+    }
+  }
+
+  bool parse(uint8_t byte, Channel inChannel) {
+    // Real-time messages may appear anywhere, even inside SysEx.
+    if (byte >= 0xF8) {
+      switch (byte) {
+      case 0xF8:
+        call(clock_);
+        break;
+      case 0xFA:
+        call(start_);
+        break;
+      case 0xFB:
+        call(continue_);
+        break;
+      case 0xFC:
+        call(stop_);
+        break;
+      default:
+        break;
+      }
+      return true;
+    }
+
+    if (byte == 0xF0) {
+      in_sysex_ = true;
+      sysex_size_ = 0;
+      sysex_buffer_[sysex_size_++] = byte;
+      return false;
+    }
+
+    if (in_sysex_) {
+      if (sysex_size_ < SysExMaxSize) {
+        sysex_buffer_[sysex_size_++] = byte;
+      }
+      if (byte == 0xF7) {
+        in_sysex_ = false;
+        status_ = 0;
+        if (sysex_ != nullptr) {
+          sysex_(sysex_buffer_, sysex_size_);
+        }
+        return true;
+      }
+      if (byte & 0x80) {
+        // Unterminated SysEx interrupted by a status byte: drop it.
+        in_sysex_ = false;
+      } else {
+        return false;
+      }
+    }
+
+    if (byte & 0x80) {
+      status_ = byte;
+      data_count_ = 0;
+      return false;
+    }
+    if (status_ == 0) {
+      return false;
+    }
+
+    data_[data_count_++] = byte;
+    uint8_t type = status_ & 0xF0;
+    uint8_t needed = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+    if (data_count_ < needed) {
+      return false;
+    }
+    data_count_ = 0; // running status
+
+    Channel channel = (status_ & 0x0F) + 1;
+    if (inChannel == MIDI_CHANNEL_OFF ||
+        (inChannel != MIDI_CHANNEL_OMNI && inChannel != channel)) {
+      return false;
+    }
+
+    switch (type) {
+    case 0x90:
+      if (data_[1] == 0) {
+        if (note_off_ != nullptr) {
+          note_off_(channel, data_[0], 0);
+        }
+      } else if (note_on_ != nullptr) {
+        note_on_(channel, data_[0], data_[1]);
+      }
+      break;
+    case 0x80:
+      if (note_off_ != nullptr) {
+        note_off_(channel, data_[0], data_[1]);
+      }
+      break;
+    case 0xB0:
+      if (control_change_ != nullptr) {
+        control_change_(channel, data_[0], data_[1]);
+      }
+      break;
+    default:
+      break;
+    }
+    return true;
+  }
+};
+
+} // namespace midi
+
+#define MIDI_CREATE_INSTANCE(Type, SerialPort, Name)                           \
+  midi::SerialMIDI<Type> serial##Name(SerialPort);                             \
+  midi::MidiInterface<midi::SerialMIDI<Type>> Name(                            \
+      (midi::SerialMIDI<Type> &)serial##Name);
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef TEENSY_HOST_RESPONSIVE_ANALOG_READ_H
+#define TEENSY_HOST_RESPONSIVE_ANALOG_READ_H
+
+// Stand-in for dxinteractive/ResponsiveAnalogRead (same smoothing algorithm).
+
+#include "Arduino.h"
+
+class ResponsiveAnalogRead {
+public:
+  ResponsiveAnalogRead() = default;
+  ResponsiveAnalogRead(int pin, bool sleepEnable, float snapMultiplier = 0.01f) {
+    begin(pin, sleepEnable, snapMultiplier);
+  }
+
+  void begin(int pin, bool sleepEnable, float snapMultiplier = 0.01f) {
+    pin_ = pin;
+    sleep_enable_ = sleepEnable;
+    setSnapMultiplier(snapMultiplier);
+  }
+
+  int getValue() { return responsive_value_; }
+  int getRawValue() { return raw_value_; }
+  bool hasChanged() { return changed_; }
+  bool isSleeping() { return sleeping_; }
+
+  void update() { update(analogRead(pin_)); }
+  void update(int rawValueRead) {
+    raw_value_ = rawValueRead;
+    int previous = responsive_value_;
+    responsive_value_ = getResponsiveValue(raw_value_);
+    changed_ = responsive_value_ != previous;
+  }
+
+  void setSnapMultiplier(float newMultiplier) {
+    if (newMultiplier > 1.0f) {
+      newMultiplier = 1.0f;
+    }
+    if (newMultiplier < 0.0f) {
+      newMultiplier = 0.0f;
+    }
+    snap_multiplier_ = newMultiplier;
+  }
+  void enableSleep() { sleep_enable_ = true; }
+  void disableSleep() { sleep_enable_ = false; }
+  void enableEdgeSnap() { edge_snap_enable_ = true; }
+  void disableEdgeSnap() { edge_snap_enable_ = false; }
+  void setActivityThreshold(float newThreshold) {
+    activity_threshold_ = newThreshold;
+  }
+  void setAnalogResolution(int resolution) { analog_resolution_ = resolution; }
+
+private:
+  int pin_ = 0;
+  int analog_resolution_ = 1024;
+  float snap_multiplier_ = 0.01f;
+  bool sleep_enable_ = true;
+  float activity_threshold_ = 4.0f;
+  bool edge_snap_enable_ = true;
+
+  float smooth_value_ = 0.0f;
+  float error_ema_ = 0.0f;
+  bool sleeping_ = false;
+
+  int raw_value_ = 0;
+  int responsive_value_ = 0;
+  bool changed_ = false;
+
+  int getResponsiveValue(int newValue) {
+    if (sleep_enable_ && edge_snap_enable_) {
+      if (newValue < activity_threshold_) {
+        newValue = (newValue * 2) - activity_threshold_;
+      } else if (newValue > analog_resolution_ - activity_threshold_) {
+        newValue = (newValue * 2) - analog_resolution_ + activity_threshold_;
+      }
+    }
+
+    float diff = fabsf((float)newValue - smooth_value_);
+    error_ema_ += (((float)newValue - smooth_value_) - error_ema_) * 0.4f;
+
+    if (sleep_enable_) {
+      sleeping_ = fabsf(error_ema_) < activity_threshold_;
+    }
+    if (sleep_enable_ && sleeping_) {
+      return (int)smooth_value_;
+    }
+
+    float snap = snapCurve(diff * snap_multiplier_);
+    if (sleep_enable_) {
+      snap *= 0.5f + 0.5f;
+    }
+
+    smooth_value_ += ((float)newValue - smooth_value_) * snap;
+    if (smooth_value_ < 0.0f) {
+      smooth_value_ = 0.0f;
+    } else if (smooth_value_ > analog_resolution_ - 1) {
+      smooth_value_ = analog_resolution_ - 1;
+    }
+    return (int)smooth_value_;
+  }
+
+  static float snapCurve(float x) {
+    float y = 1.0f / (x + 1.0f);
+    y = (1.0f - y) * 2.0f;
+    if (y > 1.0f) {
+      return 1.0f;
+    }
+    return y;
+  }
+};
+
+#endif
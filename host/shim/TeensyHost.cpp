@@ -0,0 +1,508 @@
+#include "TeensyHost.h"
+
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <vector>
+
+#include "Arduino.h"
+#include "AudioStream.h"
+#include "EEPROM.h"
+#include "output_i2s.h"
+#include "usb_midi.h"
+
+HostSerial Serial(true);
+HostSerial Serial1(false);
+usb_midi_class usbMIDI;
+EEPROMClass EEPROM;
+
+namespace {
+
+struct UsbMidiMessage {
+  uint8_t type;
+  uint8_t channel;
+  uint8_t data1;
+  uint8_t data2;
+  std::vector<uint8_t> sysex;
+};
+
+struct HostTimer {
+  IntervalTimer *timer;
+  void (*callback)();
+  uint64_t period_ns;
+  uint64_t next_ns;
+};
+
+struct HostState {
+  uint64_t now_ns = 0;
+  uint64_t blocks = 0;
+  bool wall_clock_cycles = false;
+
+  int digital[NUM_DIGITAL_PINS];
+  int analog[NUM_DIGITAL_PINS];
+  int analog_out[NUM_DIGITAL_PINS];
+  unsigned analog_read_bits = 10; // analogReadResolution()
+
+  std::deque<UsbMidiMessage> usb_midi;
+  std::vector<HostTimer> timers;
+
+  TeensyHost::SysExListener sysex_listener = nullptr;
+  void *sysex_ctx = nullptr;
+  TeensyHost::AudioSink audio_sink = nullptr;
+  void *audio_ctx = nullptr;
+
+  uint32_t random_seed = 0;
+
+  HostState() {
+    for (int i = 0; i < NUM_DIGITAL_PINS; i++) {
+      digital[i] = HIGH;
+      analog[i] = 0;
+      analog_out[i] = 0;
+    }
+  }
+};
+
+HostState &host() {
+  static HostState state;
+  return state;
+}
+
+const std::chrono::steady_clock::time_point kWallStart =
+    std::chrono::steady_clock::now();
+
+// Virtual time at which audio block `index` (1-based) is due.
+uint64_t blockDeadlineNanos(uint64_t index) {
+  unsigned __int128 ns = (unsigned __int128)index * TeensyHost::kBlockSamples *
+                         1000000000ull / TeensyHost::kSampleRate;
+  return (uint64_t)ns;
+}
+
+uint32_t nanosToCycles(uint64_t ns) {
+  return (uint32_t)((unsigned __int128)ns * F_CPU_ACTUAL / 1000000000ull);
+}
+
+} // namespace
+
+/***
+ * TeensyHost
+ ***/
+
+namespace TeensyHost {
+
+uint64_t nowNanos() { return host().now_ns; }
+
+uint64_t wallNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - kWallStart)
+      .count();
+}
+
+void setWallClockCycles(bool enabled) { host().wall_clock_cycles = enabled; }
+
+uint32_t cycleCount() {
+  return nanosToCycles(host().wall_clock_cycles ? wallNanos() : host().now_ns);
+}
+
+void updateAudio() {
+  software_isr();
+  if (host().audio_sink != nullptr) {
+    host().audio_sink(AudioOutputI2S::lastBlock(0),
+                      AudioOutputI2S::lastBlock(1), host().audio_ctx);
+  }
+}
+
+/**
+ * Run audio blocks and timer callbacks in deadline order up to `target`. A
+ * timer due at the same time as a block runs first, as its interrupt has the
+ * higher priority on the Teensy.
+ */
+void advanceNanos(uint64_t ns) {
+  HostState &h = host();
+  uint64_t target = h.now_ns + ns;
+  for (;;) {
+    HostTimer *timer = nullptr;
+    for (HostTimer &t : h.timers) {
+      if (timer == nullptr || t.next_ns < timer->next_ns) {
+        timer = &t;
+      }
+    }
+    const uint64_t block_ns = blockDeadlineNanos(h.blocks + 1);
+    if (timer != nullptr && timer->next_ns <= target &&
+        timer->next_ns <= block_ns) {
+      // The callback may start or stop timers: copy it out first.
+      void (*callback)() = timer->callback;
+      h.now_ns = timer->next_ns;
+      timer->next_ns += timer->period_ns;
+      callback();
+    } else if (block_ns <= target) {
+      h.now_ns = block_ns;
+      h.blocks++;
+      updateAudio();
+    } else {
+      break;
+    }
+  }
+  h.now_ns = target;
+}
+
+void advanceMicros(uint64_t us) { advanceNanos(us * 1000ull); }
+
+void advanceBlock() {
+  advanceNanos(blockDeadlineNanos(host().blocks + 1) - host().now_ns);
+}
+
+uint64_t blocksRendered() { return host().blocks; }
+
+void setDigitalPin(uint8_t pin, int level) {
+  if (pin < NUM_DIGITAL_PINS) {
+    host().digital[pin] = level;
+  }
+}
+
+void setAnalogPin(uint8_t pin, int value) {
+  if (pin < NUM_DIGITAL_PINS) {
+    host().analog[pin] = value;
+  }
+}
+
+int analogOutput(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? host().analog_out[pin] : 0;
+}
+
+void injectUsbMidi(uint8_t type, uint8_t channel, uint8_t data1,
+                   uint8_t data2) {
+  host().usb_midi.push_back({type, channel, data1, data2, {}});
+}
+
+void injectUsbRealTime(uint8_t type) {
+  host().usb_midi.push_back({type, 0, 0, 0, {}});
+}
+
+void injectUsbSysEx(const uint8_t *data, size_t size) {
+  host().usb_midi.push_back(
+      {usb_midi_class::SystemExclusive, 0, 0, 0, {data, data + size}});
+}
+
+size_t pendingUsbMidi() { return host().usb_midi.size(); }
+
+void injectSerialMidi(const uint8_t *data, size_t size) {
+  Serial1.injectRx(data, size);
+}
+
+void setSysExListener(SysExListener listener, void *ctx) {
+  host().sysex_listener = listener;
+  host().sysex_ctx = ctx;
+}
+
+void setAudioSink(AudioSink sink, void *ctx) {
+  host().audio_sink = sink;
+  host().audio_ctx = ctx;
+}
+
+} // namespace TeensyHost
+
+/***
+ * Arduino core
+ ***/
+
+uint32_t millis() { return (uint32_t)(host().now_ns / 1000000ull); }
+
+uint32_t micros() { return (uint32_t)(host().now_ns / 1000ull); }
+
+void delay(uint32_t ms) { TeensyHost::advanceMicros((uint64_t)ms * 1000ull); }
+
+void delayMicroseconds(uint32_t us) { TeensyHost::advanceMicros(us); }
+
+void yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin, (void)mode; }
+
+int digitalRead(uint8_t pin) {
+  return pin < NUM_DIGITAL_PINS ? host().digital[pin] : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) { (void)pin, (void)value; }
+
+int analogRead(uint8_t pin) {
+  if (pin >= NUM_DIGITAL_PINS) {
+    return 0;
+  }
+  const int value = host().analog[pin];
+  const int bits = (int)host().analog_read_bits;
+  return bits >= 10 ? value << (bits - 10) : value >> (10 - bits);
+}
+
+void analogReadResolution(unsigned int bits) {
+  host().analog_read_bits = bits;
+}
+
+void analogReadAveraging(unsigned int num) { (void)num; }
+
+namespace TeensyHost {
+
+namespace {
+// ADC input channel to pin, A0 to A9 (Teensy 4.0 analog.c).
+int adcChannelPin(uint32_t channel) {
+  static const uint8_t kChannels[] = {7, 8, 12, 11, 6, 5, 15, 0, 13, 14};
+  for (uint8_t i = 0; i < sizeof(kChannels); i++) {
+    if (kChannels[i] == channel) {
+      return A0 + i;
+    }
+  }
+  return -1;
+}
+} // namespace
+
+Adc::Control &Adc::Control::operator=(uint32_t value) {
+  const int pin = adcChannelPin(value & 0x1F);
+  adc->result_ = pin >= 0 ? (uint32_t)analogRead((uint8_t)pin) : 0;
+  adc->complete_ = true;
+  return *this;
+}
+
+uint32_t Adc::r0() {
+  complete_ = false;
+  return result_;
+}
+
+Adc &adc(uint8_t index) {
+  static Adc adcs[2];
+  return adcs[index & 1];
+}
+
+} // namespace TeensyHost
+
+void analogWrite(uint8_t pin, int value) {
+  if (pin < NUM_DIGITAL_PINS) {
+    host().analog_out[pin] = value;
+  }
+}
+
+void analogWriteResolution(unsigned int bits) { (void)bits; }
+
+void analogWriteFrequency(uint8_t pin, float frequency) {
+  (void)pin, (void)frequency;
+}
+
+/***
+ * IntervalTimer
+ ***/
+
+bool IntervalTimer::begin(void (*callback)(), float microseconds) {
+  if (callback == nullptr || !(microseconds > 0.0f)) {
+    return false;
+  }
+  end();
+  const uint64_t period = (uint64_t)llround(microseconds * 1000.0);
+  host().timers.push_back(
+      {this, callback, period, host().now_ns + period});
+  running_ = true;
+  return true;
+}
+
+void IntervalTimer::end() {
+  if (!running_) {
+    return;
+  }
+  std::vector<HostTimer> &timers = host().timers;
+  for (size_t i = 0; i < timers.size(); i++) {
+    if (timers[i].timer == this) {
+      timers.erase(timers.begin() + i);
+      break;
+    }
+  }
+  running_ = false;
+}
+
+// Same generator as the Teensy core (avr-libc 1.6.4 random()).
+static int32_t nextRandom() {
+  int32_t x = (int32_t)host().random_seed;
+  if (x == 0) {
+    x = 123459876;
+  }
+  int32_t hi = x / 127773;
+  int32_t lo = x % 127773;
+  x = 16807 * lo - 2836 * hi;
+  if (x < 0) {
+    x += 0x7FFFFFFF;
+  }
+  host().random_seed = (uint32_t)x;
+  return x;
+}
+
+void randomSeed(uint32_t seed) {
+  if (seed > 0) {
+    host().random_seed = seed;
+  }
+}
+
+int32_t random(int32_t howbig) {
+  if (howbig <= 0) {
+    return 0;
+  }
+  return nextRandom() % howbig;
+}
+
+int32_t random(int32_t howsmall, int32_t howbig) {
+  if (howsmall >= howbig) {
+    return howsmall;
+  }
+  return random(howbig - howsmall) + howsmall;
+}
+
+/***
+ * Serial ports
+ ***/
+
+int HostSerial::available() {
+  return (int)((rx_head_ + sizeof(rx_) - rx_tail_) % sizeof(rx_));
+}
+
+int HostSerial::read() {
+  if (rx_head_ == rx_tail_) {
+    return -1;
+  }
+  uint8_t b = rx_[rx_tail_];
+  rx_tail_ = (rx_tail_ + 1) % sizeof(rx_);
+  return b;
+}
+
+int HostSerial::peek() {
+  return rx_head_ == rx_tail_ ? -1 : rx_[rx_tail_];
+}
+
+size_t HostSerial::write(uint8_t b) {
+  if (echo_) {
+    fputc(b, stdout);
+    return 1;
+  }
+  if (tx_len_ < sizeof(tx_)) {
+    tx_[tx_len_++] = b;
+  }
+  return 1;
+}
+
+size_t HostSerial::write(const uint8_t *buffer, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    write(buffer[i]);
+  }
+  return size;
+}
+
+size_t HostSerial::print(const char *s) {
+  return write((const uint8_t *)s, strlen(s));
+}
+
+size_t HostSerial::print(char c) { return write((uint8_t)c); }
+
+void HostSerial::injectRx(const uint8_t *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    size_t next = (rx_head_ + 1) % sizeof(rx_);
+    if (next == rx_tail_) {
+      return; // overrun, like a full UART buffer
+    }
+    rx_[rx_head_] = data[i];
+    rx_head_ = next;
+  }
+}
+
+size_t HostSerial::drainTx(uint8_t *out, size_t max) {
+  size_t n = tx_len_ < max ? tx_len_ : max;
+  memcpy(out, tx_, n);
+  memmove(tx_, tx_ + n, tx_len_ - n);
+  tx_len_ -= n;
+  return n;
+}
+
+/***
+ * usbMIDI
+ ***/
+
+void usb_midi_class::sendSysEx(uint32_t length, const uint8_t *data,
+                               bool hasTerm, uint8_t cable) {
+  (void)cable;
+  if (host().sysex_listener == nullptr) {
+    return;
+  }
+  if (hasTerm) {
+    host().sysex_listener(data, length, host().sysex_ctx);
+    return;
+  }
+  std::vector<uint8_t> framed;
+  framed.reserve(length + 2);
+  framed.push_back(0xF0);
+  framed.insert(framed.end(), data, data + length);
+  framed.push_back(0xF7);
+  host().sysex_listener(framed.data(), framed.size(), host().sysex_ctx);
+}
+
+bool usb_midi_class::read(uint8_t channel) {
+  std::deque<UsbMidiMessage> &queue = host().usb_midi;
+  if (queue.empty()) {
+    return false;
+  }
+  UsbMidiMessage msg = queue.front();
+  queue.pop_front();
+
+  msg_type = msg.type;
+  msg_channel = msg.channel;
+  msg_data1 = msg.data1;
+  msg_data2 = msg.data2;
+
+  if (msg.type < SystemExclusive) {
+    if (channel != 0 && channel != msg.channel) {
+      return false;
+    }
+  }
+
+  switch (msg.type) {
+  case NoteOn:
+    if (msg.data2 == 0) {
+      msg_type = NoteOff;
+      if (handleNoteOff != nullptr) {
+        handleNoteOff(msg.channel, msg.data1, msg.data2);
+      }
+    } else if (handleNoteOn != nullptr) {
+      handleNoteOn(msg.channel, msg.data1, msg.data2);
+    }
+    break;
+  case NoteOff:
+    if (handleNoteOff != nullptr) {
+      handleNoteOff(msg.channel, msg.data1, msg.data2);
+    }
+    break;
+  case ControlChange:
+    if (handleControlChange != nullptr) {
+      handleControlChange(msg.channel, msg.data1, msg.data2);
+    }
+    break;
+  case SystemExclusive:
+    if (handleSysExSimple != nullptr) {
+      handleSysExSimple(msg.sysex.data(), (unsigned int)msg.sysex.size());
+    }
+    break;
+  case Clock:
+    if (handleClock != nullptr) {
+      handleClock();
+    }
+    break;
+  case Start:
+    if (handleStart != nullptr) {
+      handleStart();
+    }
+    break;
+  case Continue:
+    if (handleContinue != nullptr) {
+      handleContinue();
+    }
+    break;
+  case Stop:
+    if (handleStop != nullptr) {
+      handleStop();
+    }
+    break;
+  default:
+    break;
+  }
+  return true;
+}
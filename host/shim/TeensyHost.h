@@ -0,0 +1,80 @@
+#ifndef TEENSY_HOST_H
+#define TEENSY_HOST_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Host-side control surface for the Teensy stand-in.
+ *
+ * The firmware never includes this header; host programs (native runner,
+ * renderer, benchmarks) use it to drive virtual time, pins and MIDI ports, and
+ * to collect what AudioOutputI2S receives.
+ */
+namespace TeensyHost {
+
+/** Audio callback period, in samples (AUDIO_BLOCK_SAMPLES). */
+constexpr uint32_t kBlockSamples = 128;
+constexpr uint32_t kSampleRate = 44100;
+
+/** Virtual time since start, in nanoseconds. */
+uint64_t nowNanos();
+
+/**
+ * Advance virtual time. Every audio block boundary crossed runs one audio
+ * update (like the I2S DMA interrupt would) and hands the output to the sink;
+ * every IntervalTimer period crossed runs its callback.
+ */
+void advanceNanos(uint64_t ns);
+void advanceMicros(uint64_t us);
+/** Advance to the start of the next audio block and render it. */
+void advanceBlock();
+/** Total number of audio blocks rendered so far. */
+uint64_t blocksRendered();
+
+/**
+ * ARM_DWT_CYCCNT source. By default it follows virtual time (deterministic);
+ * when wall clock mode is on it follows the host steady clock scaled to
+ * F_CPU_ACTUAL, which is what profilers and benchmarks want.
+ */
+void setWallClockCycles(bool enabled);
+/** Host steady clock, in nanoseconds (independent of virtual time). */
+uint64_t wallNanos();
+
+/** Digital input level seen by digitalRead (default HIGH: pull-ups). */
+void setDigitalPin(uint8_t pin, int level);
+/** Raw 10-bit value, scaled to analogReadResolution() by analogRead. */
+void setAnalogPin(uint8_t pin, int value);
+/** Last value written by analogWrite. */
+int analogOutput(uint8_t pin);
+
+/** Queue a channel voice message on usbMIDI (status without channel bits). */
+void injectUsbMidi(uint8_t type, uint8_t channel, uint8_t data1,
+                   uint8_t data2);
+/** Queue a system real-time message (0xF8 clock, 0xFA start, ...). */
+void injectUsbRealTime(uint8_t type);
+/** Queue a complete SysEx message (including F0 ... F7) on usbMIDI. */
+void injectUsbSysEx(const uint8_t *data, size_t size);
+/** Number of usbMIDI messages waiting to be read. */
+size_t pendingUsbMidi();
+/** Raw bytes on the serial MIDI port (Serial1). */
+void injectSerialMidi(const uint8_t *data, size_t size);
+
+/** SysEx sent by the firmware over usbMIDI since the last call. */
+using SysExListener = void (*)(const uint8_t *data, size_t size, void *ctx);
+void setSysExListener(SysExListener listener, void *ctx);
+
+/** Receives each rendered block: left and right are AUDIO_BLOCK_SAMPLES. */
+using AudioSink = void (*)(const int16_t *left, const int16_t *right,
+                           void *ctx);
+void setAudioSink(AudioSink sink, void *ctx);
+
+/** Run one audio update immediately, without moving virtual time. */
+void updateAudio();
+
+/** Current cycle counter value (see setWallClockCycles). */
+uint32_t cycleCount();
+
+} // namespace TeensyHost
+
+#endif
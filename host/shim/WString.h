@@ -0,0 +1,54 @@
+#ifndef TEENSY_HOST_WSTRING_H
+#define TEENSY_HOST_WSTRING_H
+
+#include <cstdio>
+#include <string>
+
+/** Host stand-in for the Arduino String class (concatenation subset). */
+class String {
+public:
+  String() = default;
+  String(const char *s) : s_(s != nullptr ? s : "") {}
+  String(const std::string &s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(int v) : s_(std::to_string(v)) {}
+  String(unsigned int v) : s_(std::to_string(v)) {}
+  String(long v) : s_(std::to_string(v)) {}
+  String(unsigned long v) : s_(std::to_string(v)) {}
+  String(unsigned char v) : s_(std::to_string(v)) {}
+  String(float v, unsigned char decimals = 2) : String((double)v, decimals) {}
+  String(double v, unsigned char decimals = 2) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    s_ = buf;
+  }
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned int length() const { return (unsigned int)s_.size(); }
+
+  String &operator+=(const String &rhs) {
+    s_ += rhs.s_;
+    return *this;
+  }
+  bool concat(const String &rhs) {
+    s_ += rhs.s_;
+    return true;
+  }
+
+  friend String operator+(const String &lhs, const String &rhs) {
+    return String(lhs.s_ + rhs.s_);
+  }
+  friend String operator+(const char *lhs, const String &rhs) {
+    return String(std::string(lhs) + rhs.s_);
+  }
+  friend String operator+(const String &lhs, const char *rhs) {
+    return String(lhs.s_ + rhs);
+  }
+
+  bool operator==(const String &rhs) const { return s_ == rhs.s_; }
+
+private:
+  std::string s_;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TEENSY_HOST_DSPINST_H
+#define TEENSY_HOST_DSPINST_H
+
+#include <cstdint>
+
+// Portable versions of the Cortex-M DSP helpers used by the audio objects.
+
+static inline int32_t signed_saturate_rshift(int32_t val, int bits, int rshift) {
+  int32_t out = val >> rshift;
+  int32_t max = (1 << (bits - 1)) - 1;
+  int32_t min = -(1 << (bits - 1));
+  if (out > max) {
+    return max;
+  }
+  if (out < min) {
+    return min;
+  }
+  return out;
+}
+
+static inline int16_t saturate16(int32_t val) {
+  if (val > 32767) {
+    return 32767;
+  }
+  if (val < -32768) {
+    return -32768;
+  }
+  return (int16_t)val;
+}
+
+static inline int32_t multiply_32x32_rshift32(int32_t a, int32_t b) {
+  return (int32_t)(((int64_t)a * b) >> 32);
+}
+
+static inline int32_t multiply_32x32_rshift32_rounded(int32_t a, int32_t b) {
+  return (int32_t)(((int64_t)a * b + 0x80000000LL) >> 32);
+}
+
+static inline int32_t signed_multiply_32x16b(int32_t a, uint32_t b) {
+  return (int32_t)(((int64_t)a * (int16_t)(b & 0xFFFF)) >> 16);
+}
+
+static inline int32_t signed_multiply_32x16t(int32_t a, uint32_t b) {
+  return (int32_t)(((int64_t)a * (int16_t)(b >> 16)) >> 16);
+}
+
+#endif
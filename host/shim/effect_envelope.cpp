@@ -0,0 +1,126 @@
+#include "effect_envelope.h"
+
+#define STATE_IDLE 0
+#define STATE_DELAY 1
+#define STATE_ATTACK 2
+#define STATE_HOLD 3
+#define STATE_DECAY 4
+#define STATE_SUSTAIN 5
+#define STATE_RELEASE 6
+#define STATE_FORCED 7
+
+void AudioEffectEnvelope::noteOn(void) {
+  __disable_irq();
+  if (state == STATE_IDLE || state == STATE_DELAY ||
+      release_forced_count == 0) {
+    mult_hires = 0;
+    count = delay_count;
+    if (count > 0) {
+      state = STATE_DELAY;
+      inc_hires = 0;
+    } else {
+      state = STATE_ATTACK;
+      count = attack_count;
+      inc_hires = 0x40000000 / (int32_t)count;
+    }
+  } else if (state != STATE_FORCED) {
+    state = STATE_FORCED;
+    count = release_forced_count;
+    inc_hires = (-mult_hires) / (int32_t)count;
+  }
+  __enable_irq();
+}
+
+void AudioEffectEnvelope::noteOff(void) {
+  __disable_irq();
+  if (state != STATE_IDLE && state != STATE_FORCED) {
+    state = STATE_RELEASE;
+    count = release_count;
+    inc_hires = (-mult_hires) / (int32_t)count;
+  }
+  __enable_irq();
+}
+
+void AudioEffectEnvelope::update(void) {
+  audio_block_t *block = receiveWritable();
+  if (!block) {
+    return;
+  }
+  if (state == STATE_IDLE) {
+    release(block);
+    return;
+  }
+  int16_t *p = block->data;
+  int16_t *end = p + AUDIO_BLOCK_SAMPLES;
+
+  while (p < end) {
+    // we only care about the state when completing a region
+    if (count == 0) {
+      if (state == STATE_ATTACK) {
+        count = hold_count;
+        if (count > 0) {
+          state = STATE_HOLD;
+          mult_hires = 0x40000000;
+          inc_hires = 0;
+        } else {
+          state = STATE_DECAY;
+          count = decay_count;
+          inc_hires = (sustain_mult - 0x40000000) / (int32_t)count;
+        }
+        continue;
+      } else if (state == STATE_HOLD) {
+        state = STATE_DECAY;
+        count = decay_count;
+        inc_hires = (sustain_mult - 0x40000000) / (int32_t)count;
+        continue;
+      } else if (state == STATE_DECAY) {
+        state = STATE_SUSTAIN;
+        count = 0xFFFF;
+        mult_hires = sustain_mult;
+        inc_hires = 0;
+      } else if (state == STATE_SUSTAIN) {
+        count = 0xFFFF;
+      } else if (state == STATE_RELEASE) {
+        state = STATE_IDLE;
+        while (p < end) {
+          *p++ = 0;
+        }
+        break;
+      } else if (state == STATE_FORCED) {
+        mult_hires = 0;
+        count = delay_count;
+        if (count > 0) {
+          state = STATE_DELAY;
+          inc_hires = 0;
+        } else {
+          state = STATE_ATTACK;
+          count = attack_count;
+          inc_hires = 0x40000000 / (int32_t)count;
+        }
+      } else if (state == STATE_DELAY) {
+        state = STATE_ATTACK;
+        count = attack_count;
+        inc_hires = 0x40000000 / count;
+        continue;
+      }
+    }
+
+    int32_t mult = mult_hires >> 14;
+    int32_t inc = inc_hires >> 17;
+    // process 8 samples, using only mult and inc (16 bit resolution)
+    for (int i = 0; i < 8; i++) {
+      *p = (int16_t)((*p * mult) >> 16);
+      p++;
+      mult += inc;
+    }
+    // adjust the long-term gain using 30 bit resolution (fix #102)
+    mult_hires += inc_hires;
+    count--;
+  }
+  transmit(block);
+  release(block);
+}
+
+bool AudioEffectEnvelope::isActive() { return state != STATE_IDLE; }
+
+bool AudioEffectEnvelope::isSustain() { return state == STATE_SUSTAIN; }
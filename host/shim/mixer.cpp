@@ -0,0 +1,79 @@
+#include "mixer.h"
+
+#include "dspinst.h"
+
+namespace {
+
+void applyGain(int16_t *data, int32_t mult) {
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+    data[i] = saturate16((int32_t)(((int64_t)data[i] * mult) >> 16));
+  }
+}
+
+void applyGainThenAdd(int16_t *dst, const int16_t *src, int32_t mult) {
+  if (mult == MULTI_UNITYGAIN) {
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      dst[i] = saturate16((int32_t)dst[i] + src[i]);
+    }
+    return;
+  }
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+    int32_t val = (int32_t)(((int64_t)src[i] * mult) >> 16);
+    dst[i] = saturate16(val + dst[i]);
+  }
+}
+
+} // namespace
+
+void AudioMixer4::update(void) {
+  audio_block_t *out = nullptr;
+  for (unsigned int channel = 0; channel < 4; channel++) {
+    if (!out) {
+      out = receiveWritable(channel);
+      if (out) {
+        int32_t mult = multiplier[channel];
+        if (mult != MULTI_UNITYGAIN) {
+          applyGain(out->data, mult);
+        }
+      }
+    } else {
+      audio_block_t *in = receiveReadOnly(channel);
+      if (in) {
+        applyGainThenAdd(out->data, in->data, multiplier[channel]);
+        release(in);
+      }
+    }
+  }
+  if (out) {
+    transmit(out);
+    release(out);
+  }
+}
+
+void AudioAmplifier::update(void) {
+  audio_block_t *block;
+  int32_t mult = multiplier;
+
+  if (mult == 0) {
+    // zero gain, discard any input and transmit nothing
+    block = receiveReadOnly(0);
+    if (block) {
+      release(block);
+    }
+  } else if (mult == MULTI_UNITYGAIN) {
+    // unity gain, pass input to output without any change
+    block = receiveReadOnly(0);
+    if (block) {
+      transmit(block);
+      release(block);
+    }
+  } else {
+    // apply gain to signal
+    block = receiveWritable(0);
+    if (block) {
+      applyGain(block->data, mult);
+      transmit(block);
+      release(block);
+    }
+  }
+}
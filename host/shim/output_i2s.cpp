@@ -0,0 +1,25 @@
+#include "output_i2s.h"
+
+namespace {
+int16_t last_block[2][AUDIO_BLOCK_SAMPLES];
+} // namespace
+
+void AudioOutputI2S::begin(void) {
+  memset(last_block, 0, sizeof(last_block));
+}
+
+void AudioOutputI2S::update(void) {
+  for (unsigned int channel = 0; channel < 2; channel++) {
+    audio_block_t *block = receiveReadOnly(channel);
+    if (block) {
+      memcpy(last_block[channel], block->data, sizeof(block->data));
+      release(block);
+    } else {
+      memset(last_block[channel], 0, sizeof(last_block[channel]));
+    }
+  }
+}
+
+const int16_t *AudioOutputI2S::lastBlock(unsigned int channel) {
+  return last_block[channel < 2 ? channel : 1];
+}
@@ -0,0 +1,23 @@
+#ifndef TEENSY_HOST_OUTPUT_I2S_H
+#define TEENSY_HOST_OUTPUT_I2S_H
+
+#include "AudioStream.h"
+
+/**
+ * Stand-in for AudioOutputI2S: keeps the last left/right blocks it received so
+ * TeensyHost can hand them to the host audio sink.
+ */
+class AudioOutputI2S : public AudioStream {
+public:
+  AudioOutputI2S(void) : AudioStream(2, inputQueueArray) { begin(); }
+  virtual void update(void);
+  void begin(void);
+
+  /** Host only: samples received by the most recent update (zeros if none). */
+  static const int16_t *lastBlock(unsigned int channel);
+
+private:
+  audio_block_t *inputQueueArray[2];
+};
+
+#endif
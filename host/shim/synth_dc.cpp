@@ -0,0 +1,49 @@
+#include "synth_dc.h"
+
+void AudioSynthWaveformDc::amplitude(float n, float milliseconds) {
+  if (milliseconds <= 0.0f) {
+    amplitude(n);
+    return;
+  }
+  if (n > 1.0f) {
+    n = 1.0f;
+  } else if (n < -1.0f) {
+    n = -1.0f;
+  }
+  int32_t t = (int32_t)(n * 2147418112.0f);
+  float samples = milliseconds * (AUDIO_SAMPLE_RATE_EXACT / 1000.0f);
+  int32_t inc = (int32_t)(((float)t - (float)magnitude) / samples);
+  __disable_irq();
+  target = t;
+  increment = inc != 0 ? inc : (t > magnitude ? 1 : -1);
+  state = 1;
+  __enable_irq();
+}
+
+void AudioSynthWaveformDc::update(void) {
+  audio_block_t *block = allocate();
+  if (!block) {
+    return;
+  }
+  if (state == 0) {
+    // steady DC output, simply fill the buffer with fixed value
+    int16_t val = magnitude >> 16;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      block->data[i] = val;
+    }
+  } else {
+    // transitioning to a new DC level
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      int64_t next = (int64_t)magnitude + increment;
+      if ((increment > 0 && next >= target) ||
+          (increment < 0 && next <= target)) {
+        next = target;
+        state = 0;
+      }
+      magnitude = (int32_t)next;
+      block->data[i] = magnitude >> 16;
+    }
+  }
+  transmit(block);
+  release(block);
+}
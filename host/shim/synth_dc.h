@@ -0,0 +1,36 @@
+#ifndef TEENSY_HOST_SYNTH_DC_H
+#define TEENSY_HOST_SYNTH_DC_H
+
+#include "AudioStream.h"
+
+class AudioSynthWaveformDc : public AudioStream {
+public:
+  AudioSynthWaveformDc() : AudioStream(0, nullptr), state(0), magnitude(0) {}
+
+  void amplitude(float n) {
+    if (n > 1.0f) {
+      n = 1.0f;
+    } else if (n < -1.0f) {
+      n = -1.0f;
+    }
+    int32_t m = (int32_t)(n * 2147418112.0f);
+    __disable_irq();
+    magnitude = m;
+    state = 0;
+    __enable_irq();
+  }
+  void amplitude(float n, float milliseconds);
+  float read(void) {
+    int32_t m = magnitude;
+    return (float)m * (float)(1.0 / 2147418112.0);
+  }
+  virtual void update(void);
+
+private:
+  uint8_t state; // 0=steady output, 1=transitioning
+  int32_t magnitude;
+  int32_t target;
+  int32_t increment;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include "synth_sine.h"
+
+#include "dspinst.h"
+
+namespace {
+struct SineTable {
+  int16_t data[257];
+  SineTable() {
+    for (int i = 0; i < 257; i++) {
+      data[i] = (int16_t)lrint(32767.0 * sin(2.0 * M_PI * i / 256.0));
+    }
+  }
+};
+const SineTable kSineTable;
+} // namespace
+
+void AudioSynthWaveformSine::update(void) {
+  if (magnitude) {
+    audio_block_t *block = allocate();
+    if (block) {
+      uint32_t ph = phase_accumulator;
+      uint32_t inc = phase_increment;
+      for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+        uint32_t index = ph >> 24;
+        int32_t val1 = kSineTable.data[index];
+        int32_t val2 = kSineTable.data[index + 1];
+        uint32_t scale = (ph >> 8) & 0xFFFF;
+        val2 *= scale;
+        val1 *= 0x10000 - scale;
+        block->data[i] = multiply_32x32_rshift32(val1 + val2, magnitude);
+        ph += inc;
+      }
+      phase_accumulator = ph;
+      transmit(block);
+      release(block);
+      return;
+    }
+  }
+  phase_accumulator += phase_increment * AUDIO_BLOCK_SAMPLES;
+}
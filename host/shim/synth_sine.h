@@ -0,0 +1,48 @@
+#ifndef TEENSY_HOST_SYNTH_SINE_H
+#define TEENSY_HOST_SYNTH_SINE_H
+
+#include "AudioStream.h"
+
+class AudioSynthWaveformSine : public AudioStream {
+public:
+  AudioSynthWaveformSine()
+      : AudioStream(0, nullptr), phase_accumulator(0), phase_increment(0),
+        magnitude(16384) {}
+
+  void frequency(float freq) {
+    if (freq < 0.0f) {
+      freq = 0.0f;
+    } else if (freq > AUDIO_SAMPLE_RATE_EXACT / 2.0f) {
+      freq = AUDIO_SAMPLE_RATE_EXACT / 2.0f;
+    }
+    phase_increment = freq * (4294967296.0f / AUDIO_SAMPLE_RATE_EXACT);
+  }
+  void phase(float angle) {
+    if (angle < 0.0f) {
+      return;
+    } else if (angle > 360.0f) {
+      angle = angle - 360.0f;
+      if (angle >= 360.0f) {
+        return;
+      }
+    }
+    phase_accumulator = angle * (float)(4294967296.0 / 360.0);
+  }
+  void amplitude(float n) {
+    if (n < 0.0f) {
+      n = 0.0f;
+    } else if (n > 1.0f) {
+      n = 1.0f;
+    }
+    magnitude = n * 65536.0f;
+  }
+
+  virtual void update(void);
+
+private:
+  uint32_t phase_accumulator;
+  uint32_t phase_increment;
+  int32_t magnitude;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#include "synth_waveform.h"
+
+#include "dspinst.h"
+
+namespace {
+
+// PolyBLEP residual for a unit step at phase 0, t and dt in cycles.
+inline float polyBlep(float t, float dt) {
+  if (t < dt) {
+    float x = t / dt;
+    return x + x - x * x - 1.0f;
+  }
+  if (t > 1.0f - dt) {
+    float x = (t - 1.0f) / dt;
+    return x * x + x + x + 1.0f;
+  }
+  return 0.0f;
+}
+
+constexpr float kPhaseToCycles = 1.0f / 4294967296.0f;
+
+inline float sineAt(uint32_t ph) {
+  return sinf((float)ph * kPhaseToCycles * 6.28318530718f);
+}
+
+} // namespace
+
+void AudioSynthWaveformModulated::update(void) {
+  audio_block_t *moddata = receiveReadOnly(0);
+  audio_block_t *shapedata = receiveReadOnly(1);
+
+  // Pre-compute the phase angle for every output sample of this update
+  uint32_t ph = phase_accumulator;
+  uint32_t priorphase = phasedata[AUDIO_BLOCK_SAMPLES - 1];
+  const uint32_t inc = phase_increment;
+  if (moddata && modulation_type == 0) {
+    // Frequency Modulation
+    const int16_t *bp = moddata->data;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      int32_t n = (*bp++) * (int32_t)modulation_factor; // octaves to mod
+      int32_t ipart = n >> 27;                            // 4 integer bits
+      n &= 0x7FFFFFF;                                     // 27 fraction bits
+      // exp2 algorithm by Laurent de Soras
+      n = (n + 134217728) << 3;
+      n = multiply_32x32_rshift32_rounded(n, n);
+      n = multiply_32x32_rshift32_rounded(n, 715827883) << 3;
+      n = n + 715827882;
+      uint32_t scale = (uint32_t)n >> (14 - ipart);
+      uint64_t phstep = (uint64_t)inc * scale;
+      uint32_t phstep_msw = phstep >> 32;
+      if (phstep_msw < 0x7FFE) {
+        ph += phstep >> 16;
+      } else {
+        ph += 0x7FFE0000;
+      }
+      phasedata[i] = ph;
+    }
+    release(moddata);
+  } else if (moddata) {
+    // Phase Modulation
+    const int16_t *bp = moddata->data;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      uint32_t n = (uint16_t)(*bp++) * modulation_factor;
+      phasedata[i] = ph + n;
+      ph += inc;
+    }
+    release(moddata);
+  } else {
+    // No Modulation Input
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      phasedata[i] = ph;
+      ph += inc;
+    }
+  }
+  phase_accumulator = ph;
+
+  // If the amplitude is zero, no output, but phase still increments properly
+  if (magnitude == 0) {
+    if (shapedata) {
+      release(shapedata);
+    }
+    return;
+  }
+  audio_block_t *block = allocate();
+  if (!block) {
+    if (shapedata) {
+      release(shapedata);
+    }
+    return;
+  }
+  int16_t *bp = block->data;
+  int16_t magnitude15 = signed_saturate_rshift(magnitude, 16, 1);
+
+  switch (tone_type) {
+  case WAVEFORM_SINE:
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      *bp++ = (int16_t)(sineAt(phasedata[i]) * magnitude15);
+    }
+    break;
+
+  case WAVEFORM_ARBITRARY:
+    if (!arbdata) {
+      release(block);
+      if (shapedata) {
+        release(shapedata);
+      }
+      return;
+    }
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      uint32_t p = phasedata[i];
+      uint32_t index = p >> 24;
+      uint32_t index2 = index + 1;
+      if (index2 >= 256) {
+        index2 = 0;
+      }
+      int32_t val1 = arbdata[index];
+      int32_t val2 = arbdata[index2];
+      uint32_t scale = (p >> 8) & 0xFFFF;
+      val2 *= scale;
+      val1 *= 0x10000 - scale;
+      *bp++ = multiply_32x32_rshift32(val1 + val2, magnitude);
+    }
+    break;
+
+  case WAVEFORM_SQUARE:
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      *bp++ = (phasedata[i] & 0x80000000) ? -magnitude15 : magnitude15;
+    }
+    break;
+
+  case WAVEFORM_SAWTOOTH:
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      *bp++ = signed_multiply_32x16t(magnitude, phasedata[i]);
+    }
+    break;
+
+  case WAVEFORM_SAWTOOTH_REVERSE:
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      *bp++ = signed_multiply_32x16t(0xFFFFFFFFu - magnitude, phasedata[i]);
+    }
+    break;
+
+  case WAVEFORM_TRIANGLE:
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      uint32_t p = phasedata[i];
+      uint32_t phtop = p >> 30;
+      if (phtop == 1 || phtop == 2) {
+        *bp++ = ((0xFFFF - (p >> 15)) * magnitude) >> 16;
+      } else {
+        *bp++ = (((int32_t)p >> 15) * magnitude) >> 16;
+      }
+    }
+    break;
+
+  case WAVEFORM_BANDLIMIT_SAWTOOTH:
+  case WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE: {
+    const float sign =
+        tone_type == WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE ? -1.0f : 1.0f;
+    uint32_t prev = priorphase;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      uint32_t p = phasedata[i];
+      float dt = (float)(p - prev) * kPhaseToCycles;
+      prev = p;
+      // Rising ramp that wraps at half phase, like the naive Teensy saw.
+      float t = (float)(p + 0x80000000u) * kPhaseToCycles;
+      float v = 2.0f * t - 1.0f;
+      if (dt > 0.0f) {
+        v -= polyBlep(t, dt);
+      }
+      *bp++ = saturate16(
+          (int32_t)(sign * v * 32767.0f * (float)magnitude / 65536.0f));
+    }
+  } break;
+
+  case WAVEFORM_BANDLIMIT_SQUARE: {
+    uint32_t prev = priorphase;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      uint32_t p = phasedata[i];
+      float dt = (float)(p - prev) * kPhaseToCycles;
+      prev = p;
+      float t = (float)p * kPhaseToCycles;
+      float v = (p & 0x80000000) ? -1.0f : 1.0f;
+      if (dt > 0.0f) {
+        v += polyBlep(t, dt);
+        v -= polyBlep((float)(p + 0x80000000u) * kPhaseToCycles, dt);
+      }
+      *bp++ = saturate16((int32_t)(v * (float)magnitude15));
+    }
+  } break;
+
+  default:
+    // Shapes le-synth does not use are rendered as silence.
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      *bp++ = 0;
+    }
+    break;
+  }
+
+  if (tone_offset) {
+    bp = block->data;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      bp[i] = saturate16(bp[i] + tone_offset);
+    }
+  }
+  if (shapedata) {
+    release(shapedata);
+  }
+  transmit(block, 0);
+  release(block);
+}
@@ -0,0 +1,112 @@
+#ifndef TEENSY_HOST_SYNTH_WAVEFORM_H
+#define TEENSY_HOST_SYNTH_WAVEFORM_H
+
+#include "AudioStream.h"
+
+#define WAVEFORM_SINE 0
+#define WAVEFORM_SAWTOOTH 1
+#define WAVEFORM_SQUARE 2
+#define WAVEFORM_TRIANGLE 3
+#define WAVEFORM_ARBITRARY 4
+#define WAVEFORM_PULSE 5
+#define WAVEFORM_SAWTOOTH_REVERSE 6
+#define WAVEFORM_SAMPLE_HOLD 7
+#define WAVEFORM_TRIANGLE_VARIABLE 8
+#define WAVEFORM_BANDLIMIT_SAWTOOTH 9
+#define WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE 10
+#define WAVEFORM_BANDLIMIT_SQUARE 11
+#define WAVEFORM_BANDLIMIT_PULSE 12
+
+/**
+ * Stand-in for the Teensy AudioSynthWaveformModulated.
+ *
+ * Phase accumulation, frequency modulation (exp2 by Laurent de Soras) and the
+ * arbitrary/naive waveforms follow the Teensy code. The band-limited shapes
+ * use PolyBLEP instead of the library's minBLEP tables, so they are close but
+ * not bit-identical to the hardware.
+ */
+class AudioSynthWaveformModulated : public AudioStream {
+public:
+  AudioSynthWaveformModulated(void)
+      : AudioStream(2, inputQueueArray), phase_accumulator(0),
+        phase_increment(0), modulation_factor(32768), magnitude(0),
+        arbdata(nullptr), sample(0), tone_offset(0),
+        tone_type(WAVEFORM_SINE), modulation_type(0) {
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+      phasedata[i] = 0;
+    }
+  }
+
+  void frequency(float freq) {
+    if (freq < 0.0f) {
+      freq = 0.0f;
+    } else if (freq > AUDIO_SAMPLE_RATE_EXACT / 2.0f) {
+      freq = AUDIO_SAMPLE_RATE_EXACT / 2.0f;
+    }
+    phase_increment = freq * (4294967296.0f / AUDIO_SAMPLE_RATE_EXACT);
+    if (phase_increment > 0x7FFE0000u) {
+      phase_increment = 0x7FFE0000;
+    }
+  }
+  void amplitude(float n) {
+    if (n < 0.0f) {
+      n = 0.0f;
+    } else if (n > 1.0f) {
+      n = 1.0f;
+    }
+    magnitude = n * 65536.0f;
+  }
+  void offset(float n) {
+    if (n < -1.0f) {
+      n = -1.0f;
+    } else if (n > 1.0f) {
+      n = 1.0f;
+    }
+    tone_offset = n * 32767.0f;
+  }
+  void begin(short t_type) { tone_type = t_type; }
+  void begin(float t_amp, float t_freq, short t_type) {
+    amplitude(t_amp);
+    frequency(t_freq);
+    tone_type = t_type;
+  }
+  void arbitraryWaveform(const int16_t *data, float maxFreq) {
+    (void)maxFreq;
+    arbdata = data;
+  }
+  void frequencyModulation(float octaves) {
+    if (octaves > 12.0f) {
+      octaves = 12.0f;
+    } else if (octaves < 0.1f) {
+      octaves = 0.1f;
+    }
+    modulation_factor = octaves * 4096.0f;
+    modulation_type = 0;
+  }
+  void phaseModulation(float degrees) {
+    if (degrees > 9000.0f) {
+      degrees = 9000.0f;
+    } else if (degrees < 30.0f) {
+      degrees = 30.0f;
+    }
+    modulation_factor = degrees * (float)(65536.0 / 180.0);
+    modulation_type = 1;
+  }
+
+  virtual void update(void);
+
+private:
+  audio_block_t *inputQueueArray[2];
+  uint32_t phase_accumulator;
+  uint32_t phase_increment;
+  uint32_t modulation_factor;
+  int32_t magnitude;
+  const int16_t *arbdata;
+  uint32_t phasedata[AUDIO_BLOCK_SAMPLES];
+  int16_t sample;
+  int16_t tone_offset;
+  uint8_t tone_type;
+  uint8_t modulation_type;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef TEENSY_HOST_USB_MIDI_H
+#define TEENSY_HOST_USB_MIDI_H
+
+#include "Arduino.h"
+
+/**
+ * Stand-in for the Teensy usbMIDI object. Messages are queued from the host
+ * with TeensyHost::injectUsbMidi()/injectUsbSysEx() and dispatched one per
+ * read() call, like the real USB endpoint.
+ */
+class usb_midi_class {
+public:
+  enum MidiType {
+    InvalidType = 0x00,
+    NoteOff = 0x80,
+    NoteOn = 0x90,
+    AfterTouchPoly = 0xA0,
+    ControlChange = 0xB0,
+    ProgramChange = 0xC0,
+    AfterTouchChannel = 0xD0,
+    PitchBend = 0xE0,
+    SystemExclusive = 0xF0,
+    TimeCodeQuarterFrame = 0xF1,
+    SongPosition = 0xF2,
+    SongSelect = 0xF3,
+    TuneRequest = 0xF6,
+    Clock = 0xF8,
+    Start = 0xFA,
+    Continue = 0xFB,
+    Stop = 0xFC,
+    ActiveSensing = 0xFE,
+    SystemReset = 0xFF
+  };
+
+  void sendNoteOn(uint8_t note, uint8_t velocity, uint8_t channel,
+                  uint8_t cable = 0) {
+    (void)note, (void)velocity, (void)channel, (void)cable;
+  }
+  void sendNoteOff(uint8_t note, uint8_t velocity, uint8_t channel,
+                   uint8_t cable = 0) {
+    (void)note, (void)velocity, (void)channel, (void)cable;
+  }
+  void sendControlChange(uint8_t control, uint8_t value, uint8_t channel,
+                         uint8_t cable = 0) {
+    (void)control, (void)value, (void)channel, (void)cable;
+  }
+  void sendSysEx(uint32_t length, const uint8_t *data, bool hasTerm = false,
+                 uint8_t cable = 0);
+  void send_now(void) {}
+
+  bool read(uint8_t channel = 0);
+  uint8_t getType(void) { return msg_type; }
+  uint8_t getChannel(void) { return msg_channel; }
+  uint8_t getData1(void) { return msg_data1; }
+  uint8_t getData2(void) { return msg_data2; }
+
+  void setHandleNoteOff(void (*fptr)(uint8_t channel, uint8_t note,
+                                     uint8_t velocity)) {
+    handleNoteOff = fptr;
+  }
+  void setHandleNoteOn(void (*fptr)(uint8_t channel, uint8_t note,
+                                    uint8_t velocity)) {
+    handleNoteOn = fptr;
+  }
+  void setHandleControlChange(void (*fptr)(uint8_t channel, uint8_t control,
+                                           uint8_t value)) {
+    handleControlChange = fptr;
+  }
+  void setHandleSystemExclusive(void (*fptr)(uint8_t *data,
+                                             unsigned int size)) {
+    handleSysExSimple = fptr;
+  }
+  void setHandleClock(void (*fptr)(void)) { handleClock = fptr; }
+  void setHandleStart(void (*fptr)(void)) { handleStart = fptr; }
+  void setHandleContinue(void (*fptr)(void)) { handleContinue = fptr; }
+  void setHandleStop(void (*fptr)(void)) { handleStop = fptr; }
+
+private:
+  uint8_t msg_type = 0;
+  uint8_t msg_channel = 0;
+  uint8_t msg_data1 = 0;
+  uint8_t msg_data2 = 0;
+
+  void (*handleNoteOff)(uint8_t, uint8_t, uint8_t) = nullptr;
+  void (*handleNoteOn)(uint8_t, uint8_t, uint8_t) = nullptr;
+  void (*handleControlChange)(uint8_t, uint8_t, uint8_t) = nullptr;
+  void (*handleSysExSimple)(uint8_t *, unsigned int) = nullptr;
+  void (*handleClock)(void) = nullptr;
+  void (*handleStart)(void) = nullptr;
+  void (*handleContinue)(void) = nullptr;
+  void (*handleStop)(void) = nullptr;
+};
+
+extern usb_midi_class usbMIDI;
+
+#endif
@@ -0,0 +1,110 @@
+#include "AnalogScanner.h"
+
+#include <AudioStream.h>
+#include <atomic>
+
+#include "core/Hardware.h"
+
+namespace {
+constexpr float kTickMicros = AUDIO_BLOCK_SAMPLES * 1000000.0f /
+                              AUDIO_SAMPLE_RATE_EXACT /
+                              Autosave::AnalogScanner::kTicksPerFrame;
+
+constexpr uint8_t kPots = Autosave::AnalogScanner::CH_CV;
+
+constexpr uint8_t kPins[Autosave::AnalogScanner::CH_COUNT] = {
+    Autosave::hardware::PIN_POT_1,      Autosave::hardware::PIN_POT_2,
+    Autosave::hardware::PIN_POT_3,      Autosave::hardware::PIN_POT_ATTACK,
+    Autosave::hardware::PIN_POT_RELEASE, Autosave::hardware::PIN_CV,
+};
+
+// ADC input channel of A0 to A5 (pin_to_channel in the Teensy 4 core's
+// analog.c). These pins are on GPIO_AD_B1, wired to the same channel of both
+// ADC1 and ADC2.
+constexpr uint8_t kPinChannels[] = {7, 8, 12, 11, 6, 5};
+
+constexpr uint8_t adcChannel(uint8_t pin) { return kPinChannels[pin - A0]; }
+
+constexpr bool pinsHaveChannels() {
+  for (uint8_t pin : kPins) {
+    if (pin < A0 || pin > A5) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(pinsHaveChannels(), "analog inputs must be on A0 to A5");
+} // namespace
+
+namespace Autosave {
+
+void AnalogScanner::begin() {
+  instance_ = this;
+  analogReadResolution(kResolutionBits); // ADC1 and ADC2
+  timer_.begin(&AnalogScanner::tick, kTickMicros);
+}
+
+uint8_t AnalogScanner::pin(Channel channel) {
+  return kPins[channel < CH_COUNT ? channel : CH_CV];
+}
+
+float AnalogScanner::mean(Channel channel) const {
+  // The timer interrupt may swap and clear the frames while this reads:
+  // read again until no frame completed meanwhile.
+  uint32_t frame_count;
+  uint32_t sum;
+  uint8_t count;
+  do {
+    frame_count = frame_count_;
+    std::atomic_signal_fence(std::memory_order_acquire);
+    const Frame &frame = frames_[front_];
+    sum = frame.sum[channel];
+    count = frame.count[channel];
+    std::atomic_signal_fence(std::memory_order_acquire);
+  } while (frame_count != frame_count_);
+
+  return count > 0 ? (float)sum / count : 0.0f;
+}
+
+/** Add the conversions the previous tick started, if they are done. */
+void AnalogScanner::collect(Frame &frame) {
+  if (pending_pot_ == CH_COUNT) {
+    return;
+  }
+  if (ADC1_HS & ADC_HS_COCO0) {
+    frame.sum[CH_CV] += ADC1_R0;
+    frame.count[CH_CV]++;
+  }
+  if (ADC2_HS & ADC_HS_COCO0) {
+    frame.sum[pending_pot_] += ADC2_R0;
+    frame.count[pending_pot_]++;
+  }
+}
+
+void AnalogScanner::start() {
+  ADC1_HC0 = ADC_HC_ADCH(adcChannel(kPins[CH_CV]));
+  ADC2_HC0 = ADC_HC_ADCH(adcChannel(kPins[next_pot_]));
+  pending_pot_ = next_pot_;
+  if (++next_pot_ == kPots) {
+    next_pot_ = 0;
+  }
+}
+
+void AnalogScanner::tick() {
+  AnalogScanner &scanner = *instance_;
+  Frame &back = scanner.frames_[scanner.front_ ^ 1];
+
+  scanner.collect(back);
+  scanner.start();
+
+  if (++scanner.tick_ < kTicksPerFrame) {
+    return;
+  }
+  scanner.tick_ = 0;
+  scanner.front_ ^= 1;
+  scanner.frames_[scanner.front_ ^ 1] = {};
+  std::atomic_signal_fence(std::memory_order_release);
+  scanner.frame_count_ = scanner.frame_count_ + 1;
+}
+
+} // namespace Autosave
@@ -0,0 +1,78 @@
+#ifndef AUTOSAVE_ANALOG_SCANNER_H
+#define AUTOSAVE_ANALOG_SCANNER_H
+
+#include <Arduino.h>
+#include <AudioStream.h>
+#include <cstdint>
+
+namespace Autosave {
+
+/**
+ * Samples every analog input from a timer, so the main loop never waits on
+ * an ADC conversion and controls are read at a fixed, known rate.
+ *
+ * Each tick converts the CV input on ADC1 and the next pot in turn on ADC2;
+ * kTicksPerFrame ticks make a frame of one audio block period (the CV is
+ * read 16 times, each pot 3 or 4 times). Conversions are split-phase: a
+ * tick starts them and the next one collects the results, finished long
+ * before, so the timer interrupt never waits on the ADC.
+ *
+ * Results are summed into the back frame of a double buffer, which becomes
+ * the front frame when it is complete. Readers always see a complete frame,
+ * without masking interrupts: they retry when the frame number changed
+ * while they read. They get the mean of each channel and the frame number,
+ * to tell new frames apart.
+ *
+ * Reads are 12-bit (0 to kFullScale): the pitch CV needs the resolution.
+ */
+class AnalogScanner {
+public:
+  enum Channel : uint8_t {
+    CH_POT_1,
+    CH_POT_2,
+    CH_POT_3,
+    CH_POT_ATTACK,
+    CH_POT_RELEASE,
+    CH_CV,
+    CH_COUNT,
+  };
+
+  static constexpr uint8_t kResolutionBits = 12;
+  static constexpr uint16_t kFullScale = (1u << kResolutionBits) - 1;
+  static constexpr uint8_t kTicksPerFrame = 16;
+  static constexpr float kFrameRateHz =
+      AUDIO_SAMPLE_RATE_EXACT / AUDIO_BLOCK_SAMPLES;
+
+  void begin();
+
+  static uint8_t pin(Channel channel);
+
+  /** Number of complete frames so far; changes when a new one is ready. */
+  uint32_t frame() const { return frame_count_; }
+  /** Mean reading of the channel over the last complete frame. */
+  float mean(Channel channel) const;
+
+private:
+  struct Frame {
+    uint32_t sum[CH_COUNT];
+    uint8_t count[CH_COUNT];
+  };
+
+  inline static AnalogScanner *instance_ = nullptr;
+
+  IntervalTimer timer_;
+  Frame frames_[2] = {};
+  volatile uint8_t front_ = 0;
+  volatile uint32_t frame_count_ = 0;
+  uint8_t tick_ = 0;     // ticks into the back frame
+  uint8_t next_pot_ = 0; // pot converted by the next tick
+  uint8_t pending_pot_ = CH_COUNT; // pot being converted, CH_COUNT: none
+
+  void collect(Frame &frame);
+  void start();
+  static void tick();
+};
+
+} // namespace Autosave
+
+#endif
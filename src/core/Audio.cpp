@@ -1,7 +1,10 @@
+#include <array>
 #include <synth_waveform.h>
 
 #include "Audio.h"
 #include "core/EepromStorage.h"
+#include "core/NoteLatency.h"
+#include "lib/FastMath.h"
 #include "lib/Logger.h"
 #include "waveforms/Waveforms.h"
 
@@ -10,18 +13,52 @@ constexpr float kInitLfoFmFrequency = 20.0f;
 constexpr float kInitLfoFmAmplitude = 0.0f;
 
 constexpr float kOscMixGain = 0.25f;
+// Gain of each voice mixer into the master mixer, now folded into the voices.
+constexpr float kMixerMasterGain = 0.5f;
 
-constexpr float kFilterEnvGain = 0.5f;
+// Per-voice detune (oscillator slop): small fixed cents offset per voice.
+constexpr float kVoiceDetuneCentsPattern[8] = {-1.5f, -0.8f, -0.4f, 0.1f,
+                                               0.5f,  0.9f,  1.4f,  -1.2f};
+
+// Detune table for N voices: voices past the first eight repeat the pattern
+// mirrored, so any voice count stays spread around the nominal pitch.
+template <uint8_t N> constexpr std::array<float, N> voiceDetuneCents() {
+  std::array<float, N> cents{};
+  for (uint8_t i = 0; i < N; i++) {
+    float pattern = kVoiceDetuneCentsPattern[i % 8];
+    cents[i] = (i / 8) % 2 == 0 ? pattern : -pattern;
+  }
+  return cents;
+}
 
-// Random-walk drift: max offset ±this many cents; small steps make it wander.
-constexpr float kDriftCentsAmplitude = 0.2f;
-// Step size per update (cents); smaller = smoother, larger = more unstable.
-constexpr float kDriftStepCents = 0.08f;
-constexpr uint8_t kDriftUpdateIntervalMs = 30;
+// log2(x) for x >= 1 at compile time: x = m * 2^e with m in [1, 2), then
+// log(m) = 2 atanh(s) with s = (m - 1) / (m + 1) <= 1/3.
+constexpr double constexprLog2(double x) {
+  double exponent = 0.0;
+  while (x >= 2.0) {
+    x /= 2.0;
+    exponent += 1.0;
+  }
+  const double s = (x - 1.0) / (x + 1.0);
+  double term = s;
+  double sum = 0.0;
+  for (int k = 1; k < 40; k += 2) {
+    sum += term / k;
+    term *= s * s;
+  }
+  return exponent + 2.0 * sum / 0.69314718055994531;
+}
 
-// Per-voice detune (oscillator slop): small fixed cents offset per voice.
-constexpr float kVoiceDetuneCents[Autosave::audio_config::voices_number] = {
-    -1.5f, -0.8f, -0.4f, 0.1f, 0.5f, 0.9f, 1.4f, -1.2f};
+// Master gain for each count of sounding oscillators (0..N): the more voices,
+// the lower the gain, so dense chords stay clear of clipping.
+template <uint8_t N> constexpr std::array<float, N + 1> masterGainTable() {
+  std::array<float, N + 1> gains{};
+  for (uint8_t count = 0; count <= N; count++) {
+    gains[count] = (float)(Autosave::audio_config::master_gain * 3.0 /
+                           constexprLog2(count + 10.0));
+  }
+  return gains;
+}
 
 // Initial oscillator state (implementation detail; only used in Audio::begin).
 constexpr float kInitFrequency = 440.0f; // A4
@@ -68,44 +105,187 @@ enum CustomWaveformBank {
   CUSTOM_WAVEFORM_BANK_OVERTONE = 2,
 };
 
-Audio::Audio()
-    : patchCords{{lfo_fm, 0, oscillators[0], 0},
-                 {lfo_fm, 0, oscillators[1], 0},
-                 {lfo_fm, 0, oscillators[2], 0},
-                 {lfo_fm, 0, oscillators[3], 0},
-                 {lfo_fm, 0, oscillators[4], 0},
-                 {lfo_fm, 0, oscillators[5], 0},
-                 {lfo_fm, 0, oscillators[6], 0},
-                 {lfo_fm, 0, oscillators[7], 0},
-                 {oscillators[0], 0, envelopes[0], 0},
-                 {oscillators[1], 0, envelopes[1], 0},
-                 {oscillators[2], 0, envelopes[2], 0},
-                 {oscillators[3], 0, envelopes[3], 0},
-                 {oscillators[4], 0, envelopes[4], 0},
-                 {oscillators[5], 0, envelopes[5], 0},
-                 {oscillators[6], 0, envelopes[6], 0},
-                 {oscillators[7], 0, envelopes[7], 0},
-                 {envelopes[0], 0, mixers[0], 0},
-                 {envelopes[1], 0, mixers[0], 1},
-                 {envelopes[2], 0, mixers[0], 2},
-                 {envelopes[3], 0, mixers[0], 3},
-                 {envelopes[4], 0, mixers[1], 0},
-                 {envelopes[5], 0, mixers[1], 1},
-                 {envelopes[6], 0, mixers[1], 2},
-                 {envelopes[7], 0, mixers[1], 3},
-                 {mixers[0], 0, mixer_master, 0},
-                 {mixers[1], 0, mixer_master, 1},
-                 {mixer_master, 0, amplifier_master, 0},
-                 {amplifier_master, 0, i2s1, 1},
-                 {dc_signal, 0, filter_envelope, 0},
+template <uint8_t N>
+AudioEngine<N>::AudioEngine()
+    : patchCords{{lfo_fm, 0, voice_bank, 0},
+                 {voice_bank, 0, i2s1, 1},
                  {filter_envelope, 0, i2s1, 0}} {}
 
-void Audio::begin() {
+template <uint8_t N>
+void AudioEngine<N>::push(CommandType type, uint8_t voice, float value,
+                          uint8_t count) {
+  Command command;
+  command.timestamp =
+      command_batch_stamped_ ? command_batch_cycles_ : ARM_DWT_CYCCNT;
+  command.type = type;
+  command.voice = voice;
+  command.count = count;
+  command.value = value;
+
+  // No logging here: a full queue means the audio update is stalled.
+  if (!commands_.stage(command)) {
+    dropped_commands_++;
+  }
+  if (command_batch_depth_ == 0) {
+    commands_.commit();
+  }
+}
+
+template <uint8_t N>
+void AudioEngine<N>::push(CommandType type, const int16_t *data) {
+  Command command;
+  command.timestamp =
+      command_batch_stamped_ ? command_batch_cycles_ : ARM_DWT_CYCCNT;
+  command.type = type;
+  command.voice = 0;
+  command.count = 1;
+  command.data = data;
+
+  if (!commands_.stage(command)) {
+    dropped_commands_++;
+  }
+  if (command_batch_depth_ == 0) {
+    commands_.commit();
+  }
+}
+
+/**
+ * Apply every queued command. Runs in the audio update, before any node of
+ * the graph renders the block.
+ *
+ * A command queued a fraction x into the previous block period is applied x
+ * into this block, so every command waits exactly one block.
+ */
+template <uint8_t N>
+void AudioEngine<N>::drainCommands() {
+  const uint32_t now = ARM_DWT_CYCCNT;
+  const uint32_t period = now - block_start_cycles_;
+
+  // Pitch CV: a new transposition every block, once the input is enabled.
+  voice_bank.transpose(pitch_cv.enabled()
+                           ? PitchCvInput::voltsToRatio(pitch_cv.volts())
+                           : 1.0f);
+
+  Command command;
+  uint8_t offset = 0;
+  while (commands_.pop(&command)) {
+    uint32_t latency = now - command.timestamp;
+    if (latency > command_latency_max_) {
+      command_latency_max_ = latency;
+    }
+
+    // Queued before the previous block started (late drain or long batch):
+    // offset 0. Offsets never go back, commands keep their queue order.
+    int32_t elapsed = (int32_t)(command.timestamp - block_start_cycles_);
+    if (sample_accurate_commands_ && elapsed > 0 && period > 0) {
+      uint32_t position =
+          (uint64_t)(uint32_t)elapsed * AUDIO_BLOCK_SAMPLES / period;
+      if (position >= AUDIO_BLOCK_SAMPLES) {
+        position = AUDIO_BLOCK_SAMPLES - 1;
+      }
+      if (position > offset) {
+        offset = position;
+      }
+    }
+
+    applyCommand(command, offset, now, period);
+  }
+
+  block_start_cycles_ = now;
+}
+
+template <uint8_t N>
+void AudioEngine<N>::applyCommand(const Command &command, uint8_t offset,
+                                  uint32_t now, uint32_t period) {
+  using Event = typename VoiceBank<N>::EventType;
+
+  switch (command.type) {
+  case CMD_NOTE_ON:
+    offset = voice_bank.schedule(offset, Event::EVENT_NOTE_ON, command.voice,
+                                 command.value, command.count);
+
+    // Once per MIDI event: chords and mono voices share one timestamp.
+    if (command.timestamp != latency_timestamp_) {
+      latency_timestamp_ = command.timestamp;
+      // The attack starts from zero: its first non-zero sample is the next.
+      NoteLatency::record(NoteLatency::STAGE_ENVELOPE,
+                          now - command.timestamp +
+                              (uint64_t)(offset + 1) * period /
+                                  AUDIO_BLOCK_SAMPLES);
+    }
+    break;
+  case CMD_NOTE_OFF:
+    voice_bank.schedule(offset, Event::EVENT_NOTE_OFF, command.voice, 0.0f,
+                        command.count);
+    break;
+  case CMD_FILTER_NOTE_ON:
+    filter_envelope.noteOn(command.value);
+    break;
+  case CMD_FILTER_NOTE_OFF:
+    filter_envelope.noteOff();
+    break;
+  case CMD_FREQUENCY:
+    voice_bank.schedule(offset, Event::EVENT_FREQUENCY, command.voice,
+                        command.value, command.count);
+    break;
+  case CMD_AMPLITUDE:
+    voice_bank.schedule(offset, Event::EVENT_AMPLITUDE, command.voice,
+                        command.value, command.count);
+    break;
+  case CMD_GAIN:
+    voice_bank.gain(command.voice, command.value);
+    break;
+  case CMD_WAVEFORM:
+    voice_bank.waveform(static_cast<uint8_t>(command.value));
+    break;
+  case CMD_ARBITRARY_WAVEFORM:
+    voice_bank.arbitraryWaveform(command.data);
+    break;
+  case CMD_LFO_FREQUENCY:
+    lfo_fm.frequency(command.value);
+    break;
+  case CMD_LFO_AMPLITUDE:
+    lfo_fm.amplitude(command.value);
+    break;
+  case CMD_ATTACK:
+    voice_bank.attack(command.value);
+    filter_envelope.attack(command.value);
+    break;
+  case CMD_DECAY:
+    voice_bank.decay(command.value);
+    filter_envelope.decay(command.value);
+    break;
+  case CMD_RELEASE:
+    voice_bank.release(command.value);
+    filter_envelope.release(command.value);
+    break;
+  case CMD_SUSTAIN:
+    voice_bank.sustain(command.value);
+    break;
+  case CMD_SPREAD:
+    voice_bank.schedule(offset, Event::EVENT_SPREAD, command.voice,
+                        command.value, command.count);
+    break;
+  case CMD_FILTER_SUSTAIN:
+    filter_envelope.sustain(command.value);
+    break;
+  case CMD_MASTER_GAIN:
+    voice_bank.masterGain(command.value);
+    break;
+  }
+}
+
+template <uint8_t N>
+void AudioEngine<N>::begin() {
   AutosaveLib::Logger::info("Initializing Audio module");
 
+  // Nodes are configured directly here, before any note can sound; the main
+  // loop goes through the command queue from now on.
+
   // Audio connections require memory to work. For more
-  // detailed information, see the MemoryAndCpuUsage example
-  AudioMemory(20);
+  // detailed information, see the MemoryAndCpuUsage example. The voice bank
+  // renders every voice into a single block, so few are needed.
+  AudioMemory(10);
 
   // Configure LFO
   lfo_fm.frequency(kInitLfoFmFrequency);
@@ -122,40 +302,30 @@ void Audio::begin() {
   }
 
   // Per-voice detune (oscillator slop): small fixed cents offset per voice
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    voice_detune_[i] = powf(2.0f, kVoiceDetuneCents[i] / 1200.0f);
+  constexpr std::array<float, N> kVoiceDetuneCents = voiceDetuneCents<N>();
+  for (uint8_t i = 0; i < N; i++) {
+    voice_bank.detune(
+        i, AutosaveLib::fast_math::centsToRatio(kVoiceDetuneCents[i]));
   }
 
   // Slow pitch drift: per-voice random-walk (unstable, non-periodic)
-  randomSeed(micros());
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    voice_base_frequency_[i] = kInitFrequency;
-    voice_drift_cents_[i] = 0.0f;
-    voice_drift_multiplier_[i] = 1.0f;
+  voice_bank.driftSeed(drift_seeded_ ? drift_seed_ : micros());
+
+  voice_bank.waveform(kInitWaveform);
+  voice_bank.arbitraryWaveform(custom_ptr);
+  voice_bank.attack(attack_time);
+  voice_bank.hold(0);
+  voice_bank.decay(0);
+  voice_bank.release(release_time);
+
+  for (uint8_t i = 0; i < N; i++) {
+    voice_bank.frequency(i, kInitFrequency);
+    voice_bank.amplitude(i, kInitAmplitude);
+    voice_bank.gain(i, kOscMixGain * kMixerMasterGain);
   }
 
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    oscillators[i].begin(kInitWaveform);
-    applyVoiceFrequency(i);
-    oscillators[i].amplitude(kInitAmplitude);
-    oscillators[i].arbitraryWaveform(custom_ptr, 172.0f);
-
-    envelopes[i].attack(attack_time);
-    envelopes[i].hold(0);
-    envelopes[i].decay(0);
-    envelopes[i].sustain(1.0);
-    envelopes[i].release(release_time);
-
-    mixers[i / 4].gain(i % 4, kOscMixGain);
-  }
-
-  mixer_master.gain(0, 0.5f);
-  mixer_master.gain(1, 0.5f);
-
-  amplifier_master.gain(audio_config::master_gain);
-
-  // Configure DC signal for filter envelope (constant voltage source)
-  dc_signal.amplitude(kFilterEnvGain);
+  voice_bank.sustain(1.0f);
+  voice_bank.masterGain(audio_config::master_gain);
 
   // Configure filter envelope with the same ADSR values as envelopes
   filter_envelope.attack(attack_time);
@@ -165,100 +335,113 @@ void Audio::begin() {
   filter_envelope.release(release_time);
   filter_envelope.releaseNoteOn(0);
 
-  last_drift_update_ms_ = millis();
+  // Output level and clock of the filter envelope
+  cv_output.begin(cv_target_);
+
+  pitch_cv.begin();
 }
 
-void Audio::noteOn(uint8_t index, float sustain, bool triggerFilterEnvelope) {
-  envelopes[index].sustain(sustain);
-  envelopes[index].noteOn();
+template <uint8_t N>
+void AudioEngine<N>::noteOn(uint8_t index, float level,
+                            bool triggerFilterEnvelope, uint8_t count) {
+  beginCommands();
 
+  push(CMD_NOTE_ON, index, level, count);
   if (triggerFilterEnvelope) {
-    filter_envelope.sustain(sustain * 0.85f);
-    filter_envelope.noteOn();
+    push(CMD_FILTER_NOTE_ON, 0, level * 0.85f);
   }
+
+  endCommands();
 }
 
-void Audio::noteOff(uint8_t index, bool triggerFilterEnvelope) {
-  envelopes[index].noteOff();
+template <uint8_t N>
+void AudioEngine<N>::noteOff(uint8_t index, bool triggerFilterEnvelope,
+                             uint8_t count) {
+  beginCommands();
 
+  push(CMD_NOTE_OFF, index, 0.0f, count);
   if (triggerFilterEnvelope) {
-    filter_envelope.noteOff();
+    push(CMD_FILTER_NOTE_OFF, 0, 0.0f);
   }
+
+  endCommands();
 }
 
-void Audio::noteOffAll() {
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    envelopes[i].noteOff();
-  }
+template <uint8_t N>
+void AudioEngine<N>::noteOffAll() {
+  beginCommands();
+
+  push(CMD_NOTE_OFF, 0, 0.0f, N);
+  push(CMD_FILTER_NOTE_OFF, 0, 0.0f);
 
-  filter_envelope.noteOff();
+  endCommands();
 }
 
-void Audio::updateLFOFrequency(float frequency) { lfo_fm.frequency(frequency); }
+template <uint8_t N>
+void AudioEngine<N>::updateLFOFrequency(float frequency) {
+  push(CMD_LFO_FREQUENCY, 0, frequency);
+}
 
-void Audio::updateLFOAmplitude(float amplitude) { lfo_fm.amplitude(amplitude); }
+template <uint8_t N>
+void AudioEngine<N>::updateLFOAmplitude(float amplitude) {
+  push(CMD_LFO_AMPLITUDE, 0, amplitude);
+}
 
-void Audio::applyVoiceFrequency(uint8_t index) {
-  float f = voice_base_frequency_[index] * voice_detune_[index] *
-            voice_drift_multiplier_[index];
-  oscillators[index].frequency(f);
+template <uint8_t N>
+void AudioEngine<N>::updateOscillatorFrequency(uint8_t index, float frequency,
+                                               uint8_t count) {
+  push(CMD_FREQUENCY, index, frequency, count);
 }
 
-void Audio::updateOscillatorFrequency(uint8_t index, float frequency) {
-  voice_base_frequency_[index] = frequency;
-  applyVoiceFrequency(index);
+template <uint8_t N>
+void AudioEngine<N>::updateAllOscillatorsFrequency(float frequency) {
+  push(CMD_FREQUENCY, 0, frequency, N);
 }
 
-void Audio::updateAllOscillatorsFrequency(float frequency) {
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    voice_base_frequency_[i] = frequency;
-    applyVoiceFrequency(i);
+template <uint8_t N>
+void AudioEngine<N>::normalizeMasterGain(uint8_t oscillators_count) {
+  static constexpr std::array<float, N + 1> kMasterGains =
+      masterGainTable<N>();
+  if (oscillators_count > N) {
+    oscillators_count = N;
   }
+  push(CMD_MASTER_GAIN, 0, kMasterGains[oscillators_count]);
 }
 
-void Audio::updateDrift() {
-  uint32_t now = millis();
-  if (now - last_drift_update_ms_ < kDriftUpdateIntervalMs) {
-    return;
-  }
-  last_drift_update_ms_ = now;
-
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    // Random step: ±kDriftStepCents per update (non-periodic wander)
-    float step = (static_cast<float>(random(0, 2001) - 1000) / 1000.0f) *
-                 kDriftStepCents;
-    voice_drift_cents_[i] += step;
-    if (voice_drift_cents_[i] > kDriftCentsAmplitude) {
-      voice_drift_cents_[i] = kDriftCentsAmplitude;
-    } else if (voice_drift_cents_[i] < -kDriftCentsAmplitude) {
-      voice_drift_cents_[i] = -kDriftCentsAmplitude;
-    }
-    voice_drift_multiplier_[i] = powf(2.0f, voice_drift_cents_[i] / 1200.0f);
-    applyVoiceFrequency(i);
-  }
+template <uint8_t N>
+void AudioEngine<N>::updateOscillatorAmplitude(uint8_t index, float amplitude,
+                                               uint8_t count) {
+  push(CMD_AMPLITUDE, index, amplitude, count);
 }
 
-void Audio::updateOscillatorAmplitude(uint8_t index, float amplitude) {
-  oscillators[index].amplitude(amplitude);
+template <uint8_t N>
+void AudioEngine<N>::updateOscillatorSpread(uint8_t index, float cents,
+                                            uint8_t count) {
+  push(CMD_SPREAD, index, cents, count);
 }
 
-void Audio::updateAllOscillatorsAmplitude(float amplitude) {
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    oscillators[i].amplitude(amplitude);
-  }
+template <uint8_t N>
+void AudioEngine<N>::updateAllOscillatorsAmplitude(float amplitude) {
+  push(CMD_AMPLITUDE, 0, amplitude, N);
 }
 
-void Audio::updateAllOscillatorsWaveform(uint8_t waveform) {
-  float gain = computeGainFromWaveform(waveform);
+template <uint8_t N>
+void AudioEngine<N>::updateAllOscillatorsWaveform(uint8_t waveform) {
+  float gain = computeGainFromWaveform(waveform) * kMixerMasterGain;
+
+  beginCommands();
 
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    oscillators[i].begin(waveform);
-    mixers[i / 4].gain(i % 4, gain);
+  push(CMD_WAVEFORM, 0, waveform);
+  for (uint8_t i = 0; i < N; i++) {
+    push(CMD_GAIN, i, gain);
   }
+
+  endCommands();
 }
 
-const int16_t *Audio::getCustomWaveformPointer(uint8_t bank,
-                                               uint8_t index) const {
+template <uint8_t N>
+const int16_t *AudioEngine<N>::getCustomWaveformPointer(uint8_t bank,
+                                                        uint8_t index) const {
   switch (bank) {
   case CUSTOM_WAVEFORM_BANK_FM:
     return (index < AKWF_FM_COUNT) ? AKWF_FM[index] : nullptr;
@@ -271,9 +454,10 @@ const int16_t *Audio::getCustomWaveformPointer(uint8_t bank,
   }
 }
 
-void Audio::setCustomWaveform(uint8_t bank, uint8_t index) {
+template <uint8_t N>
+bool AudioEngine<N>::setCustomWaveform(uint8_t bank, uint8_t index) {
   if (bank > CUSTOM_WAVEFORM_BANK_OVERTONE) {
-    return;
+    return false;
   }
   size_t max_index = 0;
   switch (bank) {
@@ -288,13 +472,16 @@ void Audio::setCustomWaveform(uint8_t bank, uint8_t index) {
     break;
   }
   if (index >= max_index) {
-    return;
+    return false;
   }
   custom_waveform_bank_ = bank;
   custom_waveform_index_ = index;
+  return true;
 }
 
-void Audio::getCustomWaveform(uint8_t *out_bank, uint8_t *out_index) const {
+template <uint8_t N>
+void AudioEngine<N>::getCustomWaveform(uint8_t *out_bank,
+                                       uint8_t *out_index) const {
   if (out_bank != nullptr) {
     *out_bank = custom_waveform_bank_;
   }
@@ -303,63 +490,51 @@ void Audio::getCustomWaveform(uint8_t *out_bank, uint8_t *out_index) const {
   }
 }
 
-void Audio::applyCustomWaveform() {
+template <uint8_t N>
+void AudioEngine<N>::applyCustomWaveform() {
   const int16_t *ptr =
       getCustomWaveformPointer(custom_waveform_bank_, custom_waveform_index_);
   if (ptr == nullptr) {
     return;
   }
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    oscillators[i].arbitraryWaveform(ptr, 172.0f);
-  }
+  push(CMD_ARBITRARY_WAVEFORM, ptr);
 }
 
-void Audio::updateEnvelopeMode(bool percussive_mode) {
+template <uint8_t N>
+void AudioEngine<N>::updateEnvelopeMode(bool percussive_mode) {
   percussive_mode_ = percussive_mode;
 
   float decay = percussive_mode_ ? release_time : 0.0f;
   float sustain = percussive_mode_ ? 0.0f : 1.0f;
-  float release = percussive_mode_ ? 0.0f : release_time;
 
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    envelopes[i].decay(decay);
-    envelopes[i].sustain(sustain);
-    envelopes[i].release(release);
-  }
+  beginCommands();
+
+  push(CMD_DECAY, 0, decay);
+  push(CMD_SUSTAIN, 0, sustain);
+  push(CMD_FILTER_SUSTAIN, 0, sustain);
 
-  filter_envelope.decay(decay);
-  filter_envelope.sustain(sustain * 0.75f);
-  filter_envelope.release(release);
+  endCommands();
 }
 
-void Audio::updateAttack(float attack) {
+template <uint8_t N>
+void AudioEngine<N>::updateAttack(float attack) {
   attack_time = attack * 149.0f + 1.0f; // 1 to 150ms
 
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    envelopes[i].attack(attack_time);
-  }
-
-  filter_envelope.attack(attack_time);
+  push(CMD_ATTACK, 0, attack_time);
 }
 
-void Audio::updateRelease(float release) {
+template <uint8_t N>
+void AudioEngine<N>::updateRelease(float release) {
   release_time = release * 598.0f + 2.0f; // 2 to 600ms
 
-  if (percussive_mode_) {
-    for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-      envelopes[i].decay(release_time);
-    }
-
-    filter_envelope.decay(release_time);
+  beginCommands();
 
-    return;
-  }
-
-  for (uint8_t i = 0; i < audio_config::voices_number; i++) {
-    envelopes[i].release(release_time);
+  if (percussive_mode_) {
+    push(CMD_DECAY, 0, release_time);
   }
+  push(CMD_RELEASE, 0, release_time);
 
-  filter_envelope.release(release_time);
+  endCommands();
 }
 
 /**
@@ -368,7 +543,8 @@ void Audio::updateRelease(float release) {
  * @param note The MIDI note number.
  * @return The frequency of the note.
  */
-float Audio::computeFrequencyFromNote(uint8_t note) {
+template <uint8_t N>
+float AudioEngine<N>::computeFrequencyFromNote(uint8_t note) {
   if (note < 0) {
     return 0.0f;
   }
@@ -386,7 +562,8 @@ float Audio::computeFrequencyFromNote(uint8_t note) {
  * @param waveform The waveform type.
  * @return The gain of the waveform.
  */
-float Audio::computeGainFromWaveform(uint8_t waveform) {
+template <uint8_t N>
+float AudioEngine<N>::computeGainFromWaveform(uint8_t waveform) {
   float gain = kOscMixGain;
 
   if (waveform == WAVEFORM_BANDLIMIT_SQUARE) {
@@ -400,20 +577,21 @@ float Audio::computeGainFromWaveform(uint8_t waveform) {
 }
 
 /**
- * @TODO: NOT USED YET
- * Compute the frequency of the waveform based on the mod and cv input.
- *
- * The mod input is should be from 0 to 1, and the cv input from 0 to 10.
+ * Compute the frequency of a 1V/oct pitch CV, from 0 to 10 V (0 V = C0).
+ * Same table lookup as the pitch CV input.
  * @see https://vcvrack.com/manual/VoltageStandards#Pitch-and-Frequencies
  */
-float Audio::computeFrequencyFromCV(float cv) {
+template <uint8_t N>
+float AudioEngine<N>::computeFrequencyFromCV(float cv) {
   if (cv < 0) {
     cv = 0.0f;
   } else if (cv > 10) {
     cv = 10.0f;
   }
 
-  return 32.7032f * powf(2.0f, cv); // f0 = C0 = 32.7032
+  return 32.7032f * PitchCvInput::voltsToRatio(cv); // f0 = C0 = 32.7032
 }
 
-} // namespace Autosave
\ No newline at end of file
+template class AudioEngine<audio_config::voices_number>;
+
+} // namespace Autosave
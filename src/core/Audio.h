@@ -2,81 +2,230 @@
 #define AUTOSAVE_AUDIO_H
 
 #include <Audio.h>
-#include <cmath>
 #include <cstdint>
 
+#include "core/AudioConfig.h"
+#include "core/CvOutput.h"
+#include "core/EnvelopeGenerator.h"
+#include "core/PitchCvInput.h"
+#include "core/VoiceBank.h"
 #include "lib/Logger.h"
-
+#include "lib/SpscQueue.h"
 
 namespace Autosave {
 
-namespace audio_config {
-static constexpr uint8_t voices_number = 8;
-static constexpr float master_gain = 0.75f;
-} // namespace audio_config
-
-class Audio {
+/**
+ * Audio engine for N voices (see audio_config::voices_number). Audio.cpp
+ * instantiates it for the configured voice count; use the Audio alias.
+ *
+ * Note and parameter methods are called from the main loop and never touch
+ * the audio objects directly: they queue timestamped commands, which the
+ * audio update applies in the next block. The audio interrupt never needs to
+ * be masked.
+ *
+ * Voice commands (notes, pitch, amplitude) land at the sample offset that
+ * matches their timestamp within the previous block period, so timing keeps
+ * a fixed one-block latency instead of snapping to block boundaries. They
+ * take an optional voice count and then apply to voices [index, index +
+ * count) as a single command, e.g. for a unison stack.
+ *
+ * Once enabled or calibrated, the pitch CV input transposes every voice at
+ * the start of each block, 1 V per octave (0 V: notes play as sent).
+ */
+template <uint8_t N> class AudioEngine {
 public:
-  Audio();
+  AudioEngine();
 
   void begin();
 
-  void noteOn(uint8_t index, float sustain, bool triggerFilterEnvelope = false);
-  void noteOff(uint8_t index, bool triggerFilterEnvelope = false);
+  /**
+   * Group the commands queued until the matching endCommands() so the audio
+   * update applies them in the same block (e.g. frequency and note on).
+   * Calls may nest.
+   */
+  void beginCommands() { command_batch_depth_++; }
+  /** Same, stamping the commands with `cycles` (e.g. when MIDI was read). */
+  void beginCommands(uint32_t cycles) {
+    if (command_batch_depth_++ == 0) {
+      command_batch_cycles_ = cycles;
+      command_batch_stamped_ = true;
+    }
+  }
+  void endCommands() {
+    if (command_batch_depth_ > 0 && --command_batch_depth_ == 0) {
+      command_batch_stamped_ = false;
+      commands_.commit();
+    }
+  }
+
+  /** `level`: peak of the envelope (velocity), 0 to 1. */
+  void noteOn(uint8_t index, float level, bool triggerFilterEnvelope = false,
+              uint8_t count = 1);
+  void noteOff(uint8_t index, bool triggerFilterEnvelope = false,
+               uint8_t count = 1);
   void noteOffAll();
+  /**
+   * True while the voice's envelope sounds, as of the last audio block
+   * (queued commands are not applied yet).
+   */
+  bool voiceActive(uint8_t index) const { return voice_bank.active(index); }
 
+  /**
+   * Percussive: no sustain, notes decay over the release time whether or
+   * not they are held. Otherwise notes sustain at their peak level.
+   */
   void updateEnvelopeMode(bool percussive_mode);
 
   void updateLFOFrequency(float frequency);
   void updateLFOAmplitude(float amplitude);
 
-  void updateOscillatorFrequency(uint8_t index, float frequency);
+  void updateOscillatorFrequency(uint8_t index, float frequency,
+                                 uint8_t count = 1);
   void updateAllOscillatorsFrequency(float frequency);
 
-  /** Advance slow pitch drift (call from main loop, rate-limited internally).
+  /**
+   * Seed the pitch drift of the voice bank (call before begin()). Unseeded,
+   * begin() seeds it from micros(); host renders set a seed so they are
+   * reproducible.
    */
-  void updateDrift();
+  void setDriftSeed(uint32_t seed) {
+    drift_seed_ = seed;
+    drift_seeded_ = true;
+  }
 
-  void updateOscillatorAmplitude(uint8_t index, float amplitude);
+  void updateOscillatorAmplitude(uint8_t index, float amplitude,
+                                 uint8_t count = 1);
+  /**
+   * Spread `count` voices from `index` evenly over `cents` around their
+   * pitch, on top of the per-voice detune (unison). 0 cents removes it.
+   */
+  void updateOscillatorSpread(uint8_t index, float cents, uint8_t count = 1);
   void updateAllOscillatorsAmplitude(float amplitude);
 
   void updateAllOscillatorsWaveform(uint8_t waveform);
 
   /** Custom (arbitrary) waveform: bank 0=FM, 1=Granular, 2=Overtone; index
-   * within bank. */
-  void setCustomWaveform(uint8_t bank, uint8_t index);
+   * within bank. False, keeping the current waveform, when out of range. */
+  bool setCustomWaveform(uint8_t bank, uint8_t index);
   void getCustomWaveform(uint8_t *out_bank, uint8_t *out_index) const;
   /** Apply current custom waveform table to all oscillators (when in arbitrary
    * mode). */
   void applyCustomWaveform();
 
-  void updateAttack(float attack);
-  void updateRelease(float release);
+  /**
+   * Where the filter envelope CV goes (call before begin()). Defaults to the
+   * codec's left channel, or to PWM with AUTOSAVE_CV_PWM; host renders pick
+   * the codec so the CV lands in the WAV.
+   */
+  void setCvTarget(CvOutput::Target target) { cv_target_ = target; }
+  /**
+   * Pitch CV calibration: the input is at `volt` volts now. Once every point
+   * is measured, saveCvInputCalibration() stores them; false if the readings
+   * do not rise with the voltage.
+   */
+  void calibrateCvInput(uint8_t volt) { pitch_cv.calibrate(volt); }
+  /** Where the pitch CV is read (Hardware's scanner); none: 0 V. */
+  void setCvInput(const AnalogScanner *scanner) { pitch_cv.source(scanner); }
+  bool saveCvInputCalibration() { return pitch_cv.saveCalibration(); }
+  /** Transpose by the pitch CV even uncalibrated (off by default). */
+  void setCvInputEnabled(bool enabled) { pitch_cv.setEnabled(enabled); }
 
-  void normalizeMasterGain(uint8_t oscillators_count) {
-    // @TODO: use table instead of log2f to improve performance
-    float gain_correction = 3.0f / std::log2f(oscillators_count + 10.0f);
-    float normalized_gain = audio_config::master_gain * gain_correction;
+  /** Set and save the calibration of a CV output target. */
+  void calibrateCv(CvOutput::Target target,
+                   CvOutput::Calibration calibration) {
+    cv_output.calibrate(target, calibration);
+  }
 
-    AutosaveLib::Logger::debug("Normalized gain: " + String(normalized_gain));
+  void updateAttack(float attack);
+  void updateRelease(float release);
 
-    amplifier_master.gain(normalized_gain);
-  }
+  /**
+   * Scale the master gain for `oscillators_count` sounding oscillators, so
+   * chords do not clip. Table lookup; the voice bank ramps to the new gain
+   * over one block.
+   */
+  void normalizeMasterGain(uint8_t oscillators_count);
 
   static float computeFrequencyFromNote(uint8_t note);
   static float computeFrequencyFromCV(float cv);
 
+  /** Longest time a command waited in the queue, in CPU cycles. */
+  uint32_t commandLatencyMaxCycles() const { return command_latency_max_; }
+  void commandLatencyMaxReset() { command_latency_max_ = 0; }
+  /** Commands dropped because the queue was full. */
+  uint32_t droppedCommands() const { return dropped_commands_; }
+
+  /**
+   * Off: apply every command at the start of the block, as before sample
+   * offsets existed. Only meant for A/B timing measurements.
+   */
+  void setSampleAccurateCommands(bool enabled) {
+    sample_accurate_commands_ = enabled;
+  }
+
 private:
+  enum CommandType : uint8_t {
+    CMD_NOTE_ON,
+    CMD_NOTE_OFF,
+    CMD_FILTER_NOTE_ON,
+    CMD_FILTER_NOTE_OFF,
+    CMD_FREQUENCY,
+    CMD_AMPLITUDE,
+    CMD_GAIN,
+    CMD_WAVEFORM,
+    CMD_ARBITRARY_WAVEFORM,
+    CMD_LFO_FREQUENCY,
+    CMD_LFO_AMPLITUDE,
+    CMD_ATTACK,
+    CMD_DECAY,
+    CMD_RELEASE,
+    CMD_SUSTAIN,
+    CMD_FILTER_SUSTAIN,
+    CMD_MASTER_GAIN,
+    CMD_SPREAD,
+  };
+
+  struct Command {
+    uint32_t timestamp; // ARM_DWT_CYCCNT when queued
+    CommandType type;
+    uint8_t voice;
+    uint8_t count; // voices from `voice` that the command applies to
+    union {
+      float value;
+      const int16_t *data;
+    };
+  };
+
+  /** First node of the graph, so commands land before any audio is made. */
+  class CommandInput : public AudioStream {
+  public:
+    explicit CommandInput(AudioEngine &engine)
+        : AudioStream(0, nullptr), engine_(engine) {
+      // No connections: keep it in the update list regardless.
+      active = true;
+    }
+
+  private:
+    AudioEngine &engine_;
+    void update(void) override { engine_.drainCommands(); }
+  };
+
+  static constexpr uint16_t kCommandQueueSize = 128;
+  // One drain never schedules more events than the queue holds commands.
+  static_assert(VoiceBank<N>::kMaxEvents >= kCommandQueueSize - 1,
+                "every drained command must fit the voice bank's events");
+
+  CommandInput command_input{*this};
   AudioSynthWaveformSine lfo_fm;
-  AudioSynthWaveformModulated oscillators[audio_config::voices_number];
-  AudioEffectEnvelope envelopes[audio_config::voices_number];
-  AudioMixer4 mixers[audio_config::voices_number / 4];
-  AudioMixer4 mixer_master;
-  AudioAmplifier amplifier_master;
-  AudioSynthWaveformDc dc_signal;
-  AudioEffectEnvelope filter_envelope;
+  VoiceBank<N> voice_bank;
+  EnvelopeGenerator filter_envelope;
   AudioOutputI2S i2s1;
-  AudioConnection patchCords[30];
+  AudioConnection patchCords[3];
+  CvOutput cv_output{filter_envelope};
+  PitchCvInput pitch_cv;
+  CvOutput::Target cv_target_ = audio_config::cv_on_pwm
+                                    ? CvOutput::TARGET_PWM
+                                    : CvOutput::TARGET_I2S;
 
   bool percussive_mode_ = false;
   float attack_time = 1.0f;
@@ -85,24 +234,33 @@ private:
   uint8_t custom_waveform_bank_ = 2;
   uint8_t custom_waveform_index_ = 42;
 
-  /** Per-voice detune multipliers (oscillator slop); applied to frequency. */
-  float voice_detune_[audio_config::voices_number];
+  uint32_t drift_seed_ = 0;
+  bool drift_seeded_ = false;
 
-  /** Per-voice base frequency (nominal pitch before detune and drift). */
-  float voice_base_frequency_[audio_config::voices_number];
-  /** Per-voice drift offset in cents (random walk); applied with detune. */
-  float voice_drift_cents_[audio_config::voices_number];
-  /** Per-voice drift multiplier (1.0 ± small); applied with detune. */
-  float voice_drift_multiplier_[audio_config::voices_number];
-  /** Last time updateDrift() ran (ms). */
-  uint32_t last_drift_update_ms_ = 0;
+  AutosaveLib::SpscQueue<Command, kCommandQueueSize> commands_;
+  uint32_t command_latency_max_ = 0; // written by the audio update only
+  uint32_t dropped_commands_ = 0;    // written by the main loop only
+  uint8_t command_batch_depth_ = 0;
+  bool command_batch_stamped_ = false;
+  uint32_t command_batch_cycles_ = 0;
+  bool sample_accurate_commands_ = true;
+  /** ARM_DWT_CYCCNT at the previous drain (start of the previous block). */
+  uint32_t block_start_cycles_ = 0;
+  /** Timestamp of the last note on recorded in NoteLatency. */
+  uint32_t latency_timestamp_ = 0;
 
-  void applyVoiceFrequency(uint8_t index);
+  void push(CommandType type, uint8_t voice, float value, uint8_t count = 1);
+  void push(CommandType type, const int16_t *data);
+  void drainCommands();
+  void applyCommand(const Command &command, uint8_t offset, uint32_t now,
+                    uint32_t period);
 
   const int16_t *getCustomWaveformPointer(uint8_t bank, uint8_t index) const;
   float computeGainFromWaveform(uint8_t waveform);
 };
 
+using Audio = AudioEngine<audio_config::voices_number>;
+
 } // namespace Autosave
 
 #endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef AUTOSAVE_AUDIO_CONFIG_H
+#define AUTOSAVE_AUDIO_CONFIG_H
+
+#include <cstdint>
+
+namespace Autosave {
+
+/**
+ * Number of voices. Override with -DAUTOSAVE_VOICES=N in build_flags to build
+ * 12- or 16-voice firmware; the audio engine is sized at compile time.
+ */
+#ifndef AUTOSAVE_VOICES
+#define AUTOSAVE_VOICES 8
+#endif
+
+namespace audio_config {
+static constexpr uint8_t voices_number = AUTOSAVE_VOICES;
+static constexpr float master_gain = 0.75f;
+
+/**
+ * The filter envelope CV goes out on the left channel of the codec, which
+ * drives the filter cutoff on the board. Build with -DAUTOSAVE_CV_PWM to send
+ * it as PWM on hardware::PIN_CV_OUT instead (see CvOutput); that pin is not
+ * connected on the stock board.
+ */
+#ifdef AUTOSAVE_CV_PWM
+static constexpr bool cv_on_pwm = true;
+#else
+static constexpr bool cv_on_pwm = false;
+#endif
+
+// Mono mode plays three oscillators; the detune pattern covers 16 voices.
+static_assert(voices_number >= 3 && voices_number <= 16,
+              "AUTOSAVE_VOICES must be between 3 and 16");
+} // namespace audio_config
+
+} // namespace Autosave
+
+#endif
@@ -0,0 +1,86 @@
+#include "CvOutput.h"
+
+#include "core/EepromStorage.h"
+#include "core/Hardware.h"
+
+namespace {
+constexpr uint8_t kPwmResolutionBits = 12;
+constexpr float kPwmFullScale = 4095.0f;
+// Ideal carrier for 12-bit PWM at 600 MHz, far above the envelope's content.
+constexpr float kPwmFrequency = 36621.09f;
+
+// One envelope step per tick, so times match the i2s path exactly.
+constexpr float kTickMicros = Autosave::Envelopes<1>::kStepSamples *
+                              1000000.0f / AUDIO_SAMPLE_RATE_EXACT;
+
+// Full scale of the i2s path is the codec's; half of it is the level the
+// filter envelope always had. PWM swings the whole duty range.
+constexpr Autosave::CvOutput::Calibration
+    kDefaultCalibrations[Autosave::CvOutput::TARGET_COUNT] = {
+        {0.0f, 0.5f}, // TARGET_I2S
+        {0.0f, 1.0f}, // TARGET_PWM
+};
+
+static_assert(Autosave::CvOutput::TARGET_COUNT <=
+                  Autosave::EepromStorage::kCvTargets,
+              "every CV output target needs an EEPROM calibration slot");
+} // namespace
+
+namespace Autosave {
+
+void CvOutput::begin(Target target) {
+  for (uint8_t i = 0; i < TARGET_COUNT; i++) {
+    calibrations_[i] = kDefaultCalibrations[i];
+    EepromStorage::loadCvCalibration(i, calibrations_[i].offset,
+                                     calibrations_[i].scale);
+  }
+
+  timer_.end();
+  target_ = target < TARGET_COUNT ? target : TARGET_I2S;
+  apply();
+
+  if (target_ != TARGET_PWM) {
+    envelope_.setExternalClock(false);
+    return;
+  }
+
+  instance_ = this;
+  analogWriteResolution(kPwmResolutionBits);
+  analogWriteFrequency(hardware::PIN_CV_OUT, kPwmFrequency);
+  analogWrite(hardware::PIN_CV_OUT, 0);
+  envelope_.setExternalClock(true);
+  // Default priority, above the audio update: EnvelopeGenerator hands note
+  // requests over to step() without masking interrupts.
+  timer_.begin(&CvOutput::tick, kTickMicros);
+}
+
+CvOutput::Calibration CvOutput::calibration(Target target) const {
+  return calibrations_[target < TARGET_COUNT ? target : TARGET_I2S];
+}
+
+void CvOutput::calibrate(Target target, Calibration calibration) {
+  if (target >= TARGET_COUNT) {
+    return;
+  }
+  calibrations_[target] = calibration;
+  EepromStorage::saveCvCalibration(target, calibration.offset,
+                                   calibration.scale);
+  if (target == target_) {
+    apply();
+  }
+}
+
+void CvOutput::apply() {
+  envelope_.offset(calibrations_[target_].offset);
+  envelope_.amplitude(calibrations_[target_].scale);
+}
+
+void CvOutput::tick() {
+  float level = instance_->envelope_.step();
+  if (level < 0.0f) {
+    level = 0.0f;
+  }
+  analogWrite(hardware::PIN_CV_OUT, (int)(level * kPwmFullScale + 0.5f));
+}
+
+} // namespace Autosave
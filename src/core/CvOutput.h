@@ -0,0 +1,65 @@
+#ifndef AUTOSAVE_CV_OUTPUT_H
+#define AUTOSAVE_CV_OUTPUT_H
+
+#include <Arduino.h>
+#include <cstdint>
+
+#include "core/EnvelopeGenerator.h"
+
+namespace Autosave {
+
+/**
+ * Output stage of the filter envelope control voltage.
+ *
+ * - TARGET_I2S: default, the envelope renders into the left channel of the
+ *   codec as an audio signal (EnvelopeGenerator in the audio graph); on the
+ *   board, that channel is ENV_OUT and drives the filter cutoff.
+ * - TARGET_PWM: opt-in with AUTOSAVE_CV_PWM, as the stock board leaves the
+ *   pin unconnected. A timer steps the envelope at its own rate (one step of
+ *   Envelopes::kStepSamples, about 5.5 kHz) and writes each level as a 12-bit
+ *   PWM duty on hardware::PIN_CV_OUT, to be smoothed by an RC filter. The
+ *   envelope never touches the audio graph: no audio block, and the left
+ *   channel of the codec is free.
+ *
+ * Each target has its own calibration, stored in EEPROM: the output is
+ * offset + scale * level, as a fraction of the target's full scale, so the
+ * analog stage after it can be trimmed to exact voltages.
+ */
+class CvOutput {
+public:
+  enum Target : uint8_t {
+    TARGET_I2S,
+    TARGET_PWM,
+    TARGET_COUNT,
+  };
+
+  struct Calibration {
+    float offset;
+    float scale;
+  };
+
+  explicit CvOutput(EnvelopeGenerator &envelope) : envelope_(envelope) {}
+
+  /** Load the calibrations from EEPROM and start driving `target`. */
+  void begin(Target target);
+  Target target() const { return target_; }
+
+  Calibration calibration(Target target) const;
+  /** Set and save the calibration of `target`. */
+  void calibrate(Target target, Calibration calibration);
+
+private:
+  inline static CvOutput *instance_ = nullptr;
+
+  EnvelopeGenerator &envelope_;
+  IntervalTimer timer_;
+  Target target_ = TARGET_I2S;
+  Calibration calibrations_[TARGET_COUNT];
+
+  void apply();
+  static void tick();
+};
+
+} // namespace Autosave
+
+#endif
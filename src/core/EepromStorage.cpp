@@ -1,7 +1,9 @@
 #include "EepromStorage.h"
 #include "lib/Logger.h"
+#include "lib/SysexProtocol.h"
 
 #include <EEPROM.h>
+#include <cmath>
 #include <cstdint>
 
 namespace {
@@ -19,6 +21,23 @@ constexpr uint8_t kCustomWaveformMagic = 0xA7;
 constexpr uint8_t kCustomWaveformAddrMagic = 30;
 constexpr uint8_t kCustomWaveformAddrBank = 31;
 constexpr uint8_t kCustomWaveformAddrIndex = 32;
+// EEPROM layout for CV calibration (addresses 40+): per target, a magic byte
+// then offset and scale as floats.
+constexpr uint8_t kCvCalibrationMagic = 0xA8;
+constexpr uint8_t kCvCalibrationAddr = 40;
+constexpr uint8_t kCvCalibrationSize = 1 + 2 * sizeof(float);
+// EEPROM layout for pitch CV calibration (addresses 80+): magic, point
+// count, then the points as floats (12-bit readings; 0xA9 held 10-bit ones).
+constexpr uint8_t kPitchCvMagic = 0xAA;
+constexpr uint8_t kPitchCvAddrMagic = 80;
+constexpr uint8_t kPitchCvAddrCount = 81;
+constexpr uint8_t kPitchCvAddrData = 82;
+// EEPROM layout for the poly voice policy (addresses 150+, after 16 pitch CV
+// points).
+constexpr uint8_t kVoicePolicyMagic = 0xAB;
+constexpr uint8_t kVoicePolicyAddrMagic = 150;
+constexpr uint8_t kVoicePolicyAddrSteal = 151;
+constexpr uint8_t kVoicePolicyAddrRetrigger = 152;
 } // namespace
 
 namespace Autosave {
@@ -108,4 +127,109 @@ void EepromStorage::saveCustomWaveform(uint8_t bank, uint8_t index) {
   AutosaveLib::Logger::debug("Saved custom waveform to EEPROM");
 }
 
+void EepromStorage::loadVoicePolicy(uint8_t &out_steal_policy,
+                                    bool &out_retrigger_same_note) {
+  out_steal_policy = EepromStorage::kStealPolicyDefault;
+  out_retrigger_same_note = EepromStorage::kRetriggerSameNoteDefault;
+  if (EEPROM.read(kVoicePolicyAddrMagic) != kVoicePolicyMagic) {
+    return;
+  }
+  const uint8_t steal_policy = EEPROM.read(kVoicePolicyAddrSteal);
+  if (steal_policy < AutosaveLib::sysex::kStealPolicies) {
+    out_steal_policy = steal_policy;
+  }
+  out_retrigger_same_note = EEPROM.read(kVoicePolicyAddrRetrigger) != 0;
+  AutosaveLib::Logger::debug("Loaded voice policy from EEPROM: steal " +
+                            String(out_steal_policy) + " retrigger " +
+                            String(out_retrigger_same_note));
+}
+
+void EepromStorage::saveVoicePolicy(uint8_t steal_policy,
+                                    bool retrigger_same_note) {
+  if (steal_policy >= AutosaveLib::sysex::kStealPolicies) {
+    return;
+  }
+  EEPROM.write(kVoicePolicyAddrMagic, kVoicePolicyMagic);
+  EEPROM.write(kVoicePolicyAddrSteal, steal_policy);
+  EEPROM.write(kVoicePolicyAddrRetrigger, retrigger_same_note ? 1 : 0);
+  AutosaveLib::Logger::debug("Saved voice policy to EEPROM");
+}
+
+void EepromStorage::saveSettings(uint8_t channel, const ArpModeSteps &arp_steps,
+                                 uint8_t waveform_bank, uint8_t waveform_index,
+                                 uint8_t steal_policy,
+                                 bool retrigger_same_note) {
+  saveMidiChannel(channel);
+  saveArpModeSteps(arp_steps);
+  saveCustomWaveform(waveform_bank, waveform_index);
+  saveVoicePolicy(steal_policy, retrigger_same_note);
+}
+
+void EepromStorage::loadCvCalibration(uint8_t target, float &out_offset,
+                                      float &out_scale) {
+  if (target >= EepromStorage::kCvTargets) {
+    return;
+  }
+  const int addr = kCvCalibrationAddr + target * kCvCalibrationSize;
+  if (EEPROM.read(addr) != kCvCalibrationMagic) {
+    return;
+  }
+  float offset = 0.0f;
+  float scale = 0.0f;
+  EEPROM.get(addr + 1, offset);
+  EEPROM.get(addr + 1 + sizeof(float), scale);
+  if (!std::isfinite(offset) || !std::isfinite(scale)) {
+    return;
+  }
+  out_offset = offset;
+  out_scale = scale;
+  AutosaveLib::Logger::debug("Loaded CV calibration from EEPROM: target " +
+                            String(target));
+}
+
+void EepromStorage::saveCvCalibration(uint8_t target, float offset,
+                                      float scale) {
+  if (target >= EepromStorage::kCvTargets) {
+    return;
+  }
+  const int addr = kCvCalibrationAddr + target * kCvCalibrationSize;
+  EEPROM.write(addr, kCvCalibrationMagic);
+  EEPROM.put(addr + 1, offset);
+  EEPROM.put(addr + 1 + sizeof(float), scale);
+  AutosaveLib::Logger::debug("Saved CV calibration to EEPROM");
+}
+
+bool EepromStorage::loadPitchCvCalibration(float *out_points, uint8_t count) {
+  if (EEPROM.read(kPitchCvAddrMagic) != kPitchCvMagic ||
+      EEPROM.read(kPitchCvAddrCount) != count ||
+      count > EepromStorage::kPitchCvPointsMax) {
+    return false;
+  }
+  float points[EepromStorage::kPitchCvPointsMax];
+  for (uint8_t i = 0; i < count; i++) {
+    EEPROM.get(kPitchCvAddrData + i * sizeof(float), points[i]);
+    if (!std::isfinite(points[i])) {
+      return false;
+    }
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    out_points[i] = points[i];
+  }
+  AutosaveLib::Logger::debug("Loaded pitch CV calibration from EEPROM");
+  return true;
+}
+
+void EepromStorage::savePitchCvCalibration(const float *points,
+                                           uint8_t count) {
+  if (count > EepromStorage::kPitchCvPointsMax) {
+    return;
+  }
+  EEPROM.write(kPitchCvAddrMagic, kPitchCvMagic);
+  EEPROM.write(kPitchCvAddrCount, count);
+  for (uint8_t i = 0; i < count; i++) {
+    EEPROM.put(kPitchCvAddrData + i * sizeof(float), points[i]);
+  }
+  AutosaveLib::Logger::debug("Saved pitch CV calibration to EEPROM");
+}
+
 } // namespace Autosave
@@ -52,6 +52,60 @@ public:
    * Save custom waveform bank and index to EEPROM.
    */
   static void saveCustomWaveform(uint8_t bank, uint8_t index);
+
+  /** Default poly voice stealing: oldest note, same-note retrigger on. */
+  static constexpr uint8_t kStealPolicyDefault = 0;
+  static constexpr bool kRetriggerSameNoteDefault = true;
+
+  /**
+   * Load the poly voice stealing policy (see VoiceAllocator::StealPolicy)
+   * and same-note retrigger. If magic is invalid, outputs are set to defaults.
+   */
+  static void loadVoicePolicy(uint8_t &out_steal_policy,
+                              bool &out_retrigger_same_note);
+
+  /**
+   * Save the poly voice stealing policy. No-op if out of range.
+   */
+  static void saveVoicePolicy(uint8_t steal_policy, bool retrigger_same_note);
+
+  /**
+   * Save every patch setting (MIDI channel, arp steps, custom waveform,
+   * voice policy) in one go, as a patch load changes them together.
+   */
+  static void saveSettings(uint8_t channel, const ArpModeSteps &arp_steps,
+                           uint8_t waveform_bank, uint8_t waveform_index,
+                           uint8_t steal_policy, bool retrigger_same_note);
+
+  /** CV output targets with a calibration slot (see CvOutput::Target). */
+  static constexpr uint8_t kCvTargets = 4;
+
+  /**
+   * Load the CV calibration (offset and scale) of a CV output target.
+   * If magic is invalid or a value is not finite, outputs are left unchanged.
+   */
+  static void loadCvCalibration(uint8_t target, float &out_offset,
+                                float &out_scale);
+
+  /**
+   * Save the CV calibration of a CV output target. No-op if out of range.
+   */
+  static void saveCvCalibration(uint8_t target, float offset, float scale);
+
+  /** Points of the pitch CV input calibration (see PitchCvInput). */
+  static constexpr uint8_t kPitchCvPointsMax = 16;
+
+  /**
+   * Load `count` pitch CV calibration points (readings at 0 V, 1 V, ...).
+   * If magic or count is invalid, or a value is not finite, out_points is
+   * left unchanged and false is returned.
+   */
+  static bool loadPitchCvCalibration(float *out_points, uint8_t count);
+
+  /**
+   * Save `count` pitch CV calibration points. No-op if count is too large.
+   */
+  static void savePitchCvCalibration(const float *points, uint8_t count);
 };
 
 } // namespace Autosave
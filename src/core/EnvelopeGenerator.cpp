@@ -0,0 +1,85 @@
+#include "EnvelopeGenerator.h"
+
+namespace {
+constexpr float kFullScale = 32767.0f;
+
+float clampUnit(float value) {
+  if (value < -1.0f) {
+    return -1.0f;
+  }
+  if (value > 1.0f) {
+    return 1.0f;
+  }
+  return value;
+}
+} // namespace
+
+namespace Autosave {
+
+void EnvelopeGenerator::amplitude(float amplitude) {
+  amplitude_ = clampUnit(amplitude);
+}
+
+void EnvelopeGenerator::offset(float offset) { offset_ = clampUnit(offset); }
+
+void EnvelopeGenerator::noteOn(float peak) {
+  note_peak_ = peak;
+  note_on_sequence_ = ++sequence_;
+}
+
+void EnvelopeGenerator::noteOff() { note_off_sequence_ = ++sequence_; }
+
+void EnvelopeGenerator::applyNotes() {
+  const uint32_t on = note_on_sequence_;
+  const uint32_t off = note_off_sequence_;
+  if (on != applied_on_) {
+    applied_on_ = on;
+    envelope_.noteOn(0, note_peak_);
+  }
+  if (off != applied_off_) {
+    applied_off_ = off;
+    // An older note off was overtaken by the note on just applied.
+    if ((int32_t)(off - on) > 0) {
+      envelope_.noteOff(0);
+    }
+  }
+}
+
+float EnvelopeGenerator::step() {
+  applyNotes();
+  envelope_.step();
+  return clampUnit(output());
+}
+
+void EnvelopeGenerator::update(void) {
+  if (external_clock_) {
+    return;
+  }
+  applyNotes();
+  if (!envelope_.active(0) && offset_ == 0.0f) {
+    return;
+  }
+  audio_block_t *block = allocate();
+  if (!block) {
+    return;
+  }
+
+  // Ramp linearly across each step, like the voice envelopes.
+  constexpr uint8_t kStep = Envelopes<1>::kStepSamples;
+  float level = clampUnit(output()) * kFullScale;
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i += kStep) {
+    envelope_.step();
+    const float next = clampUnit(output()) * kFullScale;
+    const float increment = (next - level) * (1.0f / kStep);
+    for (int j = 0; j < kStep; j++) {
+      block->data[i + j] = (int16_t)level;
+      level += increment;
+    }
+    level = next;
+  }
+
+  transmit(block);
+  release(block);
+}
+
+} // namespace Autosave
@@ -0,0 +1,78 @@
+#ifndef AUTOSAVE_ENVELOPE_GENERATOR_H
+#define AUTOSAVE_ENVELOPE_GENERATOR_H
+
+#include <AudioStream.h>
+#include <cstdint>
+
+#include "core/Envelopes.h"
+
+namespace Autosave {
+
+/**
+ * One ADSR envelope (see Envelopes) rendered as a signal, e.g. a control
+ * voltage: no input, the output is offset() plus the envelope level times
+ * amplitude(). It replaces a DC source feeding an AudioEffectEnvelope. Like
+ * the envelope effect, it transmits nothing while idle (at a zero offset).
+ *
+ * With an external clock (see CvOutput), update() leaves the envelope alone
+ * and transmits nothing; step() advances it instead, from a timer interrupt.
+ */
+class EnvelopeGenerator : public AudioStream {
+public:
+  EnvelopeGenerator() : AudioStream(0, nullptr) {}
+
+  /** Output level at the envelope's full scale, -1 to 1. */
+  void amplitude(float amplitude);
+  /** Output level while the envelope is at zero, -1 to 1. */
+  void offset(float offset);
+
+  void setExternalClock(bool enabled) { external_clock_ = enabled; }
+  /** Advance one envelope step; the new output level, -1 to 1. */
+  float step();
+
+  void attack(float milliseconds) { envelope_.attack(milliseconds); }
+  void hold(float milliseconds) { envelope_.hold(milliseconds); }
+  void decay(float milliseconds) { envelope_.decay(milliseconds); }
+  void sustain(float level) { envelope_.sustain(level); }
+  void release(float milliseconds) { envelope_.release(milliseconds); }
+  void releaseNoteOn(float milliseconds) {
+    envelope_.releaseNoteOn(milliseconds);
+  }
+  using AudioStream::release;
+
+  /**
+   * Call from the audio update only (Audio::applyCommand). Requests take
+   * effect at the next envelope step, in whichever context steps it, so the
+   * CvOutput timer never sees a half-started segment and nothing masks
+   * interrupts. Requests within one step collapse: the last note on wins,
+   * then a later note off.
+   */
+  void noteOn(float peak);
+  void noteOff();
+  bool active() const { return envelope_.active(0); }
+
+  virtual void update(void) override;
+
+private:
+  Envelopes<1> envelope_;
+  float amplitude_ = 0.0f;
+  float offset_ = 0.0f;
+  volatile bool external_clock_ = false;
+
+  // Written by noteOn()/noteOff() only; the peak before its sequence number.
+  volatile float note_peak_ = 0.0f;
+  volatile uint32_t note_on_sequence_ = 0;
+  volatile uint32_t note_off_sequence_ = 0;
+  uint32_t sequence_ = 0;
+  // Read and written by applyNotes() only.
+  uint32_t applied_on_ = 0;
+  uint32_t applied_off_ = 0;
+
+  /** Start or stop the segment as requested since the last call. */
+  void applyNotes();
+  float output() const { return offset_ + envelope_.level(0) * amplitude_; }
+};
+
+} // namespace Autosave
+
+#endif
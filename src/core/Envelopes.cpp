@@ -0,0 +1,244 @@
+#include "Envelopes.h"
+
+#include <AudioStream.h>
+#include <array>
+
+namespace {
+constexpr float kSamplesPerMillisecond = AUDIO_SAMPLE_RATE_EXACT / 1000.0f;
+
+// Same defaults as AudioEffectEnvelope.
+constexpr float kDefaultAttackMs = 10.5f;
+constexpr float kDefaultHoldMs = 2.5f;
+constexpr float kDefaultDecayMs = 35.0f;
+constexpr float kDefaultSustain = 0.5f;
+constexpr float kDefaultReleaseMs = 300.0f;
+constexpr float kDefaultReleaseNoteOnMs = 5.0f;
+
+// Segment curves: kCurvePoints + 1 points of a falling exponential from 1 to
+// 0. The attack curve is gentle (a capacitor charging towards a level past
+// the peak), decays and releases are steep, like an analog envelope.
+constexpr int kCurvePoints = 256;
+constexpr double kAttackSteepness = 1.5;
+constexpr double kFallSteepness = 5.0;
+
+// exp(x) at compile time, for the small negative x of the curves.
+constexpr double constexprExp(double x) {
+  double term = 1.0;
+  double sum = 1.0;
+  for (int k = 1; k < 60; k++) {
+    term *= x / k;
+    sum += term;
+  }
+  return sum;
+}
+
+// (e^(-k t) - e^(-k)) / (1 - e^(-k)) for t in [0, 1]: 1 at the start of the
+// segment, exactly 0 at its end.
+constexpr std::array<float, kCurvePoints + 1> curve(double steepness) {
+  std::array<float, kCurvePoints + 1> points{};
+  const double floor = constexprExp(-steepness);
+  for (int i = 0; i <= kCurvePoints; i++) {
+    const double t = (double)i / kCurvePoints;
+    points[i] =
+        (float)((constexprExp(-steepness * t) - floor) / (1.0 - floor));
+  }
+  return points;
+}
+
+constexpr std::array<float, kCurvePoints + 1> kAttackCurve =
+    curve(kAttackSteepness);
+constexpr std::array<float, kCurvePoints + 1> kFallCurve =
+    curve(kFallSteepness);
+
+inline float readCurve(const std::array<float, kCurvePoints + 1> &points,
+                       float position) {
+  const float index = position * kCurvePoints;
+  const int i = (int)index;
+  return points[i] + (points[i + 1] - points[i]) * (index - (float)i);
+}
+
+// Milliseconds to envelope steps, as AudioEffectEnvelope rounds them.
+uint16_t millisecondsToSteps(float milliseconds, bool at_least_one) {
+  if (milliseconds < 0.0f) {
+    milliseconds = 0.0f;
+  }
+  uint32_t steps =
+      ((uint32_t)(milliseconds * kSamplesPerMillisecond) + 7) >> 3;
+  if (steps > 65535) {
+    steps = 65535; // up to 11.88 seconds
+  }
+  if (at_least_one && steps == 0) {
+    steps = 1;
+  }
+  return steps;
+}
+} // namespace
+
+namespace Autosave {
+
+template <uint8_t N>
+Envelopes<N>::Envelopes() : sustain_(kDefaultSustain) {
+  for (uint8_t i = 0; i < N; i++) {
+    stage_[i] = STAGE_IDLE;
+    level_[i] = 0.0f;
+    remaining_[i] = 0;
+    position_step_[i] = 0.0f;
+    origin_[i] = 0.0f;
+    target_[i] = 0.0f;
+    peak_[i] = 1.0f;
+  }
+  attack(kDefaultAttackMs);
+  hold(kDefaultHoldMs);
+  decay(kDefaultDecayMs);
+  release(kDefaultReleaseMs);
+  releaseNoteOn(kDefaultReleaseNoteOnMs);
+}
+
+template <uint8_t N>
+void Envelopes<N>::attack(float milliseconds) {
+  attack_steps_ = millisecondsToSteps(milliseconds, true);
+}
+
+template <uint8_t N>
+void Envelopes<N>::hold(float milliseconds) {
+  hold_steps_ = millisecondsToSteps(milliseconds, false);
+}
+
+template <uint8_t N>
+void Envelopes<N>::decay(float milliseconds) {
+  decay_steps_ = millisecondsToSteps(milliseconds, true);
+}
+
+template <uint8_t N>
+void Envelopes<N>::sustain(float level) {
+  if (level < 0.0f) {
+    level = 0.0f;
+  } else if (level > 1.0f) {
+    level = 1.0f;
+  }
+  sustain_ = level;
+}
+
+template <uint8_t N>
+void Envelopes<N>::release(float milliseconds) {
+  release_steps_ = millisecondsToSteps(milliseconds, true);
+}
+
+template <uint8_t N>
+void Envelopes<N>::releaseNoteOn(float milliseconds) {
+  forced_steps_ = millisecondsToSteps(milliseconds, false);
+}
+
+template <uint8_t N>
+void Envelopes<N>::noteOn(uint8_t index, float peak) {
+  if (peak < 0.0f) {
+    peak = 0.0f;
+  } else if (peak > 1.0f) {
+    peak = 1.0f;
+  }
+  peak_[index] = peak;
+
+  if (stage_[index] == STAGE_IDLE || forced_steps_ == 0) {
+    enter(index, STAGE_ATTACK);
+  } else if (stage_[index] != STAGE_FORCED) {
+    // Fade out quickly before restarting, instead of jumping to zero.
+    enter(index, STAGE_FORCED);
+  }
+}
+
+template <uint8_t N>
+void Envelopes<N>::noteOff(uint8_t index) {
+  if (stage_[index] != STAGE_IDLE) {
+    enter(index, STAGE_RELEASE);
+  }
+}
+
+/** Start a segment from the current level. A zero-length hold is skipped. */
+template <uint8_t N>
+void Envelopes<N>::enter(uint8_t index, Stage stage) {
+  uint16_t steps = 0;
+  float target = 0.0f;
+  switch (stage) {
+  case STAGE_ATTACK:
+    steps = attack_steps_;
+    target = peak_[index];
+    break;
+  case STAGE_HOLD:
+    if (hold_steps_ == 0) {
+      enter(index, STAGE_DECAY);
+      return;
+    }
+    steps = hold_steps_;
+    target = peak_[index];
+    break;
+  case STAGE_DECAY:
+    steps = decay_steps_;
+    target = sustain_ * peak_[index];
+    break;
+  case STAGE_RELEASE:
+    steps = release_steps_;
+    break;
+  case STAGE_FORCED:
+    steps = forced_steps_;
+    break;
+  case STAGE_IDLE:
+  case STAGE_SUSTAIN:
+    break;
+  }
+
+  stage_[index] = stage;
+  origin_[index] = level_[index];
+  target_[index] = target;
+  remaining_[index] = steps > 0 ? steps : 1;
+  position_step_[index] = 1.0f / remaining_[index];
+}
+
+template <uint8_t N>
+void Envelopes<N>::step() {
+  for (uint8_t i = 0; i < N; i++) {
+    const Stage stage = stage_[i];
+    if (stage == STAGE_IDLE) {
+      continue;
+    }
+    if (stage == STAGE_SUSTAIN) {
+      level_[i] = sustain_ * peak_[i];
+      continue;
+    }
+
+    if (--remaining_[i] > 0) {
+      const float position = 1.0f - remaining_[i] * position_step_[i];
+      const float shape = stage == STAGE_ATTACK
+                              ? readCurve(kAttackCurve, position)
+                              : readCurve(kFallCurve, position);
+      level_[i] = target_[i] + (origin_[i] - target_[i]) * shape;
+      continue;
+    }
+
+    // Segment done: land on its target and start the next one.
+    level_[i] = target_[i];
+    switch (stage) {
+    case STAGE_ATTACK:
+      enter(i, STAGE_HOLD);
+      break;
+    case STAGE_HOLD:
+      enter(i, STAGE_DECAY);
+      break;
+    case STAGE_DECAY:
+      stage_[i] = STAGE_SUSTAIN;
+      break;
+    case STAGE_RELEASE:
+      stage_[i] = STAGE_IDLE;
+      break;
+    case STAGE_FORCED:
+      enter(i, STAGE_ATTACK);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+template class Envelopes<audio_config::voices_number>;
+template class Envelopes<1>;
+
+} // namespace Autosave
@@ -0,0 +1,88 @@
+#ifndef AUTOSAVE_ENVELOPES_H
+#define AUTOSAVE_ENVELOPES_H
+
+#include <cstdint>
+
+#include "core/AudioConfig.h"
+
+namespace Autosave {
+
+/**
+ * N ADSR envelopes that share their settings, advanced together in steps of
+ * kStepSamples samples (the AudioEffectEnvelope timing model, same
+ * millisecond settings).
+ *
+ * - attack: rises to the note's peak level (velocity) on an RC-like curve,
+ *   from the current level, so a retrigger without fade never clicks
+ * - hold: stays at the peak
+ * - decay: falls exponentially to sustain * peak
+ * - sustain: follows the sustain setting while the note is held
+ * - release: falls exponentially to silence
+ *
+ * Segments have a fixed length and end exactly on their target: the curve
+ * is read from a precomputed table, indexed by the position in the segment.
+ * State is kept as one array per field, so step() is a single pass over all
+ * envelopes.
+ *
+ * Envelopes.cpp instantiates it for audio_config::voices_number (the voice
+ * bank) and 1 (the filter envelope).
+ */
+template <uint8_t N> class Envelopes {
+public:
+  static constexpr uint8_t kStepSamples = 8;
+
+  Envelopes();
+
+  void attack(float milliseconds);
+  void hold(float milliseconds);
+  void decay(float milliseconds);
+  /** Fraction of the peak level held after the decay, for every envelope. */
+  void sustain(float level);
+  void release(float milliseconds);
+  /** Fade time when a note restarts an envelope that is still sounding. */
+  void releaseNoteOn(float milliseconds);
+
+  /** Start the attack towards `peak` (0 to 1). */
+  void noteOn(uint8_t index, float peak);
+  void noteOff(uint8_t index);
+
+  /** True until the release has finished. */
+  bool active(uint8_t index) const { return stage_[index] != STAGE_IDLE; }
+  /** Level at the end of the last step, 0 to 1. */
+  float level(uint8_t index) const { return level_[index]; }
+
+  /** Advance every envelope by one step. */
+  void step();
+
+private:
+  enum Stage : uint8_t {
+    STAGE_IDLE,
+    STAGE_ATTACK,
+    STAGE_HOLD,
+    STAGE_DECAY,
+    STAGE_SUSTAIN,
+    STAGE_RELEASE,
+    STAGE_FORCED, // fade out, then attack
+  };
+
+  uint16_t attack_steps_;
+  uint16_t hold_steps_;
+  uint16_t decay_steps_;
+  uint16_t release_steps_;
+  uint16_t forced_steps_;
+  float sustain_;
+
+  Stage stage_[N];
+  float level_[N];
+  uint16_t remaining_[N];  // steps left in the segment
+  float position_step_[N]; // 1 / segment length in steps
+  float origin_[N];        // level at the start of the segment
+  float target_[N];        // level at the end of the segment
+  float peak_[N];
+
+  void enter(uint8_t index, Stage stage);
+};
+
+} // namespace Autosave
+
+#endif
@@ -1,60 +1,157 @@
 #include "Hardware.h"
 #include "lib/Logger.h"
 
+namespace {
+using namespace Autosave::hardware;
+using Autosave::AnalogScanner;
+
+enum ControlType : uint8_t { CONTROL_SWITCH, CONTROL_POT };
+
+struct ControlSpec {
+  ControlType type;
+  uint8_t input; // switch: first bit in kSwitchPins; pot: scanner channel
+  uint8_t pins;  // switch: 1 or 2 consecutive bits
+};
+
+// The pots are filtered as 10-bit readings (ResponsiveAnalogRead's default
+// resolution); the scanner reads at 12 bits for the pitch CV.
+constexpr float kPotReadingScale =
+    1.0f / (1u << (AnalogScanner::kResolutionBits - 10));
+
+// Switch pins, in bit order of the debounced masks.
+constexpr uint8_t kSwitchPins[] = {PIN_SW_1_1, PIN_SW_1_3, PIN_SW_2_1,
+                                   PIN_SW_2_3, PIN_SW_3_1, PIN_SW_3_3,
+                                   PIN_SW_4_1};
+
+constexpr ControlSpec kControls[CTRL_COUNT] = {
+    {CONTROL_SWITCH, 0, 2},                           // CTRL_SWITCH_MODE
+    {CONTROL_SWITCH, 2, 2},                           // CTRL_SWITCH_1
+    {CONTROL_SWITCH, 4, 2},                           // CTRL_SWITCH_2
+    {CONTROL_SWITCH, 6, 1},                           // CTRL_SWITCH_3
+    {CONTROL_POT, AnalogScanner::CH_POT_1, 0},       // CTRL_POT_1
+    {CONTROL_POT, AnalogScanner::CH_POT_2, 0},       // CTRL_POT_2
+    {CONTROL_POT, AnalogScanner::CH_POT_3, 0},       // CTRL_POT_3
+    {CONTROL_POT, AnalogScanner::CH_POT_ATTACK, 0},  // CTRL_POT_ATTACK
+    {CONTROL_POT, AnalogScanner::CH_POT_RELEASE, 0}, // CTRL_POT_RELEASE
+};
+
+constexpr uint8_t switchMask(const ControlSpec &spec) {
+  return (uint8_t)(((1u << spec.pins) - 1) << spec.input);
+}
+} // namespace
+
 namespace Autosave {
 
+
 Hardware::Hardware() {}
 
 void Hardware::begin() {
   AutosaveLib::Logger::info("Initializing Hardware module");
 
   // Initialize switches
-  controls[hardware::controls::CTRL_SWITCH_MODE] = new SwitchControl();
-  ((SwitchControl*)controls[hardware::controls::CTRL_SWITCH_MODE])->begin(hardware::pins::PIN_SW_1_1, hardware::pins::PIN_SW_1_3);
-  controls[hardware::controls::CTRL_SWITCH_1] = new SwitchControl();
-  ((SwitchControl*)controls[hardware::controls::CTRL_SWITCH_1])->begin(hardware::pins::PIN_SW_2_1, hardware::pins::PIN_SW_2_3);
-  controls[hardware::controls::CTRL_SWITCH_2] = new SwitchControl();
-  ((SwitchControl*)controls[hardware::controls::CTRL_SWITCH_2])->begin(hardware::pins::PIN_SW_3_1, hardware::pins::PIN_SW_3_3);
-  controls[hardware::controls::CTRL_SWITCH_3] = new SwitchControl();
-  controls[hardware::controls::CTRL_SWITCH_3]->begin(hardware::pins::PIN_SW_4_1);
+  static_assert(sizeof(kSwitchPins) == kSwitchPinCount,
+                "one debounce bit per switch pin");
+  for (uint8_t pin : kSwitchPins) {
+    pinMode(pin, INPUT_PULLUP);
+  }
+  switch_unstable_ = switch_debounced_ = readSwitchPins();
+  for (uint8_t i = 0; i < kSwitchPinCount; i++) {
+    switch_since_ms_[i] = millis();
+  }
+
+  // Sample the pots and the CV from now on
+  scanner_.begin();
 
   // Initialize pots
-  controls[hardware::controls::CTRL_POT_1] = new AnalogControl();
-  controls[hardware::controls::CTRL_POT_1]->begin(hardware::pins::PIN_POT_1);
-  controls[hardware::controls::CTRL_POT_2] = new AnalogControl();
-  controls[hardware::controls::CTRL_POT_2]->begin(hardware::pins::PIN_POT_2);
-  controls[hardware::controls::CTRL_POT_3] = new AnalogControl();
-  controls[hardware::controls::CTRL_POT_3]->begin(hardware::pins::PIN_POT_3);
-  controls[hardware::controls::CTRL_POT_ATTACK] = new AnalogControl();
-  controls[hardware::controls::CTRL_POT_ATTACK]->begin(hardware::pins::PIN_POT_ATTACK);
-  controls[hardware::controls::CTRL_POT_RELEASE] = new AnalogControl();
-  controls[hardware::controls::CTRL_POT_RELEASE]->begin(hardware::pins::PIN_POT_RELEASE);
-
-  // Initialize CV
-  controls[hardware::controls::CTRL_CV] = new AnalogControl();
-  controls[hardware::controls::CTRL_CV]->begin(hardware::pins::PIN_CV);
+  for (uint8_t i = 0; i < kPots; i++) {
+    pots_[i].begin(AnalogScanner::pin(static_cast<AnalogScanner::Channel>(i)),
+                   true, defaults::snap_multiplier);
+  }
+
+  for (uint8_t c = 0; c < hardware::CTRL_COUNT; c++) {
+    values_[c] = kControls[c].type == CONTROL_SWITCH
+                     ? switchValue(static_cast<hardware::controls>(c))
+                     : 0.0f;
+  }
+  changed_ = 0;
 }
 
 void Hardware::update() {
-  for (uint8_t i = 0; i < sizeof(controls) / sizeof(controls[0]); i++) {
-    controls[i]->update();
+  const uint8_t toggled = debounceSwitches(readSwitchPins(), millis());
+  const uint32_t frame = scanner_.frame();
+  const bool new_frame = frame != frame_;
+  frame_ = frame;
+
+  uint16_t changed = 0;
+  if (toggled != 0 || new_frame) {
+    for (uint8_t c = 0; c < hardware::CTRL_COUNT; c++) {
+      const ControlSpec &spec = kControls[c];
+      if (spec.type == CONTROL_SWITCH) {
+        if (toggled & switchMask(spec)) {
+          values_[c] = switchValue(static_cast<hardware::controls>(c));
+          changed |= 1u << c;
+        }
+      } else if (new_frame) {
+        ResponsiveAnalogRead &pot = pots_[spec.input];
+        const float reading =
+            scanner_.mean(static_cast<AnalogScanner::Channel>(spec.input));
+        pot.update((int)(reading * kPotReadingScale + 0.5f));
+        if (pot.hasChanged()) {
+          values_[c] = pot.getValue() / 1023.0f;
+          changed |= 1u << c;
+        }
+      }
+    }
   }
+  changed_ = changed;
+}
 
-  // @TODO: Implement CV input
-// #ifdef DEBUG
-//   if ((controls[hardware::controls::CTRL_CV])->changed()) {
-//     Serial.println("CV:");
-//     Serial.println((controls[hardware::controls::CTRL_CV])->read());
-//   }
-// #endif
+uint8_t Hardware::readSwitchPins() const {
+  uint8_t levels = 0;
+  for (uint8_t i = 0; i < kSwitchPinCount; i++) {
+    levels |= (digitalRead(kSwitchPins[i]) == HIGH ? 1u : 0u) << i;
+  }
+  return levels;
 }
 
-bool Hardware::changed(hardware::controls control) {
-  return controls[control]->changed();
+/**
+ * Bounce2's stable interval, for every pin at once: a pin's debounced level
+ * follows its raw level once that has held for bounce_interval ms. Returns
+ * the pins whose debounced level changed.
+ */
+uint8_t Hardware::debounceSwitches(uint8_t levels, uint32_t now) {
+  const uint8_t moved = levels ^ switch_unstable_;
+  const uint8_t pending = levels ^ switch_debounced_;
+  switch_unstable_ = levels;
+  if ((moved | pending) == 0) {
+    return 0;
+  }
+
+  uint8_t toggled = 0;
+  for (uint8_t i = 0; i < kSwitchPinCount; i++) {
+    const uint8_t bit = 1u << i;
+    if (moved & bit) {
+      switch_since_ms_[i] = now;
+    } else if ((pending & bit) &&
+               now - switch_since_ms_[i] >= defaults::bounce_interval) {
+      switch_since_ms_[i] = now;
+      toggled |= bit;
+    }
+  }
+  switch_debounced_ ^= toggled;
+  return toggled;
 }
 
-float Hardware::read(hardware::controls control) {
-  return controls[control]->read();
+/** Pin 1 low: 0; pin 2 (if any) low: 2; else 1. */
+float Hardware::switchValue(hardware::controls control) const {
+  const ControlSpec &spec = kControls[control];
+  if ((switch_debounced_ & (1u << spec.input)) == 0) {
+    return 0.0f;
+  }
+  if (spec.pins == 2 && (switch_debounced_ & (1u << (spec.input + 1))) == 0) {
+    return 2.0f;
+  }
+  return 1.0f;
 }
 
-} // namespace Autosave
\ No newline at end of file
+} // namespace Autosave
@@ -1,14 +1,18 @@
 #ifndef AUTOSAVE_HARDWARE_H
 #define AUTOSAVE_HARDWARE_H
 
-#include <Bounce2.h>
+#include <Arduino.h>
 #include <ResponsiveAnalogRead.h>
 
+#include "core/AnalogScanner.h"
+
 namespace Autosave {
 
 namespace defaults {
 static constexpr uint8_t bounce_interval = 100;
-static constexpr float snap_multiplier = 0.001f;
+// Pots are filtered once per scanner frame (about 345 Hz), on means of 3 or
+// 4 reads.
+static constexpr float snap_multiplier = 0.01f;
 } // namespace defaults
 
 namespace hardware {
@@ -25,7 +29,8 @@ enum pins {
   PIN_POT_3 = A2,
   PIN_POT_ATTACK = A3,
   PIN_POT_RELEASE = A4,
-  PIN_CV = A5,
+  PIN_CV = A5, // pitch CV input (see PitchCvInput)
+  PIN_CV_OUT = 22, // filter envelope CV with AUTOSAVE_CV_PWM (see CvOutput)
 };
 
 enum controls {
@@ -38,90 +43,66 @@ enum controls {
   CTRL_POT_3 = 6,
   CTRL_POT_ATTACK = 7,
   CTRL_POT_RELEASE = 8,
-  CTRL_CV = 9
-};
-} // namespace hardware
-
-class HardwareControl {
-public:
-  virtual ~HardwareControl() {}
-
-  virtual void begin(uint8_t pin) = 0;
-  virtual void update() = 0;
-  virtual bool changed() = 0;
-  virtual float read() = 0;
+  CTRL_COUNT = 9
 };
+static_assert(CTRL_COUNT <= 16, "changed masks are 16-bit");
 
-class SwitchControl : public HardwareControl {
-private:
-  Bounce bounce[2];
-  bool has_two_pins = false;
+/** Bit of a control in Hardware::changedMask(). */
+constexpr uint16_t controlBit(controls control) {
+  return (uint16_t)(1u << control);
+}
+} // namespace hardware
 
+/**
+ * Front panel controls, scanned from one static table: every update() reads
+ * all of them and produces a changed mask (one bit per control, see
+ * hardware::controlBit()) and a packed array of values, so a state tests a
+ * single word to know whether anything moved.
+ *
+ * - switches: the pins of every switch are debounced together as a bit mask
+ *   (stable interval: a pin must hold for bounce_interval ms); values are
+ *   0 or 1 for one pin, 0, 1 or 2 for two
+ * - pots: filtered once per AnalogScanner frame (ResponsiveAnalogRead over
+ *   the frame's mean reading); values are 0 to 1
+ */
+class Hardware {
 public:
-  void begin(uint8_t pin) {
-    bounce[0].attach(pin, INPUT_PULLUP);
-    bounce[0].interval(defaults::bounce_interval);
-  }
-
-  void begin(uint8_t pin_1, uint8_t pin_2) {
-    has_two_pins = true;
-
-    bounce[0].attach(pin_1, INPUT_PULLUP);
-    bounce[0].interval(defaults::bounce_interval);
-    bounce[1].attach(pin_2, INPUT_PULLUP);
-    bounce[1].interval(defaults::bounce_interval);
-  }
-
-  void update() {
-    bounce[0].update();
-
-    if (has_two_pins) {
-      bounce[1].update();
-    }
-  }
+  Hardware();
 
-  bool changed() {
-    return bounce[0].changed() || (has_two_pins && bounce[1].changed());
-  }
+  void begin();
+  /** Every analog input, the CV included (see PitchCvInput). */
+  const AnalogScanner &scanner() const { return scanner_; }
 
-  float read() {
-    if (bounce[0].read() == LOW) {
-      return 0.0f;
-    }
+  /** Scan every control once. */
+  void update();
 
-    if (has_two_pins && bounce[1].read() == LOW) {
-      return 2.0f;
-    }
+  /** Controls that changed in the last update(). */
+  uint16_t changedMask() const { return changed_; }
+  const float *values() const { return values_; }
 
-    return 1.0f;
+  bool changed(hardware::controls control) const {
+    return (changed_ & hardware::controlBit(control)) != 0;
   }
-};
+  float read(hardware::controls control) const { return values_[control]; }
 
-class AnalogControl : public HardwareControl {
 private:
-  ResponsiveAnalogRead pot;
-
-public:
-  void begin(uint8_t pin) { pot.begin(pin, true, defaults::snap_multiplier); }
-
-  void update() { pot.update(); }
+  static constexpr uint8_t kSwitchPinCount = 7;
+  static constexpr uint8_t kPots = AnalogScanner::CH_CV;
 
-  bool changed() { return pot.hasChanged(); }
+  AnalogScanner scanner_;
+  ResponsiveAnalogRead pots_[kPots];
+  uint32_t frame_ = 0; // last scanner frame the pots were filtered on
 
-  float read() { return pot.getValue() / 1023.0f; }
-};
-
-class Hardware {
-private:
-  HardwareControl *controls[10];
+  uint8_t switch_unstable_ = 0;  // raw pin levels, one bit per switch pin
+  uint8_t switch_debounced_ = 0; // debounced pin levels
+  uint32_t switch_since_ms_[kSwitchPinCount];
 
-public:
-  Hardware();
+  uint16_t changed_ = 0;
+  float values_[hardware::CTRL_COUNT];
 
-  void begin();
-  void update();
-  bool changed(hardware::controls control);
-  float read(hardware::controls control);
+  uint8_t readSwitchPins() const;
+  uint8_t debounceSwitches(uint8_t levels, uint32_t now);
+  float switchValue(hardware::controls control) const;
 };
 
 } // namespace Autosave
@@ -0,0 +1,69 @@
+#include "LoopProfiler.h"
+
+#include <Arduino.h>
+#include <algorithm>
+
+namespace {
+constexpr const char *kStageNames[] = {"midi", "hardware", "mode", "state"};
+constexpr uint32_t kLoopRateIntervalMs = 1000;
+} // namespace
+
+namespace Autosave {
+
+const char *LoopProfiler::stageName(Stage stage) {
+  return stage < STAGE_COUNT ? kStageNames[stage] : "?";
+}
+
+#ifdef AUTOSAVE_PROFILE
+
+void LoopProfiler::begin() {
+  uint32_t now = millis();
+  if (now - second_start_ms_ >= kLoopRateIntervalMs) {
+    loops_per_second_ = loops_ * 1000 / (now - second_start_ms_);
+    loops_ = 0;
+    second_start_ms_ = now;
+  }
+  loops_++;
+  last_mark_ = ARM_DWT_CYCCNT;
+}
+
+void LoopProfiler::mark(Stage stage) {
+  uint32_t now = ARM_DWT_CYCCNT;
+  samples_[stage][heads_[stage]] = now - last_mark_;
+  heads_[stage] = (heads_[stage] + 1) % kSamples;
+  if (filled_[stage] < kSamples) {
+    filled_[stage]++;
+  }
+  last_mark_ = now;
+}
+
+void LoopProfiler::report(Report *out) const {
+  out->stage_count = STAGE_COUNT;
+  out->loops_per_second = loops_per_second_;
+
+  uint32_t sorted[kSamples];
+  for (uint8_t stage = 0; stage < STAGE_COUNT; stage++) {
+    StageStats &stats = out->stages[stage];
+    const uint16_t filled = filled_[stage];
+    if (filled == 0) {
+      stats = {0, 0, 0, 0};
+      continue;
+    }
+
+    uint64_t sum = 0;
+    for (uint16_t i = 0; i < filled; i++) {
+      sorted[i] = samples_[stage][i];
+      sum += sorted[i];
+    }
+    std::sort(sorted, sorted + filled);
+
+    stats.min = sorted[0];
+    stats.avg = sum / filled;
+    stats.max = sorted[filled - 1];
+    stats.p99 = sorted[(filled * 99) / 100];
+  }
+}
+
+#endif
+
+} // namespace Autosave
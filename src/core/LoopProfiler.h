@@ -0,0 +1,76 @@
+#ifndef AUTOSAVE_LOOP_PROFILER_H
+#define AUTOSAVE_LOOP_PROFILER_H
+
+#include <cstdint>
+
+namespace Autosave {
+
+/**
+ * Cycle counts of each stage of Synth::process over the stage's last kSamples
+ * runs (one ring buffer per stage), and loop iterations per second. A stage
+ * only records when it runs, so the controls stages, which run on some
+ * iterations only (see Scheduler), keep as many samples as the MIDI stage.
+ *
+ * Only compiled in with -DAUTOSAVE_PROFILE: otherwise every method is an
+ * empty inline function and report() says there is nothing to report.
+ */
+class LoopProfiler {
+public:
+  enum Stage : uint8_t {
+    STAGE_MIDI = 0,
+    STAGE_HARDWARE,
+    STAGE_MODE,
+    STAGE_STATE,
+    STAGE_COUNT,
+  };
+
+  /** ARM_DWT_CYCCNT cycles per loop iteration. */
+  struct StageStats {
+    uint32_t min;
+    uint32_t avg;
+    uint32_t max;
+    uint32_t p99;
+  };
+
+  struct Report {
+    uint8_t stage_count; // 0 when the profiler is compiled out
+    uint32_t loops_per_second;
+    StageStats stages[STAGE_COUNT];
+  };
+
+  static constexpr uint16_t kSamples = 256;
+
+  static const char *stageName(Stage stage);
+
+#ifdef AUTOSAVE_PROFILE
+  /** Start of a loop iteration. */
+  void begin();
+  /** End of `stage`, which started at the previous mark (or begin). */
+  void mark(Stage stage);
+
+  /** Sorts a copy of the samples: call outside time-critical code. */
+  void report(Report *out) const;
+
+private:
+  uint32_t samples_[STAGE_COUNT][kSamples];
+  uint16_t heads_[STAGE_COUNT] = {};
+  uint16_t filled_[STAGE_COUNT] = {};
+  uint32_t last_mark_ = 0;
+
+  uint32_t loops_ = 0;
+  uint32_t loops_per_second_ = 0;
+  uint32_t second_start_ms_ = 0;
+#else
+  void begin() {}
+  void mark(Stage) {}
+
+  void report(Report *out) const {
+    out->stage_count = 0;
+    out->loops_per_second = 0;
+  }
+#endif
+};
+
+} // namespace Autosave
+
+#endif
@@ -2,32 +2,24 @@
 
 #include "Midi.h"
 #include "core/EepromStorage.h"
+#include "core/NoteLatency.h"
 #include "lib/Logger.h"
 
-#include <cstring>
-
 namespace {
-// SysEx: "set MIDI channel" F0 7D 00 01 nn F7 (nn = 0..15 → channel 1..16)
-// SysEx: "get channel" request F0 7D 00 03 F7 (5 bytes); reply F0 7D 00 02 nn F7
-constexpr uint8_t kSysexSetChannelCommand[] = {0x7D, 0x00, 0x01};
-constexpr unsigned kSysexSetChannelSize = 4;
-constexpr unsigned kSysexSetChannelSizeFull = 6;
-constexpr unsigned kSysexGetChannelSize = 5;
-constexpr uint8_t kSysexGetChannelCommand[] = {0xF0, 0x7D, 0x00, 0x03, 0xF7};
-// SysEx arp steps: get F0 7D 00 04 F7; reply F0 7D 00 05 [len0][8][len1][8][len2][8] F7; set F0 7D 00 06 [mode][len][0..8 bytes] F7
-constexpr uint8_t kSysexArpGetCmd = 0x04;
-constexpr uint8_t kSysexArpReplyCmd = 0x05;
-constexpr uint8_t kSysexArpSetCmd = 0x06;
-constexpr unsigned kSysexArpGetSize = 5;
-constexpr unsigned kSysexArpReplySize = 4 + 3 * (1 + 8) + 1;  // 32
-constexpr unsigned kSysexArpMaxSteps = 8;
-// SysEx custom waveform: get F0 7D 00 07 F7; reply F0 7D 00 08 bank index F7; set F0 7D 00 09 bank index F7
-constexpr uint8_t kSysexCustomWaveformGetCmd = 0x07;
-constexpr uint8_t kSysexCustomWaveformReplyCmd = 0x08;
-constexpr uint8_t kSysexCustomWaveformSetCmd = 0x09;
-constexpr unsigned kSysexCustomWaveformGetSize = 5;
-constexpr unsigned kSysexCustomWaveformReplySize = 7;
-constexpr unsigned kSysexCustomWaveformSetSize = 7;
+namespace sysex = AutosaveLib::sysex;
+
+static_assert(sysex::kLatencyStages == Autosave::NoteLatency::STAGE_COUNT &&
+                  sysex::kLatencyBins == Autosave::NoteLatency::kBins,
+              "latency reply layout");
+static_assert(sysex::kProfileStagesMax >=
+                  Autosave::LoopProfiler::STAGE_COUNT,
+              "profile reply layout");
+static_assert(sysex::kArpMaxSteps ==
+                  Autosave::EepromStorage::kMaxArpSteps,
+              "arp steps reply layout");
+
+constexpr unsigned kReplyMaxSize =
+    sysex::kHeaderSize + sysex::kLatencyReplyPayload + 1;
 } // namespace
 
 namespace Autosave {
@@ -40,7 +32,22 @@ Midi *Midi::instance_ = nullptr;
 Midi::Midi() {
   instance_ = this;
 
+  usbMIDI.setHandleNoteOn(&Midi::queueNoteOn);
+  usbMIDI.setHandleNoteOff(&Midi::queueNoteOff);
+  usbMIDI.setHandleControlChange(&Midi::queueControlChange);
+  usbMIDI.setHandleClock(&Midi::queueClock);
+  usbMIDI.setHandleStart(&Midi::queueStart);
+  usbMIDI.setHandleContinue(&Midi::queueContinue);
+  usbMIDI.setHandleStop(&Midi::queueStop);
   usbMIDI.setHandleSystemExclusive(&Midi::handleSysEx);
+
+  MIDI.setHandleNoteOn(&Midi::queueNoteOn);
+  MIDI.setHandleNoteOff(&Midi::queueNoteOff);
+  MIDI.setHandleControlChange(&Midi::queueControlChange);
+  MIDI.setHandleClock(&Midi::queueClock);
+  MIDI.setHandleStart(&Midi::queueStart);
+  MIDI.setHandleContinue(&Midi::queueContinue);
+  MIDI.setHandleStop(&Midi::queueStop);
   MIDI.setHandleSystemExclusive(&Midi::handleSysEx);
 }
 
@@ -54,154 +61,325 @@ void Midi::begin() {
 
 void Midi::setHandleNoteOn(void (*callback)(uint8_t channel, uint8_t note,
                                             uint8_t velocity)) {
-  usbMIDI.setHandleNoteOn(callback);
-  MIDI.setHandleNoteOn(callback);
+  note_on_ = callback;
 }
 
 void Midi::setHandleNoteOff(void (*callback)(uint8_t channel, uint8_t note,
                                              uint8_t velocity)) {
-  usbMIDI.setHandleNoteOff(callback);
-  MIDI.setHandleNoteOff(callback);
+  note_off_ = callback;
 }
 
-void Midi::setHandleClock(void (*callback)(void)) {
-  usbMIDI.setHandleClock(callback);
-  MIDI.setHandleClock(callback);
+void Midi::setHandleControlChange(void (*callback)(uint8_t channel,
+                                                   uint8_t control,
+                                                   uint8_t value)) {
+  control_change_ = callback;
 }
 
-void Midi::setHandleStart(void (*callback)(void)) {
-  usbMIDI.setHandleStart(callback);
-  MIDI.setHandleStart(callback);
+void Midi::setHandleClock(void (*callback)(void)) { clock_ = callback; }
+
+void Midi::setHandleStart(void (*callback)(void)) { start_ = callback; }
+
+void Midi::setHandleContinue(void (*callback)(void)) { continue_ = callback; }
+
+void Midi::setHandleStop(void (*callback)(void)) { stop_ = callback; }
+
+constexpr std::array<Midi::SysexHandler, sysex::CMD_COUNT>
+Midi::sysexHandlers() {
+  std::array<SysexHandler, sysex::CMD_COUNT> handlers{};
+  handlers[sysex::CMD_SET_CHANNEL] = &Midi::sysexSetChannel;
+  handlers[sysex::CMD_GET_CHANNEL] = &Midi::sysexGetChannel;
+  handlers[sysex::CMD_GET_ARP_STEPS] = &Midi::sysexGetArpSteps;
+  handlers[sysex::CMD_SET_ARP_STEPS] = &Midi::sysexSetArpSteps;
+  handlers[sysex::CMD_GET_CUSTOM_WAVEFORM] = &Midi::sysexGetCustomWaveform;
+  handlers[sysex::CMD_SET_CUSTOM_WAVEFORM] = &Midi::sysexSetCustomWaveform;
+  handlers[sysex::CMD_GET_VOICE_POLICY] = &Midi::sysexGetVoicePolicy;
+  handlers[sysex::CMD_SET_VOICE_POLICY] = &Midi::sysexSetVoicePolicy;
+  handlers[sysex::CMD_GET_LATENCY] = &Midi::sysexGetLatency;
+  handlers[sysex::CMD_RESET_LATENCY] = &Midi::sysexResetLatency;
+  handlers[sysex::CMD_GET_PROFILE] = &Midi::sysexGetProfile;
+  handlers[sysex::CMD_GET_VERSION] = &Midi::sysexGetVersion;
+  handlers[sysex::CMD_GET_PATCH] = &Midi::sysexGetPatch;
+  handlers[sysex::CMD_PATCH_DUMP] = &Midi::sysexLoadPatch;
+  return handlers;
 }
 
-void Midi::setHandleContinue(void (*callback)(void)) {
-  usbMIDI.setHandleContinue(callback);
-  MIDI.setHandleContinue(callback);
-}
-
-void Midi::setHandleStop(void (*callback)(void)) {
-  usbMIDI.setHandleStop(callback);
-  MIDI.setHandleStop(callback);
-}
+const std::array<Midi::SysexHandler, sysex::CMD_COUNT> Midi::kSysexHandlers =
+    Midi::sysexHandlers();
 
 void Midi::handleSysEx(uint8_t *array, unsigned size) {
-  if (instance_ == nullptr || array == nullptr) {
+  sysex::Message message;
+  if (instance_ == nullptr || !sysex::parse(array, size, &message)) {
     return;
   }
 
-  // Get channel request: F0 7D 00 03 F7
-  if (size == kSysexGetChannelSize &&
-      memcmp(array, kSysexGetChannelCommand, kSysexGetChannelSize) == 0) {
-    uint8_t ch = instance_->getChannel();
-    if (ch < 1 || ch > 16)
-      ch = 1;
-    uint8_t nn = static_cast<uint8_t>(ch - 1);
-    const uint8_t reply[] = {0xF0, 0x7D, 0x00, 0x02, nn, 0xF7};
-    instance_->sendSysEx(reply, sizeof(reply));
+  const SysexHandler handler = message.command < sysex::CMD_COUNT
+                                   ? kSysexHandlers[message.command]
+                                   : nullptr;
+  const sysex::MessageSpec *spec = sysex::messageSpec(message.command);
+  if (handler == nullptr || spec == nullptr) {
+    instance_->sendSysexError(message.command, sysex::ERROR_UNKNOWN_COMMAND);
     return;
   }
-
-  // Get arp steps: F0 7D 00 04 F7
-  if (size == kSysexArpGetSize && array[0] == 0xF0 &&
-      array[1] == 0x7D && array[2] == 0x00 && array[3] == kSysexArpGetCmd &&
-      array[4] == 0xF7 && instance_->arp_steps_getter_ != nullptr) {
-    uint8_t reply[kSysexArpReplySize];
-    reply[0] = 0xF0;
-    reply[1] = 0x7D;
-    reply[2] = 0x00;
-    reply[3] = kSysexArpReplyCmd;
-    int off = 4;
-    for (uint8_t mode = 0; mode < 3; mode++) {
-      uint8_t len = 0;
-      uint8_t data[kSysexArpMaxSteps] = {0};
-      instance_->arp_steps_getter_(mode, &len, data);
-      if (len > kSysexArpMaxSteps) {
-        len = kSysexArpMaxSteps;
-      }
-      reply[off++] = len;
-      for (uint8_t i = 0; i < kSysexArpMaxSteps; i++) {
-        reply[off++] = i < len ? data[i] : 0;
-      }
-    }
-    reply[off] = 0xF7;
-    instance_->sendSysEx(reply, sizeof(reply));
+  if (!sysex::validLength(*spec, message.payload_size)) {
+    instance_->sendSysexError(message.command, sysex::ERROR_BAD_LENGTH);
     return;
   }
 
-  // Set arp steps: F0 7D 00 06 [mode][len][0..8 bytes] F7
-  if (size >= 8 && size <= 16 && array[0] == 0xF0 && array[1] == 0x7D &&
-      array[2] == 0x00 && array[3] == kSysexArpSetCmd &&
-      instance_->arp_steps_setter_ != nullptr) {
-    uint8_t mode = array[4];
-    uint8_t len = array[5];
-    if (mode > 2 || len > kSysexArpMaxSteps ||
-        size != (unsigned)(7 + len)) {
-      return;
+  const SysexError error =
+      handler(*instance_, message.payload, message.payload_size);
+  if (error != sysex::ERROR_NONE) {
+    instance_->sendSysexError(message.command, error);
+  }
+}
+
+// Set channel: [nn], channel nn + 1
+Midi::SysexError Midi::sysexSetChannel(Midi &midi, const uint8_t *payload,
+                                       unsigned size) {
+  if (payload[0] > 15) {
+    return sysex::ERROR_BAD_VALUE;
+  }
+  midi.setChannel(payload[0] + 1);
+  return sysex::ERROR_NONE;
+}
+
+Midi::SysexError Midi::sysexGetChannel(Midi &midi, const uint8_t *payload,
+                                       unsigned size) {
+  uint8_t channel = midi.getChannel();
+  if (channel < 1 || channel > 16) {
+    channel = 1;
+  }
+  uint8_t reply[sysex::kHeaderSize + 2];
+  uint8_t *out = sysex::putHeader(reply, sysex::CMD_CHANNEL_REPLY);
+  *out++ = channel - 1;
+  *out++ = sysex::kEnd;
+  midi.sendSysEx(reply, out - reply);
+  return sysex::ERROR_NONE;
+}
+
+Midi::SysexError Midi::sysexGetArpSteps(Midi &midi, const uint8_t *payload,
+                                        unsigned size) {
+  if (midi.arp_steps_getter_ == nullptr) {
+    return sysex::ERROR_UNAVAILABLE;
+  }
+
+  uint8_t reply[sysex::kHeaderSize +
+                sysex::kArpModes * (1 + sysex::kArpMaxSteps) + 1];
+  uint8_t *out = sysex::putHeader(reply, sysex::CMD_ARP_STEPS_REPLY);
+  for (uint8_t mode = 0; mode < sysex::kArpModes; mode++) {
+    uint8_t len = 0;
+    uint8_t data[sysex::kArpMaxSteps] = {0};
+    midi.arp_steps_getter_(mode, &len, data);
+    if (len > sysex::kArpMaxSteps) {
+      len = sysex::kArpMaxSteps;
     }
-    if (array[6 + len] != 0xF7) {
-      return;
+    *out++ = len;
+    for (uint8_t i = 0; i < sysex::kArpMaxSteps; i++) {
+      *out++ = i < len ? data[i] : 0;
     }
-    instance_->arp_steps_setter_(mode, len, array + 6);
-    return;
   }
+  *out++ = sysex::kEnd;
+  midi.sendSysEx(reply, out - reply);
+  return sysex::ERROR_NONE;
+}
 
-  // Get custom waveform: F0 7D 00 07 F7
-  if (size == kSysexCustomWaveformGetSize &&
-      array[0] == 0xF0 && array[1] == 0x7D && array[2] == 0x00 &&
-      array[3] == kSysexCustomWaveformGetCmd &&
-      array[4] == 0xF7 && instance_->custom_waveform_getter_ != nullptr) {
-    uint8_t bank = 0;
-    uint8_t index = 0;
-    instance_->custom_waveform_getter_(&bank, &index);
-    const uint8_t reply[] = {0xF0, 0x7D, 0x00, kSysexCustomWaveformReplyCmd,
-                             bank, index, 0xF7};
-    instance_->sendSysEx(reply, sizeof(reply));
-    return;
+// Set arp steps: [mode] [len] [len steps]
+Midi::SysexError Midi::sysexSetArpSteps(Midi &midi, const uint8_t *payload,
+                                        unsigned size) {
+  if (midi.arp_steps_setter_ == nullptr) {
+    return sysex::ERROR_UNAVAILABLE;
+  }
+  const uint8_t mode = payload[0];
+  const uint8_t len = payload[1];
+  if (mode >= sysex::kArpModes || len > sysex::kArpMaxSteps) {
+    return sysex::ERROR_BAD_VALUE;
+  }
+  if (size != 2u + len) {
+    return sysex::ERROR_BAD_LENGTH;
   }
+  midi.arp_steps_setter_(mode, len, payload + 2);
+  return sysex::ERROR_NONE;
+}
 
-  // Set custom waveform: F0 7D 00 09 bank index F7
-  if (size == kSysexCustomWaveformSetSize &&
-      array[0] == 0xF0 && array[1] == 0x7D && array[2] == 0x00 &&
-      array[3] == kSysexCustomWaveformSetCmd &&
-      array[6] == 0xF7 && instance_->custom_waveform_setter_ != nullptr) {
-    uint8_t bank = array[4];
-    uint8_t index = array[5];
-    if (bank <= 2) {
-      instance_->custom_waveform_setter_(bank, index);
-    }
-    return;
+Midi::SysexError Midi::sysexGetCustomWaveform(Midi &midi,
+                                              const uint8_t *payload,
+                                              unsigned size) {
+  if (midi.custom_waveform_getter_ == nullptr) {
+    return sysex::ERROR_UNAVAILABLE;
   }
+  uint8_t bank = 0;
+  uint8_t index = 0;
+  midi.custom_waveform_getter_(&bank, &index);
+
+  uint8_t reply[sysex::kHeaderSize + 3];
+  uint8_t *out = sysex::putHeader(reply, sysex::CMD_CUSTOM_WAVEFORM_REPLY);
+  *out++ = bank;
+  *out++ = index;
+  *out++ = sysex::kEnd;
+  midi.sendSysEx(reply, out - reply);
+  return sysex::ERROR_NONE;
+}
 
-  uint8_t nn;
-  if (size == kSysexSetChannelSize) {
-    // Payload only: 7D 00 01 nn
-    if (memcmp(array, kSysexSetChannelCommand,
-               sizeof(kSysexSetChannelCommand)) != 0) {
-      return;
-    }
+// Set custom waveform: [bank] [index]
+Midi::SysexError Midi::sysexSetCustomWaveform(Midi &midi,
+                                              const uint8_t *payload,
+                                              unsigned size) {
+  if (midi.custom_waveform_setter_ == nullptr) {
+    return sysex::ERROR_UNAVAILABLE;
+  }
+  if (payload[0] >= sysex::kCustomWaveformBanks ||
+      !midi.custom_waveform_setter_(payload[0], payload[1])) {
+    return sysex::ERROR_BAD_VALUE;
+  }
+  return sysex::ERROR_NONE;
+}
 
-    nn = array[3];
-  } else if (size == kSysexSetChannelSizeFull) {
-    // Full SysEx: F0 7D 00 01 nn F7 (e.g. from Web MIDI)
-    if (array[0] != 0xF0 || array[5] != 0xF7) {
-      return;
-    }
-    if (memcmp(array + 1, kSysexSetChannelCommand,
-               sizeof(kSysexSetChannelCommand)) != 0) {
-      return;
+Midi::SysexError Midi::sysexGetVoicePolicy(Midi &midi, const uint8_t *payload,
+                                           unsigned size) {
+  if (midi.voice_policy_getter_ == nullptr) {
+    return sysex::ERROR_UNAVAILABLE;
+  }
+  uint8_t steal_policy = 0;
+  uint8_t retrigger_same_note = 0;
+  midi.voice_policy_getter_(&steal_policy, &retrigger_same_note);
+
+  uint8_t reply[sysex::kHeaderSize + 3];
+  uint8_t *out = sysex::putHeader(reply, sysex::CMD_VOICE_POLICY_REPLY);
+  *out++ = steal_policy;
+  *out++ = retrigger_same_note;
+  *out++ = sysex::kEnd;
+  midi.sendSysEx(reply, out - reply);
+  return sysex::ERROR_NONE;
+}
+
+// Set voice policy: [steal policy] [retrigger same note]
+Midi::SysexError Midi::sysexSetVoicePolicy(Midi &midi, const uint8_t *payload,
+                                           unsigned size) {
+  if (midi.voice_policy_setter_ == nullptr) {
+    return sysex::ERROR_UNAVAILABLE;
+  }
+  if (payload[0] >= sysex::kStealPolicies || payload[1] > 1) {
+    return sysex::ERROR_BAD_VALUE;
+  }
+  midi.voice_policy_setter_(payload[0], payload[1]);
+  return sysex::ERROR_NONE;
+}
+
+Midi::SysexError Midi::sysexGetLatency(Midi &midi, const uint8_t *payload,
+                                       unsigned size) {
+  uint8_t reply[kReplyMaxSize];
+  uint8_t *out = sysex::putHeader(reply, sysex::CMD_LATENCY_REPLY);
+  *out++ = NoteLatency::STAGE_COUNT;
+  *out++ = NoteLatency::kBins;
+  for (uint8_t stage = 0; stage < NoteLatency::STAGE_COUNT; stage++) {
+    const NoteLatency::Histogram &histogram =
+        NoteLatency::histogram(static_cast<NoteLatency::Stage>(stage));
+    out = sysex::putValue(out, histogram.count(), sysex::kLatencyValueSize);
+    out = sysex::putValue(out, histogram.min(), sysex::kLatencyValueSize);
+    out = sysex::putValue(out, histogram.mean(), sysex::kLatencyValueSize);
+    out = sysex::putValue(out, histogram.max(), sysex::kLatencyValueSize);
+    for (uint8_t bin = 0; bin < NoteLatency::kBins; bin++) {
+      out = sysex::putValue(out, histogram.bin(bin),
+                            sysex::kLatencyValueSize);
     }
-    nn = array[4];
-  } else {
-    return;
   }
+  *out++ = sysex::kEnd;
+  midi.sendSysEx(reply, out - reply);
+  return sysex::ERROR_NONE;
+}
 
-  if (nn > 15) {
-    return;
+Midi::SysexError Midi::sysexResetLatency(Midi &midi, const uint8_t *payload,
+                                         unsigned size) {
+  NoteLatency::reset();
+  return sysex::ERROR_NONE;
+}
+
+Midi::SysexError Midi::sysexGetProfile(Midi &midi, const uint8_t *payload,
+                                       unsigned size) {
+  if (midi.loop_profile_getter_ == nullptr) {
+    return sysex::ERROR_UNAVAILABLE;
   }
+  LoopProfiler::Report report;
+  midi.loop_profile_getter_(&report);
+
+  uint8_t reply[kReplyMaxSize];
+  uint8_t *out = sysex::putHeader(reply, sysex::CMD_PROFILE_REPLY);
+  *out++ = report.stage_count;
+  out = sysex::putValue(out, report.loops_per_second,
+                        sysex::kProfileValueSize);
+  for (uint8_t stage = 0; stage < report.stage_count; stage++) {
+    const LoopProfiler::StageStats &stats = report.stages[stage];
+    out = sysex::putValue(out, stats.min, sysex::kProfileValueSize);
+    out = sysex::putValue(out, stats.avg, sysex::kProfileValueSize);
+    out = sysex::putValue(out, stats.max, sysex::kProfileValueSize);
+    out = sysex::putValue(out, stats.p99, sysex::kProfileValueSize);
+  }
+  *out++ = sysex::kEnd;
+  midi.sendSysEx(reply, out - reply);
+  return sysex::ERROR_NONE;
+}
 
-  uint8_t newChannel = nn + 1;
-  instance_->setChannel(newChannel);
-  return;
+Midi::SysexError Midi::sysexGetVersion(Midi &midi, const uint8_t *payload,
+                                       unsigned size) {
+  uint8_t reply[sysex::kHeaderSize + 2];
+  uint8_t *out = sysex::putHeader(reply, sysex::CMD_VERSION_REPLY);
+  *out++ = sysex::kProtocolVersion;
+  *out++ = sysex::kEnd;
+  midi.sendSysEx(reply, out - reply);
+  return sysex::ERROR_NONE;
+}
+
+Midi::SysexError Midi::sysexGetPatch(Midi &midi, const uint8_t *payload,
+                                     unsigned size) {
+  sysex::Patch patch;
+  if (!midi.currentPatch(&patch)) {
+    return sysex::ERROR_UNAVAILABLE;
+  }
+  midi.sendPatch(patch);
+  return sysex::ERROR_NONE;
+}
+
+/** Apply a whole patch, then reply with the patch now in effect. */
+Midi::SysexError Midi::sysexLoadPatch(Midi &midi, const uint8_t *payload,
+                                      unsigned size) {
+  sysex::Patch patch;
+  if (midi.patch_setter_ == nullptr || !midi.currentPatch(&patch)) {
+    return sysex::ERROR_UNAVAILABLE;
+  }
+  const SysexError error = sysex::decodePatch(payload, size, &patch);
+  if (error != sysex::ERROR_NONE) {
+    return error;
+  }
+  midi.patch_setter_(patch);
+  if (midi.currentPatch(&patch)) {
+    midi.sendPatch(patch);
+  }
+  return sysex::ERROR_NONE;
+}
+
+bool Midi::currentPatch(sysex::Patch *patch) {
+  if (arp_steps_getter_ == nullptr || custom_waveform_getter_ == nullptr ||
+      voice_policy_getter_ == nullptr) {
+    return false;
+  }
+  *patch = {};
+  patch->channel = channel_;
+  for (uint8_t mode = 0; mode < sysex::kArpModes; mode++) {
+    uint8_t len = 0;
+    arp_steps_getter_(mode, &len, patch->arp_steps[mode]);
+    patch->arp_lengths[mode] = len > sysex::kArpMaxSteps ? sysex::kArpMaxSteps
+                                                         : len;
+  }
+  custom_waveform_getter_(&patch->waveform_bank, &patch->waveform_index);
+  voice_policy_getter_(&patch->steal_policy, &patch->retrigger_same_note);
+  return true;
+}
+
+void Midi::sendPatch(const sysex::Patch &patch) {
+  uint8_t reply[sysex::kHeaderSize + sysex::kPatchPayloadMax + 1];
+  uint8_t *out = sysex::putHeader(reply, sysex::CMD_PATCH_DUMP);
+  out += sysex::encodePatch(patch, out);
+  *out++ = sysex::kEnd;
+  sendSysEx(reply, out - reply);
 }
 
 void Midi::sendSysEx(const uint8_t *data, unsigned size) {
@@ -213,13 +391,24 @@ void Midi::sendSysEx(const uint8_t *data, unsigned size) {
   MIDI.sendSysEx(size, data, true);
 }
 
-void Midi::setChannel(uint8_t channel) {
+void Midi::sendSysexError(uint8_t command, SysexError error) {
+  uint8_t reply[sysex::kHeaderSize + 3];
+  uint8_t *out = sysex::putHeader(reply, sysex::CMD_ERROR_REPLY);
+  *out++ = command & 0x7F;
+  *out++ = error;
+  *out++ = sysex::kEnd;
+  sendSysEx(reply, out - reply);
+}
+
+void Midi::setChannel(uint8_t channel, bool save) {
   if (channel < 1 || channel > 16) {
     return;
   }
 
   channel_ = channel;
-  EepromStorage::saveMidiChannel(static_cast<uint8_t>(channel));
+  if (save) {
+    EepromStorage::saveMidiChannel(static_cast<uint8_t>(channel));
+  }
   MIDI.begin(channel);
 
   AutosaveLib::Logger::debug("MIDI channel set to " + String(channel));
@@ -237,9 +426,163 @@ void Midi::setCustomWaveformSysexHandlers(CustomWaveformGetter getter,
   custom_waveform_setter_ = setter;
 }
 
+void Midi::setVoicePolicySysexHandlers(VoicePolicyGetter getter,
+                                       VoicePolicySetter setter) {
+  voice_policy_getter_ = getter;
+  voice_policy_setter_ = setter;
+}
+
+void Midi::setLoopProfileSysexHandler(LoopProfileGetter getter) {
+  loop_profile_getter_ = getter;
+}
+
+void Midi::setPatchSysexHandler(PatchSetter setter) {
+  patch_setter_ = setter;
+}
+
+/**
+ * Both ports are read without a channel filter, one message each in turn so
+ * neither waits behind a burst on the other; queue() drops other channels.
+ */
 void Midi::read() {
-  usbMIDI.read(channel_);
-  MIDI.read(channel_);
+  const uint32_t start = ARM_DWT_CYCCNT;
+  const uint32_t budget = kDrainBudgetUs * (F_CPU_ACTUAL / 1000000);
+  previous_poll_cycles_ = last_read_cycles_;
+  last_read_cycles_ = start;
+
+  const int serial_pending = Serial1.available();
+  if (serial_pending > drain_stats_.serial_pending_max) {
+    drain_stats_.serial_pending_max = (uint16_t)serial_pending;
+  }
+
+  batch_size_ = 0;
+  bool usb_open = true;
+  bool serial_open = serial_pending > 0;
+  while (usb_open || serial_open) {
+    // Each turn queues at most one message per port.
+    if (batch_size_ + 2 > kBatchMax || ARM_DWT_CYCCNT - start >= budget) {
+      drain_stats_.budget_stops++;
+      break;
+    }
+    if (usb_open) {
+      read_cycles_ = ARM_DWT_CYCCNT;
+      usb_open = usbMIDI.read();
+    }
+    if (serial_open) {
+      read_cycles_ = ARM_DWT_CYCCNT;
+      MIDI.read(MIDI_CHANNEL_OMNI);
+      serial_open = Serial1.available() > 0;
+    }
+  }
+
+  if (batch_size_ > drain_stats_.batch_max) {
+    drain_stats_.batch_max = batch_size_;
+  }
+  if (batch_size_ == 0) {
+    return;
+  }
+  coalesce();
+  dispatch();
+}
+
+void Midi::queueNoteOn(uint8_t channel, uint8_t note, uint8_t velocity) {
+  instance_->queue(EVENT_NOTE_ON, channel, note, velocity);
+}
+
+void Midi::queueNoteOff(uint8_t channel, uint8_t note, uint8_t velocity) {
+  instance_->queue(EVENT_NOTE_OFF, channel, note, velocity);
+}
+
+void Midi::queueControlChange(uint8_t channel, uint8_t control,
+                              uint8_t value) {
+  instance_->queue(EVENT_CONTROL_CHANGE, channel, control, value);
+}
+
+void Midi::queueClock() { instance_->queue(EVENT_CLOCK, 0, 0, 0); }
+
+void Midi::queueStart() { instance_->queue(EVENT_START, 0, 0, 0); }
+
+void Midi::queueContinue() { instance_->queue(EVENT_CONTINUE, 0, 0, 0); }
+
+void Midi::queueStop() { instance_->queue(EVENT_STOP, 0, 0, 0); }
+
+void Midi::queue(EventType type, uint8_t channel, uint8_t data1,
+                 uint8_t data2) {
+  // Real-time messages have no channel.
+  if (channel != 0 && channel != channel_) {
+    return;
+  }
+  if (batch_size_ >= kBatchMax) {
+    return;
+  }
+  batch_[batch_size_++] = {type, channel, data1, data2, read_cycles_};
+}
+
+/**
+ * Drop every control change that a later one overrides within the same run
+ * of consecutive control changes. Any other message ends the run, so a CC
+ * never moves past a note or a real-time message (e.g. sustain on, note
+ * off, sustain off keeps all three).
+ */
+void Midi::coalesce() {
+  uint32_t seen[4] = {0, 0, 0, 0}; // one bit per controller, in this run
+  for (int i = batch_size_ - 1; i >= 0; i--) {
+    Event &event = batch_[i];
+    if (event.type != EVENT_CONTROL_CHANGE) {
+      seen[0] = seen[1] = seen[2] = seen[3] = 0;
+      continue;
+    }
+    const uint8_t control = event.data1 & 0x7F;
+    const uint32_t bit = 1u << (control & 31);
+    if (seen[control >> 5] & bit) {
+      event.type = EVENT_NONE;
+      drain_stats_.coalesced++;
+    } else {
+      seen[control >> 5] |= bit;
+    }
+  }
+}
+
+void Midi::dispatch() {
+  for (uint8_t i = 0; i < batch_size_; i++) {
+    const Event &event = batch_[i];
+    event_cycles_ = event.cycles;
+
+    ChannelCallback channel_callback = nullptr;
+    RealTimeCallback real_time_callback = nullptr;
+    switch (event.type) {
+    case EVENT_NOTE_ON:
+      channel_callback = note_on_;
+      break;
+    case EVENT_NOTE_OFF:
+      channel_callback = note_off_;
+      break;
+    case EVENT_CONTROL_CHANGE:
+      channel_callback = control_change_;
+      break;
+    case EVENT_CLOCK:
+      real_time_callback = clock_;
+      break;
+    case EVENT_START:
+      real_time_callback = start_;
+      break;
+    case EVENT_CONTINUE:
+      real_time_callback = continue_;
+      break;
+    case EVENT_STOP:
+      real_time_callback = stop_;
+      break;
+    case EVENT_NONE:
+      break;
+    }
+
+    if (channel_callback != nullptr) {
+      channel_callback(event.channel, event.data1, event.data2);
+    } else if (real_time_callback != nullptr) {
+      real_time_callback();
+    }
+  }
+  batch_size_ = 0;
 }
 
 } // namespace Autosave
@@ -2,6 +2,10 @@
 #define AUTOSAVE_MIDI_H
 
 #include <MIDI.h>
+#include <array>
+
+#include "core/LoopProfiler.h"
+#include "lib/SysexProtocol.h"
 
 namespace Autosave {
 
@@ -10,23 +14,62 @@ struct MidiNote {
   uint8_t velocity;
 };
 
+/**
+ * MIDI input from USB and the serial port (Serial1), plus the SysEx
+ * configuration protocol.
+ *
+ * read() drains both ports in turn into a batch, up to kBatchMax messages or
+ * kDrainBudgetUs, then dispatches the batch in arrival order. Before
+ * dispatch, a control change is dropped when a later one sets the same
+ * controller with only control changes in between; no CC moves past another
+ * message. SysEx is handled as soon as it is read.
+ *
+ * SysEx requests (see lib/SysexProtocol.h) are dispatched through a table
+ * indexed by the command byte, after checking the payload size against the
+ * protocol's spec; each handler only validates values.
+ */
 class Midi {
 public:
+  static constexpr uint8_t kBatchMax = 32;
+  static constexpr uint32_t kDrainBudgetUs = 150;
+
+  /** Drain counters since boot. */
+  struct DrainStats {
+    uint16_t batch_max;          // most messages in one drain
+    uint16_t serial_pending_max; // most bytes waiting on Serial1 at a drain
+    uint32_t coalesced;          // control changes replaced by a later one
+    uint32_t budget_stops;       // drains cut short by the budget
+  };
+
   Midi();
 
   void setHandleNoteOn(void (*callback)(uint8_t channel, uint8_t note,
                                         uint8_t velocity));
   void setHandleNoteOff(void (*callback)(uint8_t channel, uint8_t note,
                                          uint8_t velocity));
+  void setHandleControlChange(void (*callback)(uint8_t channel,
+                                               uint8_t control,
+                                               uint8_t value));
   void setHandleClock(void (*callback)(void));
   void setHandleStart(void (*callback)(void));
   void setHandleContinue(void (*callback)(void));
   void setHandleStop(void (*callback)(void));
 
   void begin();
-  void setChannel(uint8_t channel);
+  /** channel: 1 to 16; `save` also writes it to the EEPROM. */
+  void setChannel(uint8_t channel, bool save = true);
   uint8_t getChannel() const { return channel_; }
+  /** Drain and dispatch the pending messages of both ports. */
   void read();
+  const DrainStats &drainStats() const { return drain_stats_; }
+  /** ARM_DWT_CYCCNT when the message being dispatched was read. */
+  uint32_t eventCycles() const { return event_cycles_; }
+  /**
+   * ARM_DWT_CYCCNT at the poll before the current one. Neither port
+   * timestamps incoming bytes, so this bounds, but does not give, when the
+   * message arrived.
+   */
+  uint32_t previousPollCycles() const { return previous_poll_cycles_; }
 
   /** Callbacks for arp steps SysEx get/set; set from ArpSynthState. */
   using ArpStepsGetter = void (*)(uint8_t mode, uint8_t *len, uint8_t *data);
@@ -34,23 +77,147 @@ public:
                                   const uint8_t *data);
   void setArpStepsSysexHandlers(ArpStepsGetter getter, ArpStepsSetter setter);
 
-  /** Callbacks for custom waveform SysEx get/set; set from Synth. */
+  /**
+   * Callbacks for custom waveform SysEx get/set; set from Synth. The setter
+   * returns false, changing nothing, when the bank has no such index.
+   */
   using CustomWaveformGetter = void (*)(uint8_t *bank, uint8_t *index);
-  using CustomWaveformSetter = void (*)(uint8_t bank, uint8_t index);
+  using CustomWaveformSetter = bool (*)(uint8_t bank, uint8_t index);
   void setCustomWaveformSysexHandlers(CustomWaveformGetter getter,
                                       CustomWaveformSetter setter);
 
+  /**
+   * Callbacks for poly voice policy SysEx get/set; set from Synth. Values are
+   * range-checked before the setter is called.
+   */
+  using VoicePolicyGetter = void (*)(uint8_t *steal_policy,
+                                     uint8_t *retrigger_same_note);
+  using VoicePolicySetter = void (*)(uint8_t steal_policy,
+                                     uint8_t retrigger_same_note);
+  void setVoicePolicySysexHandlers(VoicePolicyGetter getter,
+                                   VoicePolicySetter setter);
+
+  /** Callback for the loop profiler SysEx query; set from Synth. */
+  using LoopProfileGetter = void (*)(LoopProfiler::Report *report);
+  void setLoopProfileSysexHandler(LoopProfileGetter getter);
+
+  /**
+   * Callback for a patch load: apply every setting and save them together;
+   * set from Synth. A patch dump is built from the getters above.
+   */
+  using PatchSetter = void (*)(const AutosaveLib::sysex::Patch &patch);
+  void setPatchSysexHandler(PatchSetter setter);
+
 private:
+  enum EventType : uint8_t {
+    EVENT_NONE, // coalesced
+    EVENT_NOTE_ON,
+    EVENT_NOTE_OFF,
+    EVENT_CONTROL_CHANGE,
+    EVENT_CLOCK,
+    EVENT_START,
+    EVENT_CONTINUE,
+    EVENT_STOP,
+  };
+
+  struct Event {
+    EventType type;
+    uint8_t channel;
+    uint8_t data1;
+    uint8_t data2;
+    uint32_t cycles; // ARM_DWT_CYCCNT when read
+  };
+
+  using ChannelCallback = void (*)(uint8_t channel, uint8_t data1,
+                                   uint8_t data2);
+  using RealTimeCallback = void (*)(void);
+
   static Midi *instance_;
   uint8_t channel_ = 1;
+  uint32_t event_cycles_ = 0;
+  uint32_t previous_poll_cycles_ = 0;
+  uint32_t last_read_cycles_ = 0;
+
+  Event batch_[kBatchMax];
+  uint8_t batch_size_ = 0;
+  uint32_t read_cycles_ = 0; // when the port read in progress started
+  DrainStats drain_stats_ = {};
+
+  ChannelCallback note_on_ = nullptr;
+  ChannelCallback note_off_ = nullptr;
+  ChannelCallback control_change_ = nullptr;
+  RealTimeCallback clock_ = nullptr;
+  RealTimeCallback start_ = nullptr;
+  RealTimeCallback continue_ = nullptr;
+  RealTimeCallback stop_ = nullptr;
+
   ArpStepsGetter arp_steps_getter_ = nullptr;
   ArpStepsSetter arp_steps_setter_ = nullptr;
   CustomWaveformGetter custom_waveform_getter_ = nullptr;
   CustomWaveformSetter custom_waveform_setter_ = nullptr;
+  VoicePolicyGetter voice_policy_getter_ = nullptr;
+  VoicePolicySetter voice_policy_setter_ = nullptr;
+  LoopProfileGetter loop_profile_getter_ = nullptr;
+  PatchSetter patch_setter_ = nullptr;
+
+  /** Port handlers: queue the message in the batch. */
+  static void queueNoteOn(uint8_t channel, uint8_t note, uint8_t velocity);
+  static void queueNoteOff(uint8_t channel, uint8_t note, uint8_t velocity);
+  static void queueControlChange(uint8_t channel, uint8_t control,
+                                 uint8_t value);
+  static void queueClock();
+  static void queueStart();
+  static void queueContinue();
+  static void queueStop();
+  void queue(EventType type, uint8_t channel, uint8_t data1, uint8_t data2);
+  void coalesce();
+  void dispatch();
+
+  using SysexError = AutosaveLib::sysex::Error;
+  using SysexHandler = SysexError (*)(Midi &midi, const uint8_t *payload,
+                                      unsigned size);
+  static const std::array<SysexHandler, AutosaveLib::sysex::CMD_COUNT>
+      kSysexHandlers;
+  static constexpr std::array<SysexHandler, AutosaveLib::sysex::CMD_COUNT>
+  sysexHandlers();
+
+  static SysexError sysexSetChannel(Midi &midi, const uint8_t *payload,
+                                    unsigned size);
+  static SysexError sysexGetChannel(Midi &midi, const uint8_t *payload,
+                                    unsigned size);
+  static SysexError sysexGetArpSteps(Midi &midi, const uint8_t *payload,
+                                     unsigned size);
+  static SysexError sysexSetArpSteps(Midi &midi, const uint8_t *payload,
+                                     unsigned size);
+  static SysexError sysexGetCustomWaveform(Midi &midi, const uint8_t *payload,
+                                           unsigned size);
+  static SysexError sysexSetCustomWaveform(Midi &midi, const uint8_t *payload,
+                                           unsigned size);
+  static SysexError sysexGetVoicePolicy(Midi &midi, const uint8_t *payload,
+                                        unsigned size);
+  static SysexError sysexSetVoicePolicy(Midi &midi, const uint8_t *payload,
+                                        unsigned size);
+  static SysexError sysexGetLatency(Midi &midi, const uint8_t *payload,
+                                    unsigned size);
+  static SysexError sysexResetLatency(Midi &midi, const uint8_t *payload,
+                                      unsigned size);
+  static SysexError sysexGetProfile(Midi &midi, const uint8_t *payload,
+                                    unsigned size);
+  static SysexError sysexGetVersion(Midi &midi, const uint8_t *payload,
+                                    unsigned size);
+  static SysexError sysexGetPatch(Midi &midi, const uint8_t *payload,
+                                  unsigned size);
+  static SysexError sysexLoadPatch(Midi &midi, const uint8_t *payload,
+                                   unsigned size);
+
+  /** False if a setting has no getter. */
+  bool currentPatch(AutosaveLib::sysex::Patch *patch);
+  void sendPatch(const AutosaveLib::sysex::Patch &patch);
 
   /** Static SysEx handler to register with the MIDI library. */
   static void handleSysEx(uint8_t *array, unsigned size);
   void sendSysEx(const uint8_t *data, unsigned size);
+  void sendSysexError(uint8_t command, SysexError error);
 };
 
 } // namespace Autosave
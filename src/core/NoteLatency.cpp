@@ -0,0 +1,24 @@
+#include "NoteLatency.h"
+
+#include <Arduino.h>
+
+namespace Autosave {
+
+NoteLatency::Histogram NoteLatency::histograms_[NoteLatency::STAGE_COUNT];
+
+void NoteLatency::record(Stage stage, uint32_t cycles) {
+  // F_CPU_ACTUAL follows set_arm_clock(), so it is read at run time.
+  histograms_[stage].record(cycles / (F_CPU_ACTUAL / 1000000));
+}
+
+const NoteLatency::Histogram &NoteLatency::histogram(Stage stage) {
+  return histograms_[stage];
+}
+
+void NoteLatency::reset() {
+  for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+    histograms_[i].reset();
+  }
+}
+
+} // namespace Autosave
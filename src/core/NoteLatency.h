@@ -0,0 +1,48 @@
+#ifndef AUTOSAVE_NOTE_LATENCY_H
+#define AUTOSAVE_NOTE_LATENCY_H
+
+#include <cstdint>
+
+#include "lib/Histogram.h"
+
+namespace Autosave {
+
+/**
+ * Note-on latency histograms, in microseconds, one per stage:
+ *
+ * - STAGE_POLL_INTERVAL: previous Midi::read poll to the read of the
+ *   message. Neither port timestamps incoming bytes, so the time a message
+ *   waited before the read is not measured; this poll interval is only an
+ *   upper bound on it.
+ * - STAGE_STATE: dispatch to the State::noteOn call.
+ * - STAGE_ENVELOPE: dispatch to the first envelope sample of the note (the
+ *   sample offset its voice is triggered at), once per MIDI event.
+ *
+ * End-to-end latency is at most POLL_INTERVAL + ENVELOPE, plus the I2S
+ * output buffer.
+ */
+class NoteLatency {
+public:
+  enum Stage : uint8_t {
+    STAGE_POLL_INTERVAL = 0,
+    STAGE_STATE,
+    STAGE_ENVELOPE,
+    STAGE_COUNT,
+  };
+
+  /** 16 bins: 0 µs, then powers of two up to 16.4 ms and above. */
+  static constexpr uint8_t kBins = 16;
+  using Histogram = AutosaveLib::Histogram<kBins>;
+
+  /** Record a duration given in ARM_DWT_CYCCNT cycles. */
+  static void record(Stage stage, uint32_t cycles);
+  static const Histogram &histogram(Stage stage);
+  static void reset();
+
+private:
+  static Histogram histograms_[STAGE_COUNT];
+};
+
+} // namespace Autosave
+
+#endif
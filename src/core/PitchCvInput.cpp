@@ -0,0 +1,131 @@
+#include "PitchCvInput.h"
+
+#include <array>
+#include <cmath>
+
+#include "core/EepromStorage.h"
+
+namespace {
+constexpr float kFullScaleReading = Autosave::AnalogScanner::kFullScale;
+
+// Volt to ratio: 2^(i / 256) over one octave, interpolated linearly (error
+// under 0.002 cent), then scaled by whole octaves.
+constexpr int kRatioSteps = 256;
+constexpr float kMaxVolts = 16.0f;
+
+// 2^x at compile time, for x in [0, 1].
+constexpr double constexprExp2(double x) {
+  const double y = x * 0.69314718055994531;
+  double term = 1.0;
+  double sum = 1.0;
+  for (int k = 1; k < 30; k++) {
+    term *= y / k;
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr std::array<float, kRatioSteps + 1> ratioTable() {
+  std::array<float, kRatioSteps + 1> ratios{};
+  for (int i = 0; i <= kRatioSteps; i++) {
+    ratios[i] = (float)constexprExp2((double)i / kRatioSteps);
+  }
+  return ratios;
+}
+
+constexpr std::array<float, kRatioSteps + 1> kRatios = ratioTable();
+
+static_assert(Autosave::PitchCvInput::kCalibrationPoints <=
+                  Autosave::EepromStorage::kPitchCvPointsMax,
+              "the pitch CV calibration must fit its EEPROM slot");
+} // namespace
+
+namespace Autosave {
+
+PitchCvInput::PitchCvInput() {
+  // Uncalibrated: the ADC range is 0 to kCalibrationVolts.
+  for (uint8_t i = 0; i < kCalibrationPoints; i++) {
+    points_[i] = i * kFullScaleReading / kCalibrationVolts;
+  }
+}
+
+void PitchCvInput::begin() {
+  float points[kCalibrationPoints];
+  for (uint8_t i = 0; i < kCalibrationPoints; i++) {
+    points[i] = points_[i];
+  }
+  if (EepromStorage::loadPitchCvCalibration(points, kCalibrationPoints) &&
+      rising(points)) {
+    for (uint8_t i = 0; i < kCalibrationPoints; i++) {
+      points_[i] = points[i];
+    }
+    enabled_ = true;
+  }
+}
+
+float PitchCvInput::volts() {
+  if (scanner_ == nullptr) {
+    return 0.0f;
+  }
+  const float reading = scanner_->mean(AnalogScanner::CH_CV);
+  if (fabsf(reading - reading_) > kHysteresisReadings) {
+    reading_ = reading;
+  }
+  const float volts = readingToVolts(reading_);
+  return fabsf(volts) < kDeadBandVolts ? 0.0f : volts;
+}
+
+void PitchCvInput::calibrate(uint8_t volt) {
+  if (volt < kCalibrationPoints && scanner_ != nullptr) {
+    points_[volt] = scanner_->mean(AnalogScanner::CH_CV);
+  }
+}
+
+bool PitchCvInput::saveCalibration() {
+  if (!rising(points_)) {
+    return false;
+  }
+  EepromStorage::savePitchCvCalibration(points_, kCalibrationPoints);
+  enabled_ = true;
+  return true;
+}
+
+float PitchCvInput::voltsToRatio(float volts) {
+  if (volts < -kMaxVolts) {
+    volts = -kMaxVolts;
+  } else if (volts > kMaxVolts) {
+    volts = kMaxVolts;
+  }
+
+  // volts = octave + fraction, fraction in [0, 1)
+  int octave = (int)volts;
+  octave -= (float)octave > volts;
+  const float index = (volts - (float)octave) * kRatioSteps;
+  const int i = (int)index;
+  const float ratio = kRatios[i] + (kRatios[i + 1] - kRatios[i]) * (index - i);
+
+  return octave >= 0 ? ratio * (float)(1u << octave)
+                     : ratio / (float)(1u << -octave);
+}
+
+/** Piecewise linear through the points, extended past both ends. */
+float PitchCvInput::readingToVolts(float reading) const {
+  uint8_t i = 1;
+  while (i < kCalibrationPoints - 1 && reading > points_[i]) {
+    i++;
+  }
+  const float low = points_[i - 1];
+  const float high = points_[i];
+  return (i - 1) + (reading - low) / (high - low);
+}
+
+bool PitchCvInput::rising(const float *points) {
+  for (uint8_t i = 1; i < kCalibrationPoints; i++) {
+    if (!(points[i] > points[i - 1])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace Autosave
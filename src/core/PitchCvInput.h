@@ -0,0 +1,78 @@
+#ifndef AUTOSAVE_PITCH_CV_INPUT_H
+#define AUTOSAVE_PITCH_CV_INPUT_H
+
+#include <cstdint>
+
+#include "core/AnalogScanner.h"
+
+namespace Autosave {
+
+/**
+ * 1V/oct pitch CV input on hardware::PIN_CV.
+ *
+ * The AnalogScanner reads the ADC at 12 bits and a fixed rate, 16 times per
+ * audio block. Once per block the audio update takes the mean of the last
+ * frame (oversampling: about two bits more than a single read), so the
+ * pitch follows a sequencer step within one block, with no smoothing lag.
+ * The mean only moves past kHysteresisReadings, and volts within
+ * kDeadBandVolts of 0 V read as 0 V, so noise, an ADC offset or an
+ * unpatched input do not detune the voices.
+ *
+ * The mean reading becomes volts through a calibration table: the reading
+ * measured at each whole volt from 0 to kCalibrationVolts (see
+ * calibrate()), stored in EEPROM and interpolated linearly in between.
+ * voltsToRatio() turns volts into a pitch ratio from a table of 1/256
+ * octave steps.
+ *
+ * The input is off until a calibration is loaded or saved, or until
+ * setEnabled(true): the audio update does not transpose by it.
+ */
+class PitchCvInput {
+public:
+  static constexpr uint8_t kCalibrationVolts = 10;
+  static constexpr uint8_t kCalibrationPoints = kCalibrationVolts + 1;
+  // About 12 cents; 4 LSB uncalibrated.
+  static constexpr float kDeadBandVolts = 0.01f;
+  static constexpr float kHysteresisReadings = 2.0f;
+
+  PitchCvInput();
+
+  /** Load the calibration from EEPROM; a valid one enables the input. */
+  void begin();
+  bool enabled() const { return enabled_; }
+  void setEnabled(bool enabled) { enabled_ = enabled; }
+  /** Where the CV is read; without one the input stays at 0 V. */
+  void source(const AnalogScanner *scanner) { scanner_ = scanner; }
+
+  /** Volts at the input, over the scanner's last frame (see above). */
+  float volts();
+
+  /**
+   * The input is at `volt` volts (0 to kCalibrationVolts) right now: take the
+   * current reading as that calibration point. Saved by saveCalibration().
+   */
+  void calibrate(uint8_t volt);
+  /**
+   * Store the calibration if its points rise with the voltage, and enable
+   * the input.
+   */
+  bool saveCalibration();
+
+  /** 2^volts, for -16 to 16 volts (clamped). */
+  static float voltsToRatio(float volts);
+
+private:
+  const AnalogScanner *scanner_ = nullptr;
+  bool enabled_ = false;
+  float reading_ = 0.0f; // mean reading, moved past the hysteresis only
+
+  /** Mean reading at each whole volt, rising. */
+  float points_[kCalibrationPoints];
+
+  float readingToVolts(float reading) const;
+  static bool rising(const float *points);
+};
+
+} // namespace Autosave
+
+#endif
@@ -0,0 +1,92 @@
+#include "Scheduler.h"
+
+#include <Arduino.h>
+
+namespace Autosave {
+
+uint8_t Scheduler::add(const char *name, Callback callback, void *ctx,
+                       uint32_t period_us, uint32_t budget_us) {
+  if (count_ >= kMaxTasks || callback == nullptr) {
+    return kMaxTasks;
+  }
+
+  const uint8_t task = count_++;
+  callbacks_[task] = callback;
+  contexts_[task] = ctx;
+  next_us_[task] = micros();
+  stats_[task] = {};
+  stats_[task].name = name;
+  stats_[task].period_us = period_us;
+  stats_[task].budget_cycles = budget_us * (F_CPU_ACTUAL / 1000000);
+  return task;
+}
+
+void Scheduler::start() {
+  const uint32_t now = micros();
+  for (uint8_t i = 0; i < count_; i++) {
+    next_us_[i] = now;
+  }
+}
+
+void Scheduler::run() {
+  for (uint8_t i = 0; i < count_; i++) {
+    if (stats_[i].period_us == 0) {
+      execute(i);
+    }
+  }
+
+  // Earliest deadline first, among the tasks that are due.
+  const uint32_t now = micros();
+  uint8_t due = kMaxTasks;
+  uint32_t due_late = 0;
+  for (uint8_t i = 0; i < count_; i++) {
+    const uint32_t late = now - next_us_[i];
+    if (stats_[i].period_us == 0 || (int32_t)late < 0) {
+      continue;
+    }
+    if (due == kMaxTasks || late > due_late) {
+      due = i;
+      due_late = late;
+    }
+  }
+  if (due == kMaxTasks) {
+    return;
+  }
+
+  TaskStats &stats = stats_[due];
+  const uint32_t periods = due_late / stats.period_us;
+  stats.missed += periods;
+  next_us_[due] += (periods + 1) * stats.period_us;
+  execute(due);
+}
+
+void Scheduler::resetStats() {
+  for (uint8_t i = 0; i < count_; i++) {
+    TaskStats &stats = stats_[i];
+    stats.runs = 0;
+    stats.overruns = 0;
+    stats.missed = 0;
+    stats.last_cycles = 0;
+    stats.max_cycles = 0;
+    stats.total_cycles = 0;
+  }
+}
+
+void Scheduler::execute(uint8_t task) {
+  const uint32_t start = ARM_DWT_CYCCNT;
+  callbacks_[task](contexts_[task]);
+  const uint32_t cycles = ARM_DWT_CYCCNT - start;
+
+  TaskStats &stats = stats_[task];
+  stats.runs++;
+  stats.last_cycles = cycles;
+  stats.total_cycles += cycles;
+  if (cycles > stats.max_cycles) {
+    stats.max_cycles = cycles;
+  }
+  if (stats.budget_cycles != 0 && cycles > stats.budget_cycles) {
+    stats.overruns++;
+  }
+}
+
+} // namespace Autosave
@@ -0,0 +1,69 @@
+#ifndef AUTOSAVE_SCHEDULER_H
+#define AUTOSAVE_SCHEDULER_H
+
+#include <cstdint>
+
+namespace Autosave {
+
+/**
+ * Cooperative main loop scheduler. Tasks are registered once, with a period
+ * and a cycle budget:
+ *
+ * - period 0: runs on every pass (MIDI), first
+ * - period > 0: runs when its deadline is due, at most one such task per
+ *   pass, the most overdue first; the next deadline is one period later, so
+ *   the rate does not drift with the loop speed
+ *
+ * Running a single periodic task per pass bounds how long an every-pass task
+ * waits to the longest periodic task. A task that falls more than a period
+ * behind skips the missed periods instead of running back to back.
+ *
+ * Every run is timed with ARM_DWT_CYCCNT: a run over the task's budget counts
+ * as an overrun.
+ */
+class Scheduler {
+public:
+  static constexpr uint8_t kMaxTasks = 8;
+
+  using Callback = void (*)(void *ctx);
+
+  struct TaskStats {
+    const char *name;
+    uint32_t period_us;     // 0: every pass
+    uint32_t budget_cycles; // ARM_DWT_CYCCNT cycles
+    uint32_t runs;
+    uint32_t overruns;      // runs over budget
+    uint32_t missed;        // periods skipped while behind
+    uint32_t last_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+  };
+
+  /**
+   * Register a task; every-pass tasks run in registration order. A budget of
+   * 0 is never overrun. Returns the task index, or kMaxTasks when full.
+   */
+  uint8_t add(const char *name, Callback callback, void *ctx,
+              uint32_t period_us, uint32_t budget_us);
+  /** Start the periods from now: every periodic task is due at once. */
+  void start();
+  /** One main loop pass. */
+  void run();
+
+  uint8_t taskCount() const { return count_; }
+  const TaskStats &stats(uint8_t task) const { return stats_[task]; }
+  void resetStats();
+
+private:
+  Callback callbacks_[kMaxTasks];
+  void *contexts_[kMaxTasks];
+  uint32_t next_us_[kMaxTasks]; // deadline of periodic tasks
+  TaskStats stats_[kMaxTasks];
+  uint8_t count_ = 0;
+
+  void execute(uint8_t task);
+};
+
+} // namespace Autosave
+
+#endif
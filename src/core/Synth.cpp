@@ -1,11 +1,25 @@
 #include "Synth.h"
 
 #include "EepromStorage.h"
+#include "NoteLatency.h"
 #include "lib/Logger.h"
 #include "states/ArpSynthState.h"
 #include "states/MonoSynthState.h"
 #include "states/PolySynthState.h"
 
+namespace {
+// Main loop tasks: period (0: every pass) and budget, in microseconds.
+constexpr uint32_t kMidiBudgetUs = 200;
+constexpr uint32_t kControlsPeriodUs = 1000; // 1 kHz
+constexpr uint32_t kControlsBudgetUs = 100;
+constexpr uint32_t kTelemetryPeriodUs = 100000; // 10 Hz
+constexpr uint32_t kTelemetryBudgetUs = 1000;
+
+// Serial dump of the loop profile and task stats, in telemetry runs (every
+// 5 s; AUTOSAVE_PROFILE + DEBUG builds).
+constexpr uint32_t kProfileReportRuns = 50;
+} // namespace
+
 namespace Autosave {
 
 Synth::Synth() {
@@ -27,6 +41,7 @@ void Synth::begin() {
   AutosaveLib::Logger::info("Initializing Synth module");
 
   hardware->begin();
+  audio->setCvInput(&hardware->scanner());
   audio->begin();
   midi->begin();
 
@@ -34,27 +49,80 @@ void Synth::begin() {
   midi->setArpStepsSysexHandlers(arpStepsSysexGetter, arpStepsSysexSetter);
   midi->setCustomWaveformSysexHandlers(customWaveformSysexGetter,
                                        customWaveformSysexSetter);
+  midi->setVoicePolicySysexHandlers(voicePolicySysexGetter,
+                                    voicePolicySysexSetter);
+  midi->setLoopProfileSysexHandler(loopProfileSysexGetter);
+  midi->setPatchSysexHandler(patchSysexSetter);
 
   // Load persisted data and
   EepromStorage::loadArpModeSteps(ArpSynthState::arp_mode_steps);
+  EepromStorage::loadVoicePolicy(PolySynthState::steal_policy,
+                                 PolySynthState::retrigger_same_note);
 
   state_->begin();
 
   // Load the initial mode from the hardware
   updateMode();
+
+  scheduler_.add("midi", &Synth::midiTask, this, 0, kMidiBudgetUs);
+  scheduler_.add("controls", &Synth::controlsTask, this, kControlsPeriodUs,
+                 kControlsBudgetUs);
+  scheduler_.add("telemetry", &Synth::telemetryTask, this,
+                 kTelemetryPeriodUs, kTelemetryBudgetUs);
+  scheduler_.start();
 }
 
 void Synth::process() {
+  profiler_.begin();
+  scheduler_.run();
+}
+
+void Synth::midiTask(void *ctx) { static_cast<Synth *>(ctx)->processMidi(); }
+
+void Synth::controlsTask(void *ctx) {
+  static_cast<Synth *>(ctx)->processControls();
+}
+
+void Synth::telemetryTask(void *ctx) {
+  static_cast<Synth *>(ctx)->updateTelemetry();
+}
+
+void Synth::processMidi() {
   midi->read();
+  profiler_.mark(LoopProfiler::STAGE_MIDI);
+}
+
+void Synth::processControls() {
   hardware->update();
+  profiler_.mark(LoopProfiler::STAGE_HARDWARE);
+
+  // States only react to controls: nothing to do on most scans.
+  const uint16_t changed = hardware->changedMask();
+  if (changed == 0) {
+    return;
+  }
 
   // Handle mode switch
-  if (hardware->changed(hardware::CTRL_SWITCH_MODE)) {
+  if (changed & hardware::controlBit(hardware::CTRL_SWITCH_MODE)) {
     updateMode();
   }
+  profiler_.mark(LoopProfiler::STAGE_MODE);
 
   state_->process();
-  audio->updateDrift();
+  profiler_.mark(LoopProfiler::STAGE_STATE);
+}
+
+/** Sort the profile off the MIDI path, so SysEx requests get a copy. */
+void Synth::updateTelemetry() {
+  profiler_.report(&profile_);
+
+#if defined(AUTOSAVE_PROFILE) && defined(DEBUG)
+  if (++telemetry_runs_ >= kProfileReportRuns) {
+    telemetry_runs_ = 0;
+    debugLoopProfile();
+    debugSchedule();
+  }
+#endif
 
 #ifdef DEBUG
   // debugAudioUsage();
@@ -99,6 +167,50 @@ void Synth::debugAudioUsage() {
   AutosaveLib::Logger::print(AudioMemoryUsageMax(),
                              AutosaveLib::Logger::LEVEL_DEBUG);
   AutosaveLib::Logger::println("(max)", AutosaveLib::Logger::LEVEL_DEBUG);
+  AutosaveLib::Logger::print("Commands: ", AutosaveLib::Logger::LEVEL_DEBUG);
+  AutosaveLib::Logger::print(
+      (int)(audio->commandLatencyMaxCycles() / (F_CPU_ACTUAL / 1000000)),
+      AutosaveLib::Logger::LEVEL_DEBUG);
+  AutosaveLib::Logger::print("us(max), ", AutosaveLib::Logger::LEVEL_DEBUG);
+  AutosaveLib::Logger::print((int)audio->droppedCommands(),
+                             AutosaveLib::Logger::LEVEL_DEBUG);
+  AutosaveLib::Logger::println(" dropped", AutosaveLib::Logger::LEVEL_DEBUG);
+}
+
+void Synth::debugLoopProfile() {
+  const LoopProfiler::Report &report = profile_;
+  if (report.stage_count == 0) {
+    return;
+  }
+
+  AutosaveLib::Logger::info("Loop: " + String(report.loops_per_second) +
+                            " iterations/s, cycles min/avg/p99/max:");
+  for (uint8_t i = 0; i < report.stage_count; i++) {
+    const LoopProfiler::StageStats &stats = report.stages[i];
+    AutosaveLib::Logger::info(
+        "  " + String(LoopProfiler::stageName((LoopProfiler::Stage)i)) +
+        ": " + String(stats.min) + "/" + String(stats.avg) + "/" +
+        String(stats.p99) + "/" + String(stats.max));
+  }
+}
+
+void Synth::debugSchedule() {
+  const uint32_t cycles_per_us = F_CPU_ACTUAL / 1000000;
+  for (uint8_t i = 0; i < scheduler_.taskCount(); i++) {
+    const Scheduler::TaskStats &stats = scheduler_.stats(i);
+    AutosaveLib::Logger::info(
+        "Task " + String(stats.name) + ": " + String(stats.runs) +
+        " runs, max " + String(stats.max_cycles / cycles_per_us) + "us, " +
+        String(stats.overruns) + " over budget, " + String(stats.missed) +
+        " missed");
+  }
+
+  const Midi::DrainStats &drain = midi->drainStats();
+  AutosaveLib::Logger::info(
+      "MIDI: batch max " + String(drain.batch_max) + ", serial max " +
+      String(drain.serial_pending_max) + " bytes, " +
+      String(drain.coalesced) + " coalesced, " + String(drain.budget_stops) +
+      " budget stops");
 }
 
 /***
@@ -127,7 +239,14 @@ void Synth::midiNoteOn(uint8_t channel, uint8_t note, uint8_t velocity) {
     return;
   }
 
+  const uint32_t event_cycles = instance_->midi->eventCycles();
+  NoteLatency::record(NoteLatency::STAGE_POLL_INTERVAL,
+                      event_cycles - instance_->midi->previousPollCycles());
+
+  instance_->audio->beginCommands(event_cycles);
+  NoteLatency::record(NoteLatency::STAGE_STATE, ARM_DWT_CYCCNT - event_cycles);
   instance_->state_->noteOn({fixMidiNote(note), velocity});
+  instance_->audio->endCommands();
 }
 
 void Synth::midiNoteOff(uint8_t channel, uint8_t note, uint8_t velocity) {
@@ -135,7 +254,9 @@ void Synth::midiNoteOff(uint8_t channel, uint8_t note, uint8_t velocity) {
     return;
   }
 
+  instance_->audio->beginCommands(instance_->midi->eventCycles());
   instance_->state_->noteOff({fixMidiNote(note), velocity});
+  instance_->audio->endCommands();
 }
 
 void Synth::customWaveformSysexGetter(uint8_t *bank, uint8_t *index) {
@@ -145,13 +266,36 @@ void Synth::customWaveformSysexGetter(uint8_t *bank, uint8_t *index) {
   instance_->audio->getCustomWaveform(bank, index);
 }
 
-void Synth::customWaveformSysexSetter(uint8_t bank, uint8_t index) {
-  if (instance_ == nullptr || instance_->audio == nullptr) {
-    return;
+bool Synth::customWaveformSysexSetter(uint8_t bank, uint8_t index) {
+  if (instance_ == nullptr || instance_->audio == nullptr ||
+      !instance_->audio->setCustomWaveform(bank, index)) {
+    return false;
   }
-  instance_->audio->setCustomWaveform(bank, index);
   instance_->audio->applyCustomWaveform();
+  // Save what Audio now plays, like a patch load.
+  instance_->audio->getCustomWaveform(&bank, &index);
   EepromStorage::saveCustomWaveform(bank, index);
+  return true;
+}
+
+void Synth::voicePolicySysexGetter(uint8_t *steal_policy,
+                                   uint8_t *retrigger_same_note) {
+  *steal_policy = PolySynthState::steal_policy;
+  *retrigger_same_note = PolySynthState::retrigger_same_note ? 1 : 0;
+}
+
+void Synth::voicePolicySysexSetter(uint8_t steal_policy,
+                                   uint8_t retrigger_same_note) {
+  PolySynthState::setVoicePolicy(steal_policy, retrigger_same_note != 0);
+  EepromStorage::saveVoicePolicy(PolySynthState::steal_policy,
+                                 PolySynthState::retrigger_same_note);
+}
+
+void Synth::loopProfileSysexGetter(LoopProfiler::Report *report) {
+  if (instance_ == nullptr || report == nullptr) {
+    return;
+  }
+  *report = instance_->profile_;
 }
 
 void Synth::arpStepsSysexGetter(uint8_t mode, uint8_t *len, uint8_t *data) {
@@ -181,4 +325,33 @@ void Synth::arpStepsSysexSetter(uint8_t mode, uint8_t len,
   EepromStorage::saveArpModeSteps(ArpSynthState::arp_mode_steps);
 }
 
+/** Apply a loaded patch, then save it with a single storage pass. */
+void Synth::patchSysexSetter(const AutosaveLib::sysex::Patch &patch) {
+  if (instance_ == nullptr || instance_->audio == nullptr) {
+    return;
+  }
+  instance_->midi->setChannel(patch.channel, false);
+
+  for (uint8_t mode = 0; mode < AutosaveLib::sysex::kArpModes; mode++) {
+    auto &vec = ArpSynthState::arp_mode_steps[mode];
+    const uint8_t *steps = patch.arp_steps[mode];
+    vec.assign(steps, steps + patch.arp_lengths[mode]);
+  }
+
+  // Audio keeps its waveform when the index is past the end of the bank.
+  uint8_t bank;
+  uint8_t index;
+  instance_->audio->setCustomWaveform(patch.waveform_bank,
+                                      patch.waveform_index);
+  instance_->audio->applyCustomWaveform();
+  instance_->audio->getCustomWaveform(&bank, &index);
+
+  PolySynthState::setVoicePolicy(patch.steal_policy,
+                                 patch.retrigger_same_note != 0);
+
+  EepromStorage::saveSettings(patch.channel, ArpSynthState::arp_mode_steps,
+                              bank, index, PolySynthState::steal_policy,
+                              PolySynthState::retrigger_same_note);
+}
+
 } // namespace Autosave
\ No newline at end of file
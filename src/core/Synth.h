@@ -3,7 +3,9 @@
 
 #include "Audio.h"
 #include "Hardware.h"
+#include "LoopProfiler.h"
 #include "Midi.h"
+#include "Scheduler.h"
 #include "states/State.h"
 
 namespace Autosave {
@@ -12,9 +14,22 @@ class Synth {
 private:
   inline static Synth *instance_ = nullptr;
   State *state_;
+  Scheduler scheduler_;
+  LoopProfiler profiler_;
+  LoopProfiler::Report profile_ = {}; // refreshed by the telemetry task
+  uint32_t telemetry_runs_ = 0;
 
+  static void midiTask(void *ctx);
+  static void controlsTask(void *ctx);
+  static void telemetryTask(void *ctx);
+
+  void processMidi();
+  void processControls();
+  void updateTelemetry();
   void updateMode();
   void debugAudioUsage();
+  void debugLoopProfile();
+  void debugSchedule();
 
 public:
   Synth();
@@ -24,17 +39,28 @@ public:
   Hardware *hardware;
 
   void begin();
+  /** One main loop pass: MIDI, then at most one periodic task. */
   void process();
+  const Scheduler &scheduler() const { return scheduler_; }
   void changeState(State *state);
 
   static void midiNoteOn(uint8_t channel, uint8_t note, uint8_t velocity);
   static void midiNoteOff(uint8_t channel, uint8_t note, uint8_t velocity);
 
   static void customWaveformSysexGetter(uint8_t *bank, uint8_t *index);
-  static void customWaveformSysexSetter(uint8_t bank, uint8_t index);
+  static bool customWaveformSysexSetter(uint8_t bank, uint8_t index);
+
+  static void voicePolicySysexGetter(uint8_t *steal_policy,
+                                     uint8_t *retrigger_same_note);
+  static void voicePolicySysexSetter(uint8_t steal_policy,
+                                     uint8_t retrigger_same_note);
 
   static void arpStepsSysexGetter(uint8_t mode, uint8_t *len, uint8_t *data);
   static void arpStepsSysexSetter(uint8_t mode, uint8_t len, const uint8_t *data);
+
+  static void loopProfileSysexGetter(LoopProfiler::Report *report);
+
+  static void patchSysexSetter(const AutosaveLib::sysex::Patch &patch);
 };
 
 } // namespace Autosave
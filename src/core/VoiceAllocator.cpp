@@ -0,0 +1,276 @@
+#include "VoiceAllocator.h"
+
+namespace Autosave {
+
+template <uint8_t N>
+VoiceAllocator<N>::VoiceAllocator() {
+  reset();
+}
+
+template <uint8_t N>
+void VoiceAllocator<N>::reset() {
+  clear();
+  stolen_count_ = 0;
+
+  for (uint8_t voice = 0; voice < N / group_size_; voice++) {
+    place(LIST_FREE, voice, kNoNote, 0);
+  }
+}
+
+/**
+ * Rebuild the lists for the new size. Old groups are visited list by list,
+ * each oldest first, so every list keeps its order: first the part of each
+ * old group that keeps its state, then the split-off parts (older releases
+ * before the holds that were just split), then whatever voices no old group
+ * covered (N not a multiple of the old size).
+ */
+template <uint8_t N>
+void VoiceAllocator<N>::setGroupSize(uint8_t size) {
+  if (size == 0 || size > N) {
+    size = 1;
+  }
+  if (size == group_size_) {
+    return;
+  }
+
+  const List kOrder[] = {LIST_HELD, LIST_RELEASED, LIST_FREE};
+  uint8_t order[N];
+  List old_list[N];
+  uint8_t old_note[N];
+  uint8_t old_level[N];
+  uint8_t old_count = 0;
+  for (List list : kOrder) {
+    for (uint8_t v = head_[list]; v != kNoVoice; v = next_[v]) {
+      order[old_count++] = v;
+      old_list[v] = list;
+      old_note[v] = note_[v];
+      old_level[v] = level_[v];
+    }
+  }
+
+  const uint8_t old_size = group_size_;
+  const uint8_t groups = N / size;
+  group_size_ = size;
+  clear();
+
+  bool placed[N] = {};
+  for (uint8_t i = 0; i < old_count; i++) {
+    const uint8_t old_group = order[i];
+    const uint8_t group = old_group * old_size / size;
+    if (group < groups && !placed[group]) {
+      place(old_list[old_group], group, old_note[old_group],
+            old_level[old_group]);
+      placed[group] = true;
+    }
+  }
+
+  if (size < old_size) {
+    const List kPartOrder[] = {LIST_RELEASED, LIST_HELD, LIST_FREE};
+    for (List list : kPartOrder) {
+      for (uint8_t i = 0; i < old_count; i++) {
+        const uint8_t old_group = order[i];
+        if (old_list[old_group] != list) {
+          continue;
+        }
+        const uint8_t first = old_group * old_size / size;
+        for (uint8_t group = first + 1; group < first + old_size / size;
+             group++) {
+          place(list == LIST_FREE ? LIST_FREE : LIST_RELEASED, group, kNoNote,
+                0);
+          placed[group] = true;
+        }
+      }
+    }
+  }
+
+  for (uint8_t group = 0; group < groups; group++) {
+    if (!placed[group]) {
+      place(LIST_FREE, group, kNoNote, 0);
+    }
+  }
+}
+
+template <uint8_t N>
+uint8_t VoiceAllocator<N>::noteOn(uint8_t note, uint8_t velocity) {
+  note &= 0x7F;
+  reclaim();
+
+  uint8_t voice = voice_of_note_[note];
+  if (voice != kNoVoice && list_[voice] != LIST_HELD &&
+      !retrigger_same_note_) {
+    // Let the tail ring out and give the note a voice of its own.
+    voice_of_note_[note] = kNoVoice;
+    voice = kNoVoice;
+  }
+
+  if (voice == kNoVoice) {
+    if (head_[LIST_FREE] != kNoVoice) {
+      voice = head_[LIST_FREE];
+    } else if (head_[LIST_RELEASED] != kNoVoice) {
+      voice = head_[LIST_RELEASED];
+    } else {
+      voice = steal();
+      if (voice == kNoVoice) {
+        return kNoVoice;
+      }
+    }
+    forgetNote(voice);
+  }
+
+  unlink(voice);
+  note_[voice] = note;
+  level_[voice] = (velocity & 0x7F) >> 4;
+  voice_of_note_[note] = voice;
+  pushBack(LIST_HELD, voice);
+  return voice;
+}
+
+template <uint8_t N>
+uint8_t VoiceAllocator<N>::noteOff(uint8_t note) {
+  const uint8_t voice = voice_of_note_[note & 0x7F];
+  if (voice == kNoVoice || list_[voice] != LIST_HELD) {
+    return kNoVoice;
+  }
+  // The note stays mapped to the voice for same-note retrigger.
+  unlink(voice);
+  pushBack(LIST_RELEASED, voice);
+  return voice;
+}
+
+template <uint8_t N>
+bool VoiceAllocator<N>::holds(uint8_t note) const {
+  const uint8_t voice = voice_of_note_[note & 0x7F];
+  return voice != kNoVoice && list_[voice] == LIST_HELD;
+}
+
+template <uint8_t N>
+uint16_t VoiceAllocator<N>::heldMask() const {
+  uint16_t mask = 0;
+  for (uint8_t i = 0; i < kLevelBuckets; i++) {
+    mask |= level_voices_[i];
+  }
+  return mask;
+}
+
+/** Empty every list and the note map. */
+template <uint8_t N>
+void VoiceAllocator<N>::clear() {
+  for (uint8_t list = 0; list < LIST_COUNT; list++) {
+    head_[list] = kNoVoice;
+    tail_[list] = kNoVoice;
+    count_[list] = 0;
+  }
+  for (uint8_t i = 0; i < 128; i++) {
+    voice_of_note_[i] = kNoVoice;
+  }
+  for (uint8_t i = 0; i < kLevelBuckets; i++) {
+    level_voices_[i] = 0;
+  }
+  level_mask_ = 0;
+}
+
+template <uint8_t N>
+void VoiceAllocator<N>::place(List list, uint8_t voice, uint8_t note,
+                              uint8_t level) {
+  note_[voice] = note;
+  level_[voice] = level;
+  if (note != kNoNote) {
+    voice_of_note_[note] = voice;
+  }
+  pushBack(list, voice);
+}
+
+template <uint8_t N>
+void VoiceAllocator<N>::unlink(uint8_t voice) {
+  const List list = list_[voice];
+  if (prev_[voice] != kNoVoice) {
+    next_[prev_[voice]] = next_[voice];
+  } else {
+    head_[list] = next_[voice];
+  }
+  if (next_[voice] != kNoVoice) {
+    prev_[next_[voice]] = prev_[voice];
+  } else {
+    tail_[list] = prev_[voice];
+  }
+  count_[list]--;
+
+  if (list == LIST_HELD) {
+    const uint8_t level = level_[voice];
+    level_voices_[level] &= ~(1u << voice);
+    if (level_voices_[level] == 0) {
+      level_mask_ &= ~(1u << level);
+    }
+  }
+}
+
+template <uint8_t N>
+void VoiceAllocator<N>::pushBack(List list, uint8_t voice) {
+  list_[voice] = list;
+  prev_[voice] = tail_[list];
+  next_[voice] = kNoVoice;
+  if (tail_[list] != kNoVoice) {
+    next_[tail_[list]] = voice;
+  } else {
+    head_[list] = voice;
+  }
+  tail_[list] = voice;
+  count_[list]++;
+
+  if (list == LIST_HELD) {
+    level_voices_[level_[voice]] |= 1u << voice;
+    level_mask_ |= 1u << level_[voice];
+  }
+}
+
+/**
+ * Move finished release tails to the free list. Releases end in the order
+ * they started, so this stops at the first voice still sounding; each voice
+ * is checked once per release, plus once per call.
+ */
+template <uint8_t N>
+void VoiceAllocator<N>::reclaim() {
+  if (query_ == nullptr) {
+    return;
+  }
+  while (head_[LIST_RELEASED] != kNoVoice &&
+         !query_(head_[LIST_RELEASED], query_ctx_)) {
+    const uint8_t voice = head_[LIST_RELEASED];
+    unlink(voice);
+    pushBack(LIST_FREE, voice);
+  }
+}
+
+template <uint8_t N>
+uint8_t VoiceAllocator<N>::steal() {
+  uint8_t voice = kNoVoice;
+  switch (steal_policy_) {
+  case STEAL_OLDEST:
+    voice = head_[LIST_HELD];
+    break;
+  case STEAL_QUIETEST:
+    if (level_mask_ != 0) {
+      const uint16_t voices = level_voices_[__builtin_ctz(level_mask_)];
+      voice = __builtin_ctz(voices);
+    }
+    break;
+  case STEAL_NONE:
+    break;
+  }
+  if (voice != kNoVoice) {
+    stolen_count_++;
+  }
+  return voice;
+}
+
+template <uint8_t N>
+void VoiceAllocator<N>::forgetNote(uint8_t voice) {
+  if (note_[voice] != kNoNote && voice_of_note_[note_[voice]] == voice) {
+    voice_of_note_[note_[voice]] = kNoVoice;
+  }
+  note_[voice] = kNoNote;
+}
+
+template class VoiceAllocator<audio_config::voices_number>;
+
+} // namespace Autosave
@@ -0,0 +1,127 @@
+#ifndef AUTOSAVE_VOICE_ALLOCATOR_H
+#define AUTOSAVE_VOICE_ALLOCATOR_H
+
+#include <cstdint>
+
+#include "core/AudioConfig.h"
+
+namespace Autosave {
+
+/**
+ * Picks the voice for each note in poly mode. Every operation is O(1): voices
+ * sit in one of three intrusive lists, a note-to-voice map finds note offs,
+ * and held voices are also bucketed by velocity for quietest-first stealing.
+ *
+ * - free: envelope finished, reused first
+ * - released: note off, release tail still sounding, oldest release first
+ * - held: note on, oldest first
+ *
+ * A released voice moves to the free list once its envelope is idle, as told
+ * by the activity query. Releases all last the same time, so only the oldest
+ * one needs checking. When no voice is free, the oldest release tail (the
+ * most faded) is taken, and only then is a held voice stolen.
+ *
+ * Voices can also be handed out in groups of consecutive voices (unison, see
+ * setGroupSize()): every index in and out of the allocator is then a group,
+ * whose voices are group * size to group * size + size - 1.
+ *
+ * N is the number of voices; VoiceAllocator.cpp instantiates it for
+ * audio_config::voices_number.
+ */
+template <uint8_t N> class VoiceAllocator {
+  static_assert(N <= 16, "VoiceAllocator keeps voices in 16-bit masks");
+
+public:
+  static constexpr uint8_t kNoVoice = 0xFF;
+
+  /** Which held voice gives way when all of them are busy. */
+  enum StealPolicy : uint8_t {
+    STEAL_OLDEST,   // the note held the longest
+    STEAL_QUIETEST, // the lowest velocity (sustain level), in steps of 16
+    STEAL_NONE,     // drop the new note
+  };
+
+  /** True while the voice's envelope is still producing sound. */
+  using ActivityQuery = bool (*)(uint8_t voice, void *ctx);
+
+  VoiceAllocator();
+
+  void setActivityQuery(ActivityQuery query, void *ctx) {
+    query_ = query;
+    query_ctx_ = ctx;
+  }
+  void setStealPolicy(StealPolicy policy) { steal_policy_ = policy; }
+  /**
+   * On: a note still held or still in its release tail comes back on the
+   * same voice. Off: a released note gets a fresh voice (a held note is
+   * always retriggered in place).
+   */
+  void setRetriggerSameNote(bool enabled) { retrigger_same_note_ = enabled; }
+
+  /** Every voice free, no note held. The group size is kept. */
+  void reset();
+
+  /**
+   * Hand out groups of `size` voices (N / size groups), keeping the notes
+   * where they sound. A split group keeps its note in its first part; the
+   * other parts join the released list (the caller releases their voices).
+   * Merged groups take the state of their busiest part (held, released, then
+   * free), so merge while no note is held.
+   */
+  void setGroupSize(uint8_t size);
+  uint8_t groupSize() const { return group_size_; }
+
+  /** Voice for a new note, or kNoVoice (STEAL_NONE and every voice held). */
+  uint8_t noteOn(uint8_t note, uint8_t velocity);
+  /** Voice to release, or kNoVoice if the note is not held (or was stolen). */
+  uint8_t noteOff(uint8_t note);
+
+  /** True while `note` holds a voice: noteOn() would retrigger it there. */
+  bool holds(uint8_t note) const;
+  uint8_t heldCount() const { return count_[LIST_HELD]; }
+  uint8_t releasedCount() const { return count_[LIST_RELEASED]; }
+  /** Bit g set while group g holds a note. */
+  uint16_t heldMask() const;
+  /** Held notes that lost their voice to a newer one since reset(). */
+  uint32_t stolenCount() const { return stolen_count_; }
+
+private:
+  enum List : uint8_t { LIST_FREE, LIST_RELEASED, LIST_HELD, LIST_COUNT };
+
+  static constexpr uint8_t kNoNote = 0xFF;
+  static constexpr uint8_t kLevelBuckets = 8; // velocity >> 4
+
+  uint8_t next_[N];
+  uint8_t prev_[N];
+  List list_[N];
+  uint8_t head_[LIST_COUNT];
+  uint8_t tail_[LIST_COUNT];
+  uint8_t count_[LIST_COUNT];
+
+  uint8_t note_[N];
+  uint8_t level_[N];
+  uint8_t voice_of_note_[128];
+
+  /** Held voices by velocity bucket, and which buckets are not empty. */
+  uint16_t level_voices_[kLevelBuckets];
+  uint8_t level_mask_ = 0;
+
+  ActivityQuery query_ = nullptr;
+  void *query_ctx_ = nullptr;
+  StealPolicy steal_policy_ = STEAL_OLDEST;
+  bool retrigger_same_note_ = true;
+  uint8_t group_size_ = 1;
+  uint32_t stolen_count_ = 0;
+
+  void clear();
+  void place(List list, uint8_t voice, uint8_t note, uint8_t level);
+  void unlink(uint8_t voice);
+  void pushBack(List list, uint8_t voice);
+  void reclaim();
+  uint8_t steal();
+  void forgetNote(uint8_t voice);
+};
+
+} // namespace Autosave
+
+#endif
@@ -0,0 +1,584 @@
+#include "VoiceBank.h"
+
+#include <array>
+#include <dspinst.h>
+#include <synth_waveform.h>
+
+#include "lib/FastMath.h"
+
+namespace {
+constexpr float kPhaseToCycles = 1.0f / 4294967296.0f;
+constexpr float kFullScale = 32767.0f;
+
+// Same default as AudioSynthWaveformModulated.
+constexpr uint32_t kDefaultModulationFactor = 32768; // 8 octaves
+
+// Scheduled events land on the envelope's 8-sample grid.
+constexpr uint8_t kEventOffsetMask = 0xF8;
+
+// Random-walk drift: max offset ±this many cents; small steps make it wander.
+constexpr float kDriftCentsAmplitude = 0.2f;
+// Step size per walk step (cents); smaller = smoother, larger = more unstable.
+constexpr float kDriftStepCents = 0.08f;
+// One walk step every this many blocks (~29 ms); the pitch glides in between.
+constexpr uint8_t kDriftUpdateBlocks = 10;
+// The walk moves in integer steps: kDriftSteps of them span
+// kDriftCentsAmplitude, fine enough to be inaudible.
+constexpr int16_t kDriftSteps = 128;
+constexpr uint16_t kDriftMaxStep =
+    (uint16_t)(kDriftStepCents / kDriftCentsAmplitude * kDriftSteps + 0.5f);
+
+// Frequency ratio 2^(cents/1200) of every drift position, so the walk does no
+// transcendental math. The exponent stays below 2e-4, where three series
+// terms are exact in float.
+constexpr std::array<float, 2 * kDriftSteps + 1> driftRatios() {
+  std::array<float, 2 * kDriftSteps + 1> ratios{};
+  for (int i = 0; i <= 2 * kDriftSteps; i++) {
+    double x = (i - kDriftSteps) * (double)kDriftCentsAmplitude /
+               kDriftSteps * 0.69314718055994531 / 1200.0;
+    ratios[i] = (float)(1.0 + x + x * x / 2.0 + x * x * x / 6.0);
+  }
+  return ratios;
+}
+constexpr std::array<float, 2 * kDriftSteps + 1> kDriftRatios = driftRatios();
+
+constexpr float kMaxIncrement = 0x7FFE0000;
+
+inline float frequencyToIncrement(float frequency) {
+  if (frequency < 0.0f) {
+    frequency = 0.0f;
+  } else if (frequency > AUDIO_SAMPLE_RATE_EXACT / 2.0f) {
+    frequency = AUDIO_SAMPLE_RATE_EXACT / 2.0f;
+  }
+  return frequency * (4294967296.0f / AUDIO_SAMPLE_RATE_EXACT);
+}
+
+// PolyBLEP residual for a unit step at phase 0, t and dt in cycles.
+inline float polyBlep(float t, float dt) {
+  if (t < dt) {
+    float x = t / dt;
+    return x + x - x * x - 1.0f;
+  }
+  if (t > 1.0f - dt) {
+    float x = (t - 1.0f) / dt;
+    return x * x + x + x + 1.0f;
+  }
+  return 0.0f;
+}
+} // namespace
+
+namespace Autosave {
+
+template <uint8_t N>
+VoiceBank<N>::VoiceBank()
+    : AudioStream(1, inputQueueArray),
+      waveform_(WAVEFORM_BANDLIMIT_SAWTOOTH_REVERSE), arbdata_(nullptr),
+      modulation_factor_(kDefaultModulationFactor), master_gain_(1.0f),
+      master_gain_target_(1.0f) {
+  for (uint8_t i = 0; i < N; i++) {
+    voices_[i] = {};
+    voices_[i].gain = 1.0f;
+    voices_[i].detune = 1.0f;
+    voices_[i].spread = 1.0f;
+    voices_[i].pitch_ratio = 1.0f;
+    voices_[i].drift_ratio = 1.0f;
+    envelope_levels_[kEnvelopeSteps][i] = 0.0f;
+  }
+}
+
+template <uint8_t N>
+void VoiceBank<N>::waveform(uint8_t waveform) { waveform_ = waveform; }
+
+template <uint8_t N>
+void VoiceBank<N>::arbitraryWaveform(const int16_t *data) {
+  arbdata_ = data;
+}
+
+template <uint8_t N>
+void VoiceBank<N>::frequencyModulation(float octaves) {
+  if (octaves > 12.0f) {
+    octaves = 12.0f;
+  } else if (octaves < 0.1f) {
+    octaves = 0.1f;
+  }
+  modulation_factor_ = octaves * 4096.0f;
+}
+
+template <uint8_t N>
+void VoiceBank<N>::frequency(uint8_t voice, float frequency) {
+  this->frequency(voice, 1, frequency);
+}
+
+template <uint8_t N>
+void VoiceBank<N>::frequency(uint8_t first, uint8_t count, float frequency) {
+  applyEvent(prepare({0, EVENT_FREQUENCY, first, count, frequency}));
+}
+
+template <uint8_t N>
+void VoiceBank<N>::detune(uint8_t voice, float ratio) {
+  voices_[voice].detune = ratio;
+  voices_[voice].pitch_ratio = ratio * voices_[voice].spread;
+  updateIncrement(voices_[voice]);
+}
+
+template <uint8_t N>
+void VoiceBank<N>::spread(uint8_t first, uint8_t count, float cents) {
+  applyEvent(prepare({0, EVENT_SPREAD, first, count, cents}));
+}
+
+/**
+ * Convert the value of a span event once, for all of its voices: a pitch to
+ * a phase increment, a spread to the ratio of its first voice and the step
+ * between voices (an even spread is a geometric series).
+ */
+template <uint8_t N>
+typename VoiceBank<N>::Event VoiceBank<N>::prepare(Event event) {
+  switch (event.type) {
+  case EVENT_FREQUENCY:
+    event.value = frequencyToIncrement(event.value);
+    break;
+  case EVENT_SPREAD: {
+    const float cents = event.value;
+    event.value = 1.0f;
+    event.step = 1.0f;
+    if (event.count > 1) {
+      event.value = AutosaveLib::fast_math::centsToRatio(-0.5f * cents);
+      event.step =
+          AutosaveLib::fast_math::centsToRatio(cents / (event.count - 1));
+    }
+  } break;
+  default:
+    break;
+  }
+  return event;
+}
+
+template <uint8_t N>
+void VoiceBank<N>::driftSeed(uint32_t seed) {
+  for (uint8_t i = 0; i < N; i++) {
+    drift_rng_[i].seed(seed + i);
+    voices_[i].drift_step = 0;
+    voices_[i].drift_ratio = 1.0f;
+    voices_[i].drift_ratio_step = 0.0f;
+    updateIncrement(voices_[i]);
+  }
+  drift_blocks_ = 0;
+}
+
+template <uint8_t N>
+void VoiceBank<N>::updateIncrement(Voice &voice) {
+  float increment = (float)voice.base_increment * voice.pitch_ratio *
+                    voice.drift_ratio * transpose_;
+  voice.phase_increment =
+      increment < kMaxIncrement ? (uint32_t)increment : (uint32_t)kMaxIncrement;
+}
+
+/**
+ * Move every voice's drift one block along its glide; every
+ * kDriftUpdateBlocks, take a random-walk step and glide to it over the next
+ * kDriftUpdateBlocks blocks.
+ */
+template <uint8_t N>
+void VoiceBank<N>::advanceDrift() {
+  const bool walk = ++drift_blocks_ >= kDriftUpdateBlocks;
+  if (walk) {
+    drift_blocks_ = 0;
+  }
+  for (uint8_t i = 0; i < N; i++) {
+    Voice &voice = voices_[i];
+    if (walk) {
+      // Land exactly on the previous target, then aim for the next one.
+      voice.drift_ratio = kDriftRatios[voice.drift_step + kDriftSteps];
+      int16_t step = voice.drift_step + drift_rng_[i].bipolar(kDriftMaxStep);
+      if (step > kDriftSteps) {
+        step = kDriftSteps;
+      } else if (step < -kDriftSteps) {
+        step = -kDriftSteps;
+      }
+      voice.drift_step = step;
+      voice.drift_ratio_step =
+          (kDriftRatios[step + kDriftSteps] - voice.drift_ratio) *
+          (1.0f / kDriftUpdateBlocks);
+    } else {
+      voice.drift_ratio += voice.drift_ratio_step;
+    }
+    updateIncrement(voice);
+  }
+}
+
+template <uint8_t N>
+void VoiceBank<N>::amplitude(uint8_t voice, float amplitude) {
+  if (amplitude < 0.0f) {
+    amplitude = 0.0f;
+  } else if (amplitude > 1.0f) {
+    amplitude = 1.0f;
+  }
+  voices_[voice].amplitude = amplitude;
+}
+
+template <uint8_t N>
+void VoiceBank<N>::gain(uint8_t voice, float gain) {
+  voices_[voice].gain = gain;
+}
+
+template <uint8_t N>
+void VoiceBank<N>::masterGain(float gain) { master_gain_target_ = gain; }
+
+template <uint8_t N>
+void VoiceBank<N>::attack(float milliseconds) {
+  envelopes_.attack(milliseconds);
+}
+
+template <uint8_t N>
+void VoiceBank<N>::hold(float milliseconds) {
+  envelopes_.hold(milliseconds);
+}
+
+template <uint8_t N>
+void VoiceBank<N>::decay(float milliseconds) {
+  envelopes_.decay(milliseconds);
+}
+
+template <uint8_t N>
+void VoiceBank<N>::sustain(float level) { envelopes_.sustain(level); }
+
+template <uint8_t N>
+void VoiceBank<N>::release(float milliseconds) {
+  envelopes_.release(milliseconds);
+}
+
+template <uint8_t N>
+void VoiceBank<N>::releaseNoteOn(float milliseconds) {
+  envelopes_.releaseNoteOn(milliseconds);
+}
+
+template <uint8_t N>
+void VoiceBank<N>::noteOn(uint8_t voice, float peak) {
+  envelopes_.noteOn(voice, peak);
+}
+
+template <uint8_t N>
+void VoiceBank<N>::noteOff(uint8_t voice) {
+  envelopes_.noteOff(voice);
+}
+
+template <uint8_t N>
+bool VoiceBank<N>::active(uint8_t voice) const {
+  return envelopes_.active(voice);
+}
+
+template <uint8_t N>
+uint8_t VoiceBank<N>::schedule(uint8_t offset, EventType type, uint8_t voice,
+                               float value, uint8_t count) {
+  if (offset >= AUDIO_BLOCK_SAMPLES) {
+    offset = AUDIO_BLOCK_SAMPLES - 1;
+  }
+  Event event = {(uint8_t)(offset & kEventOffsetMask), type, voice, count,
+                 value};
+
+  if (event_count_ >= kMaxEvents) {
+    // Never ahead of a queued event: a note off must not overtake its note.
+    for (uint8_t e = 0; e < event_count_; e++) {
+      applyEvent(events_[e]);
+    }
+    event_count_ = 0;
+    event.offset = 0;
+  }
+  if (event.offset == 0) {
+    applyEvent(prepare(event));
+    return 0;
+  }
+  events_[event_count_++] = prepare(event);
+  return event.offset;
+}
+
+template <uint8_t N>
+void VoiceBank<N>::applyEvent(Event event) {
+  const uint8_t end = event.voice + event.count < N ? event.voice + event.count
+                                                    : N;
+  for (uint8_t voice = event.voice; voice < end; voice++) {
+    switch (event.type) {
+    case EVENT_NOTE_ON:
+      noteOn(voice, event.value);
+      break;
+    case EVENT_NOTE_OFF:
+      noteOff(voice);
+      break;
+    default:
+      applyVoiceEvent(event, voice);
+      break;
+    }
+  }
+}
+
+/**
+ * Apply a prepared oscillator event to one voice of its span. Voices must
+ * come in order: a spread event moves on to the next voice's ratio.
+ */
+template <uint8_t N>
+void VoiceBank<N>::applyVoiceEvent(Event &event, uint8_t index) {
+  Voice &voice = voices_[index];
+  switch (event.type) {
+  case EVENT_FREQUENCY:
+    voice.base_increment = event.value;
+    updateIncrement(voice);
+    break;
+  case EVENT_AMPLITUDE:
+    amplitude(index, event.value);
+    break;
+  case EVENT_SPREAD:
+    voice.spread = event.value;
+    voice.pitch_ratio = voice.detune * event.value;
+    updateIncrement(voice);
+    event.value *= event.step;
+    break;
+  default:
+    break;
+  }
+}
+
+template <uint8_t N>
+void VoiceBank<N>::update(void) {
+  audio_block_t *moddata = receiveReadOnly(0);
+  const bool modulated = moddata != nullptr;
+  if (modulated) {
+    computeModulation(moddata->data);
+    release(moddata);
+  }
+
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+    mix_buffer_[i] = 0.0f;
+  }
+
+  advanceDrift();
+  advanceEnvelopes();
+
+  bool playing = false;
+  for (uint8_t i = 0; i < N; i++) {
+    // Render up to each oscillator event of this voice, apply it, then carry
+    // on. Note events were applied by advanceEnvelopes().
+    int from = 0;
+    for (uint8_t e = 0; e < event_count_; e++) {
+      Event &event = events_[e];
+      if (i < event.voice || i >= event.voice + event.count ||
+          event.type == EVENT_NOTE_ON || event.type == EVENT_NOTE_OFF) {
+        continue;
+      }
+      if (event.offset > from) {
+        playing |= renderSegment(i, modulated, from, event.offset);
+        from = event.offset;
+      }
+      applyVoiceEvent(event, i);
+    }
+    playing |= renderSegment(i, modulated, from, AUDIO_BLOCK_SAMPLES);
+  }
+  event_count_ = 0;
+
+  // Nothing to ramp across when silent: take the new gain right away.
+  float gain = master_gain_;
+  const float step =
+      (master_gain_target_ - gain) * (1.0f / AUDIO_BLOCK_SAMPLES);
+  master_gain_ = master_gain_target_;
+
+  if (!playing) {
+    return;
+  }
+
+  audio_block_t *block = allocate();
+  if (!block) {
+    return;
+  }
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+    gain += step;
+    int32_t sample = (int32_t)(mix_buffer_[i] * gain);
+    block->data[i] = signed_saturate_rshift(sample, 16, 0);
+  }
+  transmit(block);
+  release(block);
+}
+
+template <uint8_t N>
+void VoiceBank<N>::computeModulation(const int16_t *data) {
+  for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+    int32_t n = data[i] * (int32_t)modulation_factor_; // octaves to mod
+    int32_t ipart = n >> 27;                             // 4 integer bits
+    n &= 0x7FFFFFF;                                      // 27 fraction bits
+    // exp2 algorithm by Laurent de Soras
+    n = (n + 134217728) << 3;
+    n = multiply_32x32_rshift32_rounded(n, n);
+    n = multiply_32x32_rshift32_rounded(n, 715827883) << 3;
+    n = n + 715827882;
+    modulation_scale_[i] = (uint32_t)n >> (14 - ipart);
+  }
+}
+
+/**
+ * Run every envelope through the block, one step at a time, applying note
+ * events at their step, and keep the level of each voice at every step
+ * boundary. Voices whose envelope stays at zero all block are marked silent.
+ */
+template <uint8_t N>
+void VoiceBank<N>::advanceEnvelopes() {
+  constexpr uint8_t kStep = Envelopes<N>::kStepSamples;
+
+  for (uint8_t i = 0; i < N; i++) {
+    envelope_levels_[0][i] = envelope_levels_[kEnvelopeSteps][i];
+  }
+  uint8_t e = 0;
+  for (uint8_t step = 0; step < kEnvelopeSteps; step++) {
+    // Offsets never decrease through the event list.
+    for (; e < event_count_ && events_[e].offset <= step * kStep; e++) {
+      if (events_[e].type == EVENT_NOTE_ON ||
+          events_[e].type == EVENT_NOTE_OFF) {
+        applyEvent(events_[e]);
+      }
+    }
+    envelopes_.step();
+    for (uint8_t i = 0; i < N; i++) {
+      envelope_levels_[step + 1][i] = envelopes_.level(i);
+    }
+  }
+
+  sounding_voices_ = 0;
+  for (uint8_t step = 0; step <= kEnvelopeSteps; step++) {
+    for (uint8_t i = 0; i < N; i++) {
+      if (envelope_levels_[step][i] > 0.0f) {
+        sounding_voices_ |= 1u << i;
+      }
+    }
+  }
+}
+
+/**
+ * Render samples [from, to) of one voice into the mix. Returns false if the
+ * voice contributed nothing.
+ */
+template <uint8_t N>
+bool VoiceBank<N>::renderSegment(uint8_t index, bool modulated, int from,
+                                 int to) {
+  Voice &voice = voices_[index];
+  // Like the oscillator it replaces, the phase runs even when silent.
+  advancePhase(voice, modulated, from, to);
+  if (voice.amplitude == 0.0f || !(sounding_voices_ & (1u << index))) {
+    return false;
+  }
+
+  renderOscillator(voice, from, to);
+  applyEnvelope(index, from, to);
+  return true;
+}
+
+template <uint8_t N>
+void VoiceBank<N>::advancePhase(Voice &voice, bool modulated, int from,
+                                int to) {
+  uint32_t ph = voice.phase_accumulator;
+  const uint32_t inc = voice.phase_increment;
+
+  if (from == 0) {
+    voice.prior_phase = voice.last_phase;
+  }
+  if (modulated) {
+    for (int i = from; i < to; i++) {
+      uint64_t phstep = (uint64_t)inc * modulation_scale_[i];
+      if ((uint32_t)(phstep >> 32) < 0x7FFE) {
+        ph += phstep >> 16;
+      } else {
+        ph += 0x7FFE0000;
+      }
+      phasedata_[i] = ph;
+    }
+  } else {
+    for (int i = from; i < to; i++) {
+      phasedata_[i] = ph;
+      ph += inc;
+    }
+  }
+  voice.phase_accumulator = ph;
+  voice.last_phase = phasedata_[to - 1];
+}
+
+template <uint8_t N>
+void VoiceBank<N>::renderOscillator(const Voice &voice, int from, int to) {
+  const float scale = voice.amplitude * kFullScale;
+  float *out = voice_buffer_;
+  // Phase of the sample before `from`, for the band-limited steps.
+  const uint32_t prior = from == 0 ? voice.prior_phase : phasedata_[from - 1];
+
+  switch (waveform_) {
+  case WAVEFORM_ARBITRARY:
+    if (!arbdata_) {
+      for (int i = from; i < to; i++) {
+        out[i] = 0.0f;
+      }
+      break;
+    }
+    for (int i = from; i < to; i++) {
+      uint32_t ph = phasedata_[i];
+      uint32_t index = ph >> 24;
+      float val1 = arbdata_[index];
+      float val2 = arbdata_[(index + 1) & 0xFF];
+      float fraction = (float)((ph >> 8) & 0xFFFF) * (1.0f / 65536.0f);
+      out[i] = (val1 + (val2 - val1) * fraction) * voice.amplitude;
+    }
+    break;
+
+  case WAVEFORM_BANDLIMIT_SQUARE: {
+    uint32_t prev = prior;
+    for (int i = from; i < to; i++) {
+      uint32_t ph = phasedata_[i];
+      float dt = (float)(ph - prev) * kPhaseToCycles;
+      prev = ph;
+      float v = (ph & 0x80000000) ? -1.0f : 1.0f;
+      if (dt > 0.0f) {
+        v += polyBlep((float)ph * kPhaseToCycles, dt);
+        v -= polyBlep((float)(ph + 0x80000000u) * kPhaseToCycles, dt);
+      }
+      out[i] = v * scale;
+    }
+  } break;
+
+  default: {
+    // Band-limited sawtooth, rising ramp that wraps at half phase.
+    const float sign =
+        waveform_ == WAVEFORM_BANDLIMIT_SAWTOOTH ? scale : -scale;
+    uint32_t prev = prior;
+    for (int i = from; i < to; i++) {
+      uint32_t ph = phasedata_[i];
+      float dt = (float)(ph - prev) * kPhaseToCycles;
+      prev = ph;
+      float t = (float)(ph + 0x80000000u) * kPhaseToCycles;
+      float v = 2.0f * t - 1.0f;
+      if (dt > 0.0f) {
+        v -= polyBlep(t, dt);
+      }
+      out[i] = v * sign;
+    }
+  } break;
+  }
+}
+
+/**
+ * Scale voice_buffer_ [from, to) by the voice's envelope and gain and add it
+ * to the mix; both bounds are multiples of the envelope step.
+ */
+template <uint8_t N>
+void VoiceBank<N>::applyEnvelope(uint8_t index, int from, int to) {
+  constexpr uint8_t kStep = Envelopes<N>::kStepSamples;
+  const float gain = voices_[index].gain;
+  const float *in = voice_buffer_;
+  float *out = mix_buffer_;
+
+  for (int step = from / kStep; step < to / kStep; step++) {
+    float mult = envelope_levels_[step][index] * gain;
+    const float next = envelope_levels_[step + 1][index] * gain;
+    const float inc = (next - mult) * (1.0f / kStep);
+    for (int i = step * kStep; i < (step + 1) * kStep; i++) {
+      out[i] += in[i] * mult;
+      mult += inc;
+    }
+  }
+}
+
+template class VoiceBank<audio_config::voices_number>;
+
+} // namespace Autosave
@@ -0,0 +1,196 @@
+#ifndef AUTOSAVE_VOICE_BANK_H
+#define AUTOSAVE_VOICE_BANK_H
+
+#include <AudioStream.h>
+#include <cstdint>
+
+#include "core/AudioConfig.h"
+#include "core/Envelopes.h"
+#include "lib/Random.h"
+
+namespace Autosave {
+
+/**
+ * All synth voices in a single AudioStream: oscillator, ADSR envelope, gain
+ * and summing are rendered in one update() into one output block, instead of
+ * an oscillator → envelope → mixer tree → amplifier chain that allocates and
+ * copies a block at every node.
+ *
+ * Input 0 is the frequency modulation signal shared by every voice (same
+ * exp2 scaling as AudioSynthWaveformModulated). Band-limited shapes use
+ * PolyBLEP.
+ *
+ * The envelopes (see Envelopes) are advanced first, all voices at once, one
+ * 8-sample step at a time; each voice's oscillator is then scaled by its
+ * envelope, ramped linearly across each step.
+ *
+ * Per-voice changes can also be scheduled at a sample offset inside the next
+ * block (see schedule()), so note timing does not snap to block boundaries.
+ *
+ * Each voice has a fixed detune, a unison spread and a slow random pitch
+ * drift. All three scale the phase increment in the kernel, along with the
+ * transposition shared by every voice (e.g. a pitch CV). The drift glides
+ * block by block towards a new random-walk target, so there are no pitch
+ * steps and no frequency calls from outside.
+ *
+ * N is the number of voices; VoiceBank.cpp instantiates it for
+ * audio_config::voices_number.
+ */
+template <uint8_t N> class VoiceBank : public AudioStream {
+public:
+  VoiceBank();
+
+  /** WAVEFORM_BANDLIMIT_SAWTOOTH(_REVERSE), WAVEFORM_BANDLIMIT_SQUARE or
+   * WAVEFORM_ARBITRARY, for all voices. */
+  void waveform(uint8_t waveform);
+  /** 256-sample table used by WAVEFORM_ARBITRARY. */
+  void arbitraryWaveform(const int16_t *data);
+  /** FM depth for a full-scale input, in octaves (default 8). */
+  void frequencyModulation(float octaves);
+
+  /** Nominal pitch in Hz, before detune and drift. */
+  void frequency(uint8_t voice, float frequency);
+  /** Same pitch for voices [first, first + count), converted once. */
+  void frequency(uint8_t first, uint8_t count, float frequency);
+  /** Fixed pitch ratio of the voice (oscillator slop), 1.0 for none. */
+  void detune(uint8_t voice, float ratio);
+  /**
+   * Spread voices [first, first + count) evenly over `cents`, centred on the
+   * nominal pitch (unison). One voice, or 0 cents, means no spread.
+   */
+  void spread(uint8_t first, uint8_t count, float cents);
+  /** Pitch ratio of every voice from the next block on, 1.0 for none. */
+  void transpose(float ratio) { transpose_ = ratio; }
+  /** Seed the drift generators and restart every walk at the nominal pitch. */
+  void driftSeed(uint32_t seed);
+  /** A voice at amplitude 0 is silent; its envelope still runs. */
+  void amplitude(uint8_t voice, float amplitude);
+  /** Mix gain of the voice into the output. */
+  void gain(uint8_t voice, float gain);
+  /**
+   * Gain applied to the sum of all voices. Changes ramp linearly over the
+   * next block, so they never click.
+   */
+  void masterGain(float gain);
+
+  void attack(float milliseconds);
+  void hold(float milliseconds);
+  void decay(float milliseconds);
+  /** Fraction of each note's peak level held after the decay. */
+  void sustain(float level);
+  void release(float milliseconds);
+  /** Fade time when a note restarts a voice that is still sounding. */
+  void releaseNoteOn(float milliseconds);
+  using AudioStream::release;
+
+  /**
+   * Start the envelope towards `peak` (0 to 1, e.g. velocity). Like
+   * noteOff(), call from the audio update only (applyCommand, schedule):
+   * nothing else steps the envelopes, so nothing needs masking.
+   */
+  void noteOn(uint8_t voice, float peak = 1.0f);
+  void noteOff(uint8_t voice);
+  /**
+   * True until the voice's envelope has finished its release. Safe to call
+   * from the main loop: it reads a single byte.
+   */
+  bool active(uint8_t voice) const;
+
+  enum EventType : uint8_t {
+    EVENT_NOTE_ON, // value: peak level
+    EVENT_NOTE_OFF,
+    EVENT_FREQUENCY, // value in Hz
+    EVENT_AMPLITUDE,
+    EVENT_SPREAD, // value in cents
+  };
+
+  /**
+   * Apply a change to voices [voice, voice + count) `offset` samples into the
+   * next rendered block. Offsets are rounded down to the envelope step (8
+   * samples) and must not decrease between calls for the same block. Call
+   * from the audio update, before this node runs. Should the event list
+   * fill up, the queued changes and this one apply immediately, in order.
+   * Returns the offset actually used.
+   */
+  uint8_t schedule(uint8_t offset, EventType type, uint8_t voice,
+                   float value = 0.0f, uint8_t count = 1);
+
+  /** Changes schedule() can queue per block: one per audio command. */
+  static constexpr uint8_t kMaxEvents = 128;
+
+  virtual void update(void) override;
+
+private:
+  struct Voice {
+    uint32_t phase_accumulator;
+    uint32_t phase_increment; // base_increment with pitch and drift applied
+    uint32_t base_increment;  // nominal pitch
+    float detune;
+    float spread;
+    float pitch_ratio;      // detune * spread
+    float drift_ratio;      // glides to the ratio of drift_step
+    float drift_ratio_step; // change of drift_ratio per block
+    int16_t drift_step;     // random walk position, in table steps
+    uint32_t last_phase;  // phase of the last sample rendered
+    uint32_t prior_phase; // last_phase before the current block
+    float amplitude;
+    float gain;
+  };
+
+  struct Event {
+    uint8_t offset;
+    EventType type;
+    uint8_t voice;
+    uint8_t count;
+    float value;
+    float step; // EVENT_SPREAD, once prepared: ratio between voices
+  };
+
+  static constexpr uint8_t kEnvelopeSteps =
+      AUDIO_BLOCK_SAMPLES / Envelopes<N>::kStepSamples;
+
+  audio_block_t *inputQueueArray[1];
+  Voice voices_[N];
+
+  Event events_[kMaxEvents];
+  uint8_t event_count_ = 0;
+
+  /** Per-voice drift generators, so each voice wanders on its own. */
+  AutosaveLib::XorShift32 drift_rng_[N];
+  uint8_t drift_blocks_ = 0; // blocks since the last walk step
+
+  uint8_t waveform_;
+  const int16_t *arbdata_;
+  uint32_t modulation_factor_;
+  float master_gain_;        // gain at the start of the next block
+  float master_gain_target_; // reached at the end of the next block
+  float transpose_ = 1.0f;
+
+  Envelopes<N> envelopes_;
+  /** Envelope level of every voice at each step boundary of the block. */
+  float envelope_levels_[kEnvelopeSteps + 1][N];
+  uint16_t sounding_voices_ = 0; // envelope above zero this block, per voice
+
+  /** Per-sample phase scale (16.16) from the FM input, shared by all voices. */
+  uint32_t modulation_scale_[AUDIO_BLOCK_SAMPLES];
+  uint32_t phasedata_[AUDIO_BLOCK_SAMPLES];
+  float voice_buffer_[AUDIO_BLOCK_SAMPLES];
+  float mix_buffer_[AUDIO_BLOCK_SAMPLES];
+
+  void advanceDrift();
+  void updateIncrement(Voice &voice);
+  Event prepare(Event event);
+  /** Apply a prepared event to every voice of its span. */
+  void applyEvent(Event event);
+  void applyVoiceEvent(Event &event, uint8_t index);
+  void computeModulation(const int16_t *data);
+  void advanceEnvelopes();
+  bool renderSegment(uint8_t index, bool modulated, int from, int to);
+  void advancePhase(Voice &voice, bool modulated, int from, int to);
+  void renderOscillator(const Voice &voice, int from, int to);
+  void applyEnvelope(uint8_t index, int from, int to);
+};
+
+} // namespace Autosave
+
+#endif
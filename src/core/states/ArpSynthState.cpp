@@ -45,7 +45,12 @@ void ArpSynthState::begin() {
 
 void ArpSynthState::onMidiClock() {
   if (instance_ != nullptr) {
+    Synth *synth = instance_->synth_;
+
+    // Arp steps sound at the time the clock tick was read
+    synth->audio->beginCommands(synth->midi->eventCycles());
     instance_->onClockTick();
+    synth->audio->endCommands();
   }
 }
 
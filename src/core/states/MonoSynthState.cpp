@@ -12,7 +12,7 @@ void MonoSynthState::begin() {
 
   AutosaveLib::Logger::debug("MonoSynthState::begin");
 
-  AudioNoInterrupts();
+  synth_->audio->beginCommands();
 
   // Setup oscillators
   synth_->audio->updateOscillatorAmplitude(0, 1.0f);
@@ -23,38 +23,38 @@ void MonoSynthState::begin() {
 
   synth_->audio->normalizeMasterGain(3);
 
-  AudioInterrupts();
+  synth_->audio->endCommands();
 }
 
 void MonoSynthState::noteOn(MidiNote note) {
   current_note_ = note;
-  float sustain = (float)note.velocity / 127.0f;
+  float level = (float)note.velocity / 127.0f;
 
   float freq = Audio::computeFrequencyFromNote(note.number);
   float freq_2 = freq * detune_;
   float freq_sub = freq / 2.0f;
 
-  AudioNoInterrupts();
+  synth_->audio->beginCommands();
 
   synth_->audio->updateOscillatorFrequency(0, freq);
   synth_->audio->updateOscillatorFrequency(1, freq_2);
   synth_->audio->updateOscillatorFrequency(2, freq_sub);
 
-  synth_->audio->noteOn(0, sustain, true);
-  synth_->audio->noteOn(1, sustain);
-  synth_->audio->noteOn(2, sustain);
+  synth_->audio->noteOn(0, level, true);
+  synth_->audio->noteOn(1, level);
+  synth_->audio->noteOn(2, level);
 
-  AudioInterrupts();
+  synth_->audio->endCommands();
 }
 
 void MonoSynthState::noteOff(MidiNote note) {
-  AudioNoInterrupts();
+  synth_->audio->beginCommands();
 
   synth_->audio->noteOff(0, true);
   synth_->audio->noteOff(1);
   synth_->audio->noteOff(2);
 
-  AudioInterrupts();
+  synth_->audio->endCommands();
 }
 
 void MonoSynthState::process() {
@@ -1,104 +1,192 @@
 #include "PolySynthState.h"
 
 #include "core/Audio.h"
+#include "core/EepromStorage.h"
 #include "core/Hardware.h"
 #include "core/Synth.h"
 #include "lib/Logger.h"
+#include "lib/SysexProtocol.h"
+
+namespace {
+constexpr uint8_t kMaxUnison = 8;
+// Full spread of a unison stack, POT_1 at max. Below the minimum (POT_1 near
+// zero), unison is off and every note gets a single voice.
+constexpr float kMaxSpreadCents = 50.0f;
+constexpr float kMinSpreadCents = 1.0f;
+} // namespace
 
 namespace Autosave {
 
-void PolySynthState::begin() {
-  State::begin();
+// SysEx and EEPROM carry the steal policy as the enum value.
+static_assert(VoiceAllocator<1>::STEAL_NONE + 1 ==
+                  AutosaveLib::sysex::kStealPolicies,
+              "kStealPolicies must match VoiceAllocator::StealPolicy");
 
-  AutosaveLib::Logger::debug("PolySynthState::begin");
-}
+PolySynthState *PolySynthState::instance_ = nullptr;
 
-void PolySynthState::noteOn(MidiNote note) {
-  if (note_count_ >= audio_config::voices_number) {
-    return;
-  }
+uint8_t PolySynthState::steal_policy = EepromStorage::kStealPolicyDefault;
+bool PolySynthState::retrigger_same_note =
+    EepromStorage::kRetriggerSameNoteDefault;
 
-  uint8_t index = 0;
+PolySynthState::~PolySynthState() { instance_ = nullptr; }
 
-  // Looking for the first empty oscillator
-  while (index < audio_config::voices_number) {
-    if (current_notes_[index].number == 0) {
-      break;
-    }
-
-    index++;
+void PolySynthState::setVoicePolicy(uint8_t policy, bool retrigger) {
+  if (policy >= AutosaveLib::sysex::kStealPolicies) {
+    return;
   }
+  steal_policy = policy;
+  retrigger_same_note = retrigger;
+  if (instance_ != nullptr) {
+    instance_->voices_.setStealPolicy(
+        static_cast<Voices::StealPolicy>(policy));
+    instance_->voices_.setRetriggerSameNote(retrigger);
+  }
+}
 
-  current_notes_[index] = note;
-  note_count_++;
-
-  float sustain = (float)note.velocity / 127.0f;
-  float freq = Audio::computeFrequencyFromNote(note.number);
+void PolySynthState::begin() {
+  State::begin();
 
-  AudioNoInterrupts();
+  instance_ = this;
+  voices_.setGroupSize(unisonSize(1));
+  voices_.reset();
+  voices_.setActivityQuery(&PolySynthState::voiceActive, this);
+  voices_.setStealPolicy(static_cast<Voices::StealPolicy>(steal_policy));
+  voices_.setRetriggerSameNote(retrigger_same_note);
+  gated_voices_ = 0;
 
-  synth_->audio->normalizeMasterGain(note_count_);
-  synth_->audio->updateOscillatorFrequency(index, freq);
-  synth_->audio->updateOscillatorAmplitude(index, 1.0f);
+  AutosaveLib::Logger::debug("PolySynthState::begin");
+}
 
-  synth_->audio->noteOn(index, sustain, note_count_ == 1);
+bool PolySynthState::voiceActive(uint8_t group, void *ctx) {
+  const auto *state = static_cast<const PolySynthState *>(ctx);
+  const uint8_t size = state->voices_.groupSize();
+  for (uint8_t voice = group * size; voice < (group + 1) * size; voice++) {
+    if (state->synth_->audio->voiceActive(voice)) {
+      return true;
+    }
+  }
+  return false;
+}
 
-  AudioInterrupts();
+/** Voices per note when `notes` notes are held: the widest stack that fits. */
+uint8_t PolySynthState::unisonSize(uint8_t notes) const {
+  if (spread_cents_ < kMinSpreadCents) {
+    return 1;
+  }
+  uint8_t size = kMaxUnison;
+  while (size > 1 && notes * size > audio_config::voices_number) {
+    size /= 2;
+  }
+  return size;
 }
 
-void PolySynthState::noteOff(MidiNote note) {
-  if (note_count_ <= 0 || note_count_ >= audio_config::voices_number) {
+/**
+ * Resize the unison stacks for `notes` held notes. Stacks only grow back once
+ * every note is released, so a held note never moves; when they shrink, held
+ * notes keep the first part of their stack and the rest is released.
+ */
+void PolySynthState::regroup(uint8_t notes) {
+  const uint8_t size = unisonSize(notes);
+  const uint8_t current = voices_.groupSize();
+  if (size == current || (size > current && voices_.heldCount() > 0)) {
     return;
   }
+  voices_.setGroupSize(size);
+
+  uint16_t held_voices = 0;
+  uint16_t groups = voices_.heldMask();
+  while (groups != 0) {
+    const uint8_t group = __builtin_ctz(groups);
+    groups &= groups - 1;
+    held_voices |= ((1u << size) - 1) << (group * size);
+  }
+  uint16_t released = gated_voices_ & ~held_voices;
+  while (released != 0) {
+    synth_->audio->noteOff(__builtin_ctz(released));
+    released &= released - 1;
+  }
+  gated_voices_ = held_voices;
+}
 
-  uint8_t index = 0;
+void PolySynthState::updateSpread() {
+  const uint8_t size = voices_.groupSize();
+  if (size == 1) {
+    return;
+  }
+  synth_->audio->beginCommands();
+  for (uint8_t first = 0; first + size <= audio_config::voices_number;
+       first += size) {
+    synth_->audio->updateOscillatorSpread(first, spread_cents_, size);
+  }
+  synth_->audio->endCommands();
+}
 
-  // Looking for the first note that matches the note
-  while (index < audio_config::voices_number) {
-    if (current_notes_[index].number == note.number) {
-      break;
-    }
+void PolySynthState::noteOn(MidiNote note) {
+  synth_->audio->beginCommands();
 
-    index++;
+  // A held note is retriggered on its own stack: the held count stays. A new
+  // note only shrinks the stacks when it needs the room, and a shrink always
+  // frees a group for it, so no stack is cut for a note that is dropped.
+  if (!voices_.holds(note.number)) {
+    regroup(voices_.heldCount() + 1);
   }
 
-  // Note not found
-  if (index >= audio_config::voices_number) {
+  const uint8_t group = voices_.noteOn(note.number, note.velocity);
+  if (group == Voices::kNoVoice) {
+    synth_->audio->endCommands();
     return;
   }
+  const uint8_t held = voices_.heldCount();
+  const uint8_t size = voices_.groupSize();
+  const uint8_t index = group * size;
 
-  current_notes_[index] = {0, 0};
-  note_count_--;
+  float level = (float)note.velocity / 127.0f;
+  float freq = Audio::computeFrequencyFromNote(note.number);
 
-  AudioNoInterrupts();
+  // One command per stack: the voice bank converts the pitch and the spread
+  // once for all of its voices.
+  synth_->audio->normalizeMasterGain(held * size);
+  synth_->audio->updateOscillatorSpread(index, spread_cents_, size);
+  synth_->audio->updateOscillatorFrequency(index, freq, size);
+  synth_->audio->updateOscillatorAmplitude(index, 1.0f, size);
 
-  synth_->audio->normalizeMasterGain(note_count_);
-  synth_->audio->updateOscillatorAmplitude(index, 0.0f);
+  synth_->audio->noteOn(index, level, held == 1, size);
+  gated_voices_ |= ((1u << size) - 1) << index;
 
-  synth_->audio->noteOff(index, note_count_ <= 0);
+  synth_->audio->endCommands();
+}
 
-  AudioInterrupts();
+void PolySynthState::noteOff(MidiNote note) {
+  const uint8_t group = voices_.noteOff(note.number);
+  if (group == Voices::kNoVoice) {
+    return;
+  }
+  const uint8_t held = voices_.heldCount();
+  const uint8_t size = voices_.groupSize();
+  const uint8_t index = group * size;
+
+  synth_->audio->beginCommands();
+
+  // The voices keep their amplitude so the release tail is heard; the
+  // allocator hands them out again last.
+  synth_->audio->normalizeMasterGain(held * size);
+  synth_->audio->noteOff(index, held == 0, size);
+  gated_voices_ &= ~(((1u << size) - 1) << index);
+
+  synth_->audio->endCommands();
 }
 
 void PolySynthState::process() {
   State::process();
 
-  // Update the frequency of the second oscillator
+  // Unison spread
   if (synth_->hardware->changed(hardware::CTRL_POT_1)) {
     float pot_value = synth_->hardware->read(hardware::CTRL_POT_1);
 
-    /*
-     * Convert [0 - 1] value to [0.5 - 1][1 - 2] for detune
-     *
-     * 0.5 - 1: 1 octave down
-     * 1 - 2: 1 octave up
-     */
-    detune_ = pot_value + 0.5f;
-    if (detune_ > 1.0f) {
-      detune_ = detune_ * 1.3333333333333333f;
-    }
-
-    // @TODO: implement oscillators spread ?
+    // Squared, for finer control of narrow spreads. Takes effect on the
+    // sounding stacks now, and on the stack size at the next note.
+    spread_cents_ = pot_value * pot_value * kMaxSpreadCents;
+    updateSpread();
   }
 
   // Update the frequency of the LFO
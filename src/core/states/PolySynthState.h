@@ -4,17 +4,44 @@
 #include "State.h"
 #include "core/Audio.h"
 #include "core/Midi.h"
+#include "core/VoiceAllocator.h"
 
 namespace Autosave {
 
+/**
+ * Polyphonic mode. With POT_1 turned up, every note plays a unison stack of
+ * detuned voices: 8 voices for a single note, then 4 and 2 as more notes are
+ * held, until each note is down to one voice.
+ */
 class PolySynthState : public State {
 private:
-  float detune_ = 0.0f;
+  static PolySynthState *instance_;
 
-  MidiNote current_notes_[audio_config::voices_number];
-  uint8_t note_count_ = 0;
+  float spread_cents_ = 0.0f;
+
+  using Voices = VoiceAllocator<audio_config::voices_number>;
+  Voices voices_;
+  uint16_t gated_voices_ = 0; // voices with a note on sent, one bit each
+
+  static bool voiceActive(uint8_t group, void *ctx);
+
+  uint8_t unisonSize(uint8_t notes) const;
+  void regroup(uint8_t notes);
+  void updateSpread();
 
 public:
+  ~PolySynthState() override;
+
+  /**
+   * Voice stealing (a Voices::StealPolicy value) and same-note retrigger,
+   * loaded from EEPROM by Synth and applied on begin().
+   */
+  static uint8_t steal_policy;
+  static bool retrigger_same_note;
+
+  /** Set the voice policy, applying it at once if poly mode is active. */
+  static void setVoicePolicy(uint8_t policy, bool retrigger);
+
   void begin() override;
   void process() override;
   void noteOn(MidiNote note) override;
@@ -7,32 +7,29 @@ using namespace AutosaveLib;
 namespace Autosave {
 
 void State::begin() {
-  AudioNoInterrupts();
+  synth_->audio->beginCommands();
 
   synth_->audio->noteOffAll();
   synth_->audio->updateAllOscillatorsAmplitude(0.0f);
+  synth_->audio->updateOscillatorSpread(0, 0.0f, audio_config::voices_number);
   synth_->audio->updateLFOAmplitude(0.0f);
 
   loadWaveform((WaveformType)synth_->hardware->read(hardware::CTRL_SWITCH_1));
 
-  AudioInterrupts();
+  synth_->audio->endCommands();
 }
 
 void State::process() {
   // Attack
   if (synth_->hardware->changed(hardware::CTRL_POT_ATTACK)) {
-    AudioNoInterrupts();
     synth_->audio->updateAttack(
         synth_->hardware->read(hardware::CTRL_POT_ATTACK));
-    AudioInterrupts();
   }
 
   // Decay/release
   if (synth_->hardware->changed(hardware::CTRL_POT_RELEASE)) {
-    AudioNoInterrupts();
     synth_->audio->updateRelease(
         synth_->hardware->read(hardware::CTRL_POT_RELEASE));
-    AudioInterrupts();
   }
 
   // Switch 1 changes the waveform type of the main oscillators
@@ -42,7 +39,7 @@ void State::process() {
 }
 
 void State::loadWaveform(WaveformType waveform_type) {
-  AudioNoInterrupts();
+  synth_->audio->beginCommands();
 
   switch (waveform_type) {
   case WaveformType::SYNTH_WAVEFORM_SAWTOOTH:
@@ -60,7 +57,7 @@ void State::loadWaveform(WaveformType waveform_type) {
     Logger::error("Unknown waveform type: " + String(waveform_type));
   }
 
-  AudioInterrupts();
+  synth_->audio->endCommands();
 }
 
 } // namespace Autosave
\ No newline at end of file
@@ -26,6 +26,7 @@ public:
   void setSynth(Synth *synth) { this->synth_ = synth; }
 
   virtual void begin();
+  /** React to the controls that changed; called only when one did. */
   virtual void process();
   virtual void noteOn(MidiNote note) = 0;
   virtual void noteOff(MidiNote note) = 0;
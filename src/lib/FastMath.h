@@ -0,0 +1,81 @@
+#ifndef AUTOSAVE_FAST_MATH_H
+#define AUTOSAVE_FAST_MATH_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace AutosaveLib {
+
+/**
+ * Pitch math without libm: exp2 and log2 from the float bit layout and a
+ * short polynomial, no branches, no tables, inline. Meant for the note-on
+ * and CV paths, where powf/log2f cost hundreds of cycles on the Teensy.
+ *
+ * Error bounds (host/mathcheck checks them):
+ * - exp2: 2.2e-7 relative, under 0.001 cent
+ * - log2: 1.2e-6 absolute, under 0.003 cent once rounded to float
+ *
+ * Inputs are not checked for NaN; log2 expects a positive, normal float.
+ */
+namespace fast_math {
+
+/** 2^x. x is clamped to [-126, 127], the normal float range. */
+inline float exp2(float x) {
+  x = x < -126.0f ? -126.0f : x;
+  x = x > 127.0f ? 127.0f : x;
+
+  // x = i + f with f in [0, 1); truncation rounds negatives up, so step back.
+  int32_t i = (int32_t)x;
+  i -= (float)i > x;
+  const float f = x - (float)i;
+
+  // 2^f, Chebyshev fit on [0, 1]
+  float p = 1.78836880e-3f;
+  p = p * f + 9.19938739e-3f;
+  p = p * f + 5.56570552e-2f;
+  p = p * f + 2.40207195e-1f;
+  p = p * f + 6.93147540e-1f;
+  p = p * f + 1.0f;
+
+  // Scale by 2^i by adding i to the exponent field.
+  uint32_t bits;
+  memcpy(&bits, &p, sizeof(bits));
+  bits += (uint32_t)i << 23;
+  memcpy(&p, &bits, sizeof(p));
+  return p;
+}
+
+/** log2(x) for x > 0. */
+inline float log2(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  const int32_t exponent = (int32_t)(bits >> 23) - 127;
+  bits = (bits & 0x007FFFFFu) | 0x3F800000u; // mantissa in [1, 2)
+  float m;
+  memcpy(&m, &bits, sizeof(m));
+  const float t = m - 1.0f;
+
+  // log2(1 + t), Chebyshev fit on [0, 1]
+  float p = 2.00166497e-2f;
+  p = p * t - 9.46268067e-2f;
+  p = p * t + 2.13943213e-1f;
+  p = p * t - 3.38377208e-1f;
+  p = p * t + 4.77496356e-1f;
+  p = p * t - 7.21144080e-1f;
+  p = p * t + 1.44269300f;
+  return (float)exponent + p * t;
+}
+
+/** Frequency ratio of an interval in cents: 2^(cents / 1200). */
+inline float centsToRatio(float cents) {
+  return exp2(cents * (1.0f / 1200.0f));
+}
+
+/** Interval in cents of a frequency ratio (> 0). */
+inline float ratioToCents(float ratio) { return log2(ratio) * 1200.0f; }
+
+} // namespace fast_math
+
+} // namespace AutosaveLib
+
+#endif
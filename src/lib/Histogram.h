@@ -0,0 +1,69 @@
+#ifndef AUTOSAVE_HISTOGRAM_H
+#define AUTOSAVE_HISTOGRAM_H
+
+#include <cstdint>
+
+namespace AutosaveLib {
+
+/**
+ * Fixed-size histogram with power-of-two bins: bin 0 counts 0, bin k counts
+ * values in [2^(k-1), 2^k), the last bin everything above. Recording is a
+ * handful of instructions and never allocates, so it can run in interrupts.
+ *
+ * Meant for one writer; a reader in another context may see a sample half
+ * recorded (count updated before its bin), which is fine for monitoring.
+ */
+template <uint8_t Bins> class Histogram {
+  static_assert(Bins >= 2 && Bins <= 33, "Histogram needs 2 to 33 bins");
+
+public:
+  void record(uint32_t value) {
+    uint8_t bin = value == 0 ? 0 : 32 - __builtin_clz(value);
+    if (bin >= Bins) {
+      bin = Bins - 1;
+    }
+    bins_[bin]++;
+
+    if (count_ == 0 || value < min_) {
+      min_ = value;
+    }
+    if (value > max_) {
+      max_ = value;
+    }
+    sum_ += value;
+    count_++;
+  }
+
+  void reset() {
+    for (uint8_t i = 0; i < Bins; i++) {
+      bins_[i] = 0;
+    }
+    count_ = 0;
+    min_ = 0;
+    max_ = 0;
+    sum_ = 0;
+  }
+
+  uint32_t count() const { return count_; }
+  uint32_t min() const { return min_; }
+  uint32_t max() const { return max_; }
+  uint32_t mean() const { return count_ == 0 ? 0 : sum_ / count_; }
+  uint32_t bin(uint8_t index) const { return bins_[index]; }
+
+  static constexpr uint8_t bins() { return Bins; }
+  /** Smallest value counted in bin `index`. */
+  static constexpr uint32_t binFloor(uint8_t index) {
+    return index == 0 ? 0 : 1u << (index - 1);
+  }
+
+private:
+  uint32_t bins_[Bins] = {};
+  uint32_t count_ = 0;
+  uint32_t min_ = 0;
+  uint32_t max_ = 0;
+  uint64_t sum_ = 0;
+};
+
+} // namespace AutosaveLib
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef AUTOSAVE_RANDOM_H
+#define AUTOSAVE_RANDOM_H
+
+#include <cstdint>
+
+namespace AutosaveLib {
+
+/**
+ * Marsaglia xorshift32: a few shifts and xors per number, no allocation, no
+ * shared state. Good enough for modulation and drift, not for anything that
+ * needs statistical quality.
+ *
+ * Each generator has its own state, so several of them (e.g. one per voice)
+ * give independent, reproducible sequences from their seeds.
+ */
+class XorShift32 {
+public:
+  explicit XorShift32(uint32_t seed = 1) { this->seed(seed); }
+
+  /**
+   * Any seed is accepted: it is scrambled first (so nearby seeds give
+   * unrelated sequences) and zero, which xorshift cannot leave, is avoided.
+   */
+  void seed(uint32_t seed) {
+    // splitmix32 finalizer
+    seed += 0x9E3779B9u;
+    seed = (seed ^ (seed >> 16)) * 0x85EBCA6Bu;
+    seed = (seed ^ (seed >> 13)) * 0xC2B2AE35u;
+    seed ^= seed >> 16;
+    state_ = seed != 0 ? seed : 0x6D2B79F5u;
+  }
+
+  uint32_t next() {
+    uint32_t x = state_;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state_ = x;
+    return x;
+  }
+
+  /** Uniform in [0, range), without a division. */
+  uint32_t below(uint32_t range) {
+    return (uint32_t)(((uint64_t)next() * range) >> 32);
+  }
+
+  /** Uniform in [-magnitude, magnitude]. */
+  int32_t bipolar(uint16_t magnitude) {
+    return (int32_t)below(2u * magnitude + 1u) - magnitude;
+  }
+
+private:
+  uint32_t state_;
+};
+
+} // namespace AutosaveLib
+
+#endif
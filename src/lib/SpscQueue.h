@@ -0,0 +1,81 @@
+#ifndef AUTOSAVE_SPSC_QUEUE_H
+#define AUTOSAVE_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace AutosaveLib {
+
+/**
+ * Lock-free single-producer/single-consumer ring buffer.
+ *
+ * One context (e.g. the main loop) pushes and one other context (e.g. the
+ * audio interrupt) pops; neither ever blocks or masks interrupts. Capacity
+ * must be a power of two; one slot stays empty to tell full from empty.
+ */
+template <typename T, uint16_t Capacity> class SpscQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "SpscQueue capacity must be a power of two");
+
+public:
+  /** Producer side. Returns false (and drops the item) when full. */
+  bool push(const T &item) {
+    if (!stage(item)) {
+      return false;
+    }
+    commit();
+    return true;
+  }
+
+  /**
+   * Producer side: write an item without publishing it yet. Items staged
+   * before a commit() become visible to the consumer together. Returns false
+   * (and drops the item) when full.
+   */
+  bool stage(const T &item) {
+    const uint32_t next = (staged_head_ + 1) & kMask;
+    if (next == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    items_[staged_head_] = item;
+    staged_head_ = next;
+    return true;
+  }
+
+  /** Producer side: publish every staged item. */
+  void commit() { head_.store(staged_head_, std::memory_order_release); }
+
+  /** Consumer side. Returns false when empty. */
+  bool pop(T *item) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *item = items_[tail];
+    tail_.store((tail + 1) & kMask, std::memory_order_release);
+    return true;
+  }
+
+  /** Approximate when called concurrently with push or pop. */
+  uint16_t size() const {
+    return (head_.load(std::memory_order_acquire) -
+            tail_.load(std::memory_order_acquire)) &
+           kMask;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  static constexpr uint16_t capacity() { return Capacity - 1; }
+
+private:
+  static constexpr uint32_t kMask = Capacity - 1;
+
+  T items_[Capacity];
+  std::atomic<uint32_t> head_{0}; // written by the producer only
+  std::atomic<uint32_t> tail_{0}; // written by the consumer only
+  uint32_t staged_head_ = 0;      // producer only, ahead of head_ until commit
+};
+
+} // namespace AutosaveLib
+
+#endif
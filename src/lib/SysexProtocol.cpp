@@ -0,0 +1,185 @@
+#include "SysexProtocol.h"
+
+namespace AutosaveLib {
+namespace sysex {
+
+namespace {
+constexpr uint8_t kChannelSectionSize = 1;
+constexpr uint8_t kArpStepsSectionSize = kArpModes * (1 + kArpMaxSteps);
+constexpr uint8_t kCustomWaveformSectionSize = 2;
+constexpr uint8_t kVoicePolicySectionSize = 2;
+constexpr uint8_t kPatchRawSize =
+    1 + (2 + kChannelSectionSize) + (2 + kArpStepsSectionSize) +
+    (2 + kCustomWaveformSectionSize) + (2 + kVoicePolicySectionSize);
+static_assert(kPatchRawSize <= kPatchRawMax, "patch layout");
+static_assert(kHeaderSize + kPatchPayloadMax + 1 <= 128,
+              "patch dump must fit the serial SysEx buffer");
+
+/**
+ * Each group of up to 7 bytes becomes one byte holding their MSBs (bit i for
+ * byte i) followed by the bytes' low 7 bits.
+ */
+uint8_t pack(const uint8_t *raw, uint8_t size, uint8_t *out) {
+  uint8_t *start = out;
+  for (uint8_t group = 0; group < size; group += 7) {
+    uint8_t *msbs = out++;
+    *msbs = 0;
+    for (uint8_t i = 0; i < 7 && group + i < size; i++) {
+      const uint8_t byte = raw[group + i];
+      *msbs |= (byte >> 7) << i;
+      *out++ = byte & 0x7F;
+    }
+  }
+  return out - start;
+}
+
+/** Inverse of pack(); false if the size cannot come from pack(). */
+bool unpack(const uint8_t *packed, unsigned size, uint8_t *out,
+            uint8_t *out_size) {
+  if (size % 8 == 1) {
+    return false; // an MSB byte without data
+  }
+  const unsigned raw_size = size - (size + 7) / 8;
+  if (raw_size > kPatchRawMax) {
+    return false;
+  }
+  uint8_t *start = out;
+  for (unsigned group = 0; group < size; group += 8) {
+    const uint8_t msbs = packed[group];
+    for (unsigned i = 0; i < 7 && group + 1 + i < size; i++) {
+      *out++ = (packed[group + 1 + i] & 0x7F) | (((msbs >> i) & 1) << 7);
+    }
+  }
+  *out_size = out - start;
+  return true;
+}
+
+uint8_t *putSection(uint8_t *out, PatchSection id, uint8_t size) {
+  *out++ = id;
+  *out++ = size;
+  return out;
+}
+} // namespace
+
+uint8_t encodePatch(const Patch &patch, uint8_t *out) {
+  uint8_t raw[kPatchRawSize];
+  uint8_t *next = raw;
+  *next++ = kPatchFormat;
+
+  next = putSection(next, PATCH_CHANNEL, kChannelSectionSize);
+  *next++ = patch.channel - 1;
+
+  next = putSection(next, PATCH_ARP_STEPS, kArpStepsSectionSize);
+  for (uint8_t mode = 0; mode < kArpModes; mode++) {
+    const uint8_t len = patch.arp_lengths[mode];
+    *next++ = len;
+    for (uint8_t i = 0; i < kArpMaxSteps; i++) {
+      *next++ = i < len ? patch.arp_steps[mode][i] : 0;
+    }
+  }
+
+  next = putSection(next, PATCH_CUSTOM_WAVEFORM, kCustomWaveformSectionSize);
+  *next++ = patch.waveform_bank;
+  *next++ = patch.waveform_index;
+
+  next = putSection(next, PATCH_VOICE_POLICY, kVoicePolicySectionSize);
+  *next++ = patch.steal_policy;
+  *next++ = patch.retrigger_same_note;
+
+  const uint8_t size = pack(raw, next - raw, out);
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i < size; i++) {
+    sum += out[i];
+  }
+  out[size] = (uint8_t)-sum & 0x7F;
+  return size + 1;
+}
+
+Error decodePatch(const uint8_t *payload, unsigned size, Patch *patch) {
+  if (size < 2) {
+    return ERROR_BAD_LENGTH;
+  }
+  uint8_t sum = 0;
+  for (unsigned i = 0; i < size; i++) {
+    sum += payload[i];
+  }
+  if ((sum & 0x7F) != 0) {
+    return ERROR_BAD_CHECKSUM;
+  }
+
+  uint8_t raw[kPatchRawMax];
+  uint8_t raw_size = 0;
+  if (!unpack(payload, size - 1, raw, &raw_size)) {
+    return ERROR_BAD_LENGTH;
+  }
+  if (raw[0] != kPatchFormat) {
+    return ERROR_BAD_VALUE;
+  }
+
+  Patch result = *patch;
+  uint8_t offset = 1;
+  while (offset < raw_size) {
+    if (raw_size - offset < 2 || raw_size - offset - 2 < raw[offset + 1]) {
+      return ERROR_BAD_LENGTH;
+    }
+    const uint8_t id = raw[offset];
+    const uint8_t section_size = raw[offset + 1];
+    const uint8_t *data = raw + offset + 2;
+    offset += 2 + section_size;
+
+    switch (id) {
+    case PATCH_CHANNEL:
+      if (section_size != kChannelSectionSize) {
+        return ERROR_BAD_LENGTH;
+      }
+      if (data[0] > 15) {
+        return ERROR_BAD_VALUE;
+      }
+      result.channel = data[0] + 1;
+      break;
+    case PATCH_ARP_STEPS:
+      if (section_size != kArpStepsSectionSize) {
+        return ERROR_BAD_LENGTH;
+      }
+      for (uint8_t mode = 0; mode < kArpModes; mode++) {
+        const uint8_t *steps = data + mode * (1 + kArpMaxSteps);
+        if (steps[0] > kArpMaxSteps) {
+          return ERROR_BAD_VALUE;
+        }
+        result.arp_lengths[mode] = steps[0];
+        for (uint8_t i = 0; i < kArpMaxSteps; i++) {
+          result.arp_steps[mode][i] = steps[1 + i];
+        }
+      }
+      break;
+    case PATCH_CUSTOM_WAVEFORM:
+      if (section_size != kCustomWaveformSectionSize) {
+        return ERROR_BAD_LENGTH;
+      }
+      if (data[0] >= kCustomWaveformBanks) {
+        return ERROR_BAD_VALUE;
+      }
+      result.waveform_bank = data[0];
+      result.waveform_index = data[1];
+      break;
+    case PATCH_VOICE_POLICY:
+      if (section_size != kVoicePolicySectionSize) {
+        return ERROR_BAD_LENGTH;
+      }
+      if (data[0] >= kStealPolicies || data[1] > 1) {
+        return ERROR_BAD_VALUE;
+      }
+      result.steal_policy = data[0];
+      result.retrigger_same_note = data[1];
+      break;
+    default:
+      break; // from a newer firmware
+    }
+  }
+
+  *patch = result;
+  return ERROR_NONE;
+}
+
+} // namespace sysex
+} // namespace AutosaveLib
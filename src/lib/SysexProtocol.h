@@ -0,0 +1,256 @@
+#ifndef AUTOSAVE_SYSEX_PROTOCOL_H
+#define AUTOSAVE_SYSEX_PROTOCOL_H
+
+#include <array>
+#include <cstdint>
+
+namespace AutosaveLib {
+
+/**
+ * The SysEx configuration protocol, shared by the firmware (core/Midi) and
+ * the host encoder/decoder (host/common/SysexCodec).
+ *
+ * Every message is F0 7D 00 [command] [payload] F7. The firmware also takes
+ * requests without the F0/F7 framing. A request the firmware cannot serve
+ * gets an error reply: F0 7D 00 7F [command] [error] F7.
+ *
+ * Multi-byte values are 7 bits per data byte, LSB first, saturated.
+ */
+namespace sysex {
+
+constexpr uint8_t kStart = 0xF0;
+constexpr uint8_t kEnd = 0xF7;
+constexpr uint8_t kManufacturer = 0x7D; // non-commercial
+constexpr uint8_t kDevice = 0x00;
+constexpr uint8_t kHeaderSize = 4; // F0 7D 00 [command]
+
+/** Bumped whenever a message changes or is removed (not when added). */
+constexpr uint8_t kProtocolVersion = 1;
+
+enum Command : uint8_t {
+  CMD_SET_CHANNEL = 0x01,           // [channel - 1]
+  CMD_CHANNEL_REPLY = 0x02,         // [channel - 1]
+  CMD_GET_CHANNEL = 0x03,           //
+  CMD_GET_ARP_STEPS = 0x04,         //
+  CMD_ARP_STEPS_REPLY = 0x05,       // per mode: [len] [8 steps]
+  CMD_SET_ARP_STEPS = 0x06,         // [mode] [len] [len steps]
+  CMD_GET_CUSTOM_WAVEFORM = 0x07,   //
+  CMD_CUSTOM_WAVEFORM_REPLY = 0x08, // [bank] [index]
+  CMD_SET_CUSTOM_WAVEFORM = 0x09,   // [bank] [index]
+  CMD_GET_LATENCY = 0x0A,           //
+  CMD_LATENCY_REPLY = 0x0B,         // see kLatencyReplyPayload
+  CMD_RESET_LATENCY = 0x0C,         //
+  CMD_GET_PROFILE = 0x0D,           //
+  CMD_PROFILE_REPLY = 0x0E,         // see kProfileReplyPayloadMax
+  CMD_GET_VERSION = 0x0F,           //
+  CMD_VERSION_REPLY = 0x10,         // [version]
+  CMD_GET_PATCH = 0x11,             //
+  CMD_PATCH_DUMP = 0x12,            // see kPatchFormat; reply and load
+  CMD_GET_VOICE_POLICY = 0x13,      //
+  CMD_VOICE_POLICY_REPLY = 0x14,    // [steal policy] [retrigger same note]
+  CMD_SET_VOICE_POLICY = 0x15,      // [steal policy] [retrigger same note]
+  CMD_ERROR_REPLY = 0x7F,           // [command] [error]
+  CMD_COUNT = 0x80,
+};
+
+enum Error : uint8_t {
+  ERROR_NONE = 0,
+  ERROR_UNKNOWN_COMMAND = 1, // not a request the firmware serves
+  ERROR_BAD_LENGTH = 2,      // payload size does not match the command
+  ERROR_BAD_VALUE = 3,       // a payload byte is out of range
+  ERROR_UNAVAILABLE = 4,     // nothing serves the command right now
+  ERROR_BAD_CHECKSUM = 5,    // a patch dump was corrupted on the way
+};
+
+// Arp steps: one entry per arp mode, always kArpMaxSteps steps long.
+constexpr uint8_t kArpModes = 3;
+constexpr uint8_t kArpMaxSteps = 8;
+// Custom waveform banks: 0 FM, 1 granular, 2 overtone.
+constexpr uint8_t kCustomWaveformBanks = 3;
+// Poly mode voice stealing: 0 oldest, 1 quietest, 2 none (drop the new
+// note); retrigger same note is 0 or 1 (see VoiceAllocator).
+constexpr uint8_t kStealPolicies = 3;
+
+// Note latency reply: [stages] [bins], then per stage [count] [min] [mean]
+// [max] and one value per bin, every value kLatencyValueSize bytes (µs).
+// Stages: poll interval, dispatch to note on, dispatch to first sample.
+constexpr uint8_t kLatencyStages = 3;
+constexpr uint8_t kLatencyBins = 16;
+constexpr uint8_t kLatencyValueSize = 3;
+constexpr uint8_t kLatencyReplyPayload =
+    2 + kLatencyStages * (4 + kLatencyBins) * kLatencyValueSize;
+
+// Loop profile reply: [stages] [loops/s], then per stage [min] [avg] [max]
+// [p99], every value kProfileValueSize bytes (cycles). Stages is 0 when the
+// profiler is compiled out.
+constexpr uint8_t kProfileStagesMax = 4;
+constexpr uint8_t kProfileValueSize = 4;
+constexpr uint8_t kProfileReplyPayloadMax =
+    1 + kProfileValueSize + kProfileStagesMax * 4 * kProfileValueSize;
+
+// Patch dump: every persistent setting in one message. The raw patch is a
+// format byte then sections of [id] [size] [data]; it is sent packed 7 bits
+// per byte (packedSize()) and followed by a checksum byte that brings the
+// sum of the payload to 0 modulo 128. A load skips unknown sections and
+// keeps the current value of missing ones, so a section can be added without
+// a new format. Calibration is per unit and is not part of a patch.
+constexpr uint8_t kPatchFormat = 1;
+enum PatchSection : uint8_t {
+  PATCH_CHANNEL = 1,         // [channel - 1]
+  PATCH_ARP_STEPS = 2,       // per mode: [len] [8 steps]
+  PATCH_CUSTOM_WAVEFORM = 3, // [bank] [index]
+  PATCH_VOICE_POLICY = 4,    // [steal policy] [retrigger same note]
+};
+constexpr uint8_t kPatchRawMax = 96;
+
+/** Size of `raw_size` bytes packed 7 bits per byte: one MSB byte per 7. */
+constexpr uint8_t packedSize(uint8_t raw_size) {
+  return raw_size + (raw_size + 6) / 7;
+}
+
+constexpr uint8_t kPatchPayloadMax = packedSize(kPatchRawMax) + 1;
+
+/** The settings a patch dump carries. */
+struct Patch {
+  uint8_t channel; // 1 to 16
+  uint8_t arp_lengths[kArpModes];
+  uint8_t arp_steps[kArpModes][kArpMaxSteps];
+  uint8_t waveform_bank;
+  uint8_t waveform_index;
+  uint8_t steal_policy;
+  uint8_t retrigger_same_note; // 0 or 1
+};
+
+/** Write the CMD_PATCH_DUMP payload of `patch`; returns its size. */
+uint8_t encodePatch(const Patch &patch, uint8_t *out);
+
+/**
+ * Read a CMD_PATCH_DUMP payload over `patch`, which should hold the current
+ * settings. `patch` is only changed when the whole payload is valid.
+ */
+Error decodePatch(const uint8_t *payload, unsigned size, Patch *patch);
+
+/** Payload size bounds of a command, in bytes between command and F7. */
+struct MessageSpec {
+  Command command;
+  uint8_t min_payload;
+  uint8_t max_payload;
+};
+
+constexpr MessageSpec kMessages[] = {
+    {CMD_SET_CHANNEL, 1, 1},
+    {CMD_CHANNEL_REPLY, 1, 1},
+    {CMD_GET_CHANNEL, 0, 0},
+    {CMD_GET_ARP_STEPS, 0, 0},
+    {CMD_ARP_STEPS_REPLY, kArpModes * (1 + kArpMaxSteps),
+     kArpModes * (1 + kArpMaxSteps)},
+    {CMD_SET_ARP_STEPS, 2, 2 + kArpMaxSteps},
+    {CMD_GET_CUSTOM_WAVEFORM, 0, 0},
+    {CMD_CUSTOM_WAVEFORM_REPLY, 2, 2},
+    {CMD_SET_CUSTOM_WAVEFORM, 2, 2},
+    {CMD_GET_LATENCY, 0, 0},
+    {CMD_LATENCY_REPLY, kLatencyReplyPayload, kLatencyReplyPayload},
+    {CMD_RESET_LATENCY, 0, 0},
+    {CMD_GET_PROFILE, 0, 0},
+    {CMD_PROFILE_REPLY, 1 + kProfileValueSize, kProfileReplyPayloadMax},
+    {CMD_GET_VERSION, 0, 0},
+    {CMD_VERSION_REPLY, 1, 1},
+    {CMD_GET_PATCH, 0, 0},
+    {CMD_PATCH_DUMP, 2, kPatchPayloadMax},
+    {CMD_GET_VOICE_POLICY, 0, 0},
+    {CMD_VOICE_POLICY_REPLY, 2, 2},
+    {CMD_SET_VOICE_POLICY, 2, 2},
+    {CMD_ERROR_REPLY, 2, 2},
+};
+constexpr uint8_t kMessageCount = sizeof(kMessages) / sizeof(kMessages[0]);
+constexpr uint8_t kNoMessage = 0xFF;
+
+constexpr std::array<uint8_t, CMD_COUNT> messageIndex() {
+  std::array<uint8_t, CMD_COUNT> index{};
+  for (uint8_t command = 0; command < CMD_COUNT; command++) {
+    index[command] = kNoMessage;
+  }
+  for (uint8_t i = 0; i < kMessageCount; i++) {
+    index[kMessages[i].command] = i;
+  }
+  return index;
+}
+
+/** kMessages entry of each command, or kNoMessage. */
+constexpr std::array<uint8_t, CMD_COUNT> kMessageIndex = messageIndex();
+
+/** Spec of a command, or nullptr if the protocol does not define it. */
+inline const MessageSpec *messageSpec(uint8_t command) {
+  if (command >= CMD_COUNT || kMessageIndex[command] == kNoMessage) {
+    return nullptr;
+  }
+  return &kMessages[kMessageIndex[command]];
+}
+
+/** Payload of a message, with or without its F0/F7 framing. */
+struct Message {
+  uint8_t command;
+  const uint8_t *payload;
+  unsigned payload_size;
+};
+
+/** False if `data` is not a message of this protocol. */
+inline bool parse(const uint8_t *data, unsigned size, Message *out) {
+  if (data == nullptr) {
+    return false;
+  }
+  if (size > 0 && data[0] == kStart) {
+    data++;
+    size--;
+  }
+  if (size > 0 && data[size - 1] == kEnd) {
+    size--;
+  }
+  if (size < 3 || data[0] != kManufacturer || data[1] != kDevice) {
+    return false;
+  }
+  out->command = data[2];
+  out->payload = data + 3;
+  out->payload_size = size - 3;
+  return true;
+}
+
+/** True if the payload size is within the command's spec. */
+inline bool validLength(const MessageSpec &spec, unsigned payload_size) {
+  return payload_size >= spec.min_payload && payload_size <= spec.max_payload;
+}
+
+/** Write F0 7D 00 [command]; returns the first payload byte. */
+inline uint8_t *putHeader(uint8_t *out, uint8_t command) {
+  *out++ = kStart;
+  *out++ = kManufacturer;
+  *out++ = kDevice;
+  *out++ = command;
+  return out;
+}
+
+/** Write value as `bytes` data bytes, LSB first; saturates. */
+inline uint8_t *putValue(uint8_t *out, uint32_t value, uint8_t bytes) {
+  const uint32_t max = (1u << (7 * bytes)) - 1;
+  if (value > max) {
+    value = max;
+  }
+  for (uint8_t i = 0; i < bytes; i++) {
+    *out++ = (value >> (7 * i)) & 0x7F;
+  }
+  return out;
+}
+
+/** Read a value written by putValue(). */
+inline uint32_t getValue(const uint8_t *in, uint8_t bytes) {
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < bytes; i++) {
+    value |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+  }
+  return value;
+}
+
+} // namespace sysex
+} // namespace AutosaveLib
+
+#endif
@@ -1,4 +1,3 @@
-#include <Bounce2.h>
 #include <MIDI.h>
 #include <ResponsiveAnalogRead.h>
 